@@ -3,6 +3,7 @@
 #include "m_pd.h"
 #include "g_canvas.h"
 #include "m_imp.h"
+#include "atomsort.h"
 #include <string.h>
 #include <math.h>
 
@@ -39,50 +40,13 @@ typedef struct dir{
     t_outlet   *x_out4;
 }t_dir;
 
-static void sort_swap(t_atom *av, int i, int j){
-    t_atom temp = av[j];
-    av[j] = av[i];
-    av[i] = temp;
-}
-
-static int sort_compare(t_atom *a1, t_atom *a2){
-    if(a1->a_type == A_FLOAT && a2->a_type == A_SYMBOL)
-        return(-1);
-    else if(a1->a_type == A_SYMBOL && a2->a_type == A_FLOAT)
-        return(1);
-    else if(a1->a_type == A_FLOAT && a2->a_type == A_FLOAT){
-        if(a1->a_w.w_float < a2->a_w.w_float)
-            return(-1);
-        else if(a1->a_w.w_float > a2->a_w.w_float)
-            return(1);
-        else
-            return(0);
-    }
-    else
-        return(strcmp(a1->a_w.w_symbol->s_name, a2->a_w.w_symbol->s_name));
-}
-
-static void sort_qsort(t_dir *x, t_atom *av1, int left, int right){
-    if(left >= right)
-        return;
-    sort_swap(av1, left, (left+right)/2);
-    int last = left;
-    for(int i = left+1; i <= right; i++){
-        if((sort_compare(av1+i, av1+left)) < 0)
-            sort_swap(av1, ++last, i);
-    }
-    sort_swap(av1, left, last);
-    sort_qsort(x, av1, left, last-1);
-    sort_qsort(x, av1, last+1, right);
-}
-
 static void dir_sort(t_dir *x, t_sortdata *d, int ac, t_atom *av){
     if(ac){
         if(ac > d->maxn)
             ac = d->maxn;
         d->n = ac;
         memcpy(d->buf, av, ac*sizeof(*d->buf));
-        sort_qsort(x, d->buf, 0, ac-1);
+        atomsort(d->buf, NULL, ac, 1, 0);
     }
 }
 
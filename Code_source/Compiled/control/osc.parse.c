@@ -39,16 +39,35 @@ The OSC webpage is http://cnmat.cnmat.berkeley.edu/OpenSoundControl
 #define ONE_MILLION_OVER_TWO_TO_THE_32 0.00023283064365386963
 #define SMALLEST_POSITIVE_FLOAT 0.000001f
 
+// Packets are parsed in place from one byte buffer kept by the object, and
+// it grows to whatever comes in, so there's no size limit. Messages are
+// decoded into an atom buffer that grows along with it. With -sched,
+// messages in bundles with a future timetag are held in a heap and output
+// when it's due, driven by a single clock (like [pipe2]).
+
 static t_class *oscparse_class;
 
+typedef struct _hang{
+    double          h_time;     // logical time to output
+    unsigned int    h_seq;      // keeps same time hangs in arrival order
+    int             h_n;
+    t_atom         *h_atoms;    // allocated along with the hang
+}t_hang;
+
 typedef struct _oscparse{
     t_object    x_obj;
     t_outlet    *x_data_out;
     t_outlet    *x_delay_out;
-    int         x_bundle_flag;/* non-zero if we are processing a bundle */
-    int         x_recursion_level;/* number of times we reenter oscparse_list */
-    int         x_abort_bundle;/* non-zero if oscparse_list is not well formed */
-    int         x_reentry_count;
+    char        *x_raw;         // bytes of the packet being parsed
+    t_atom      *x_at;          // path + payload of the message being output
+    int         x_size;         // room in x_raw, x_at has one more
+    int         x_busy;         // we're outputting, buffers are in use
+    int         x_sched;        // hold messages until their timetag
+    t_clock     *x_clock;
+    t_hang      **x_heap;
+    int         x_nheap;
+    int         x_heapsize;
+    unsigned int x_seq;
 }t_oscparse;
 
 static void oscparse_PrintTypeTaggedArgs(t_atom *data_at, int *data_atc, void *v, int n);
@@ -146,216 +165,212 @@ static char *oscparse_DataAfterAlignedString(char *string, char *boundary){
 }
 
 static int oscparse_path(t_atom *data_at, char *path){
-    int i;
     if (path[0] != '/'){
-        for (i = 0; i < 16; ++i) if ('\0' == path[i]) break;
-        path[i] = '\0';
         post("oscparse: Path doesn't begin with \"/\", dropping message");
         return 0;
     }
-    for (i = 1; i < MAX_MESG; ++i){
-        if (path[i] == '\0'){ /* the end of the path: turn path into a symbol */
-            SETSYMBOL(data_at, gensym(path));
-            return 1;
-        }
-    }
-    post("oscparse: Path too long, dropping message");
-    return 0;
+    /* the path was checked to end inside the packet, turn it into a symbol */
+    SETSYMBOL(data_at, gensym(path));
+    return 1;
 }
 
-/* oscparse_list expects an OSC packet in the form of a list of floats on [0..255] */
-static void oscparse_worker(t_oscparse *x, t_symbol *s, int argc, t_atom *argv, char *buf);
-static void oscparse_list(t_oscparse *x, t_symbol *s, int argc, t_atom *argv) 
-{
-    // ag: This is a small wrapper around oscparse_worker below which does all the real
-    // work. It does some preliminary checks and then sets up a buffer populated with the
-    // binary data of the message which then gets passed to the worker. That way we don't have
-    // to reparse the data over and over again in each recursive call to the worker, as was
-    // done in the original implementation, wasting a lot of time and stack space.
-    int             i, j;
-    // This can be static as it's only read by the worker, never modified.
-    static char     raw[MAX_MESG];/* bytes making up the entire OSC message */
-    // preliminary checks
-    if ((argc%4) != 0)
-    {
-        post("oscparse: Packet size (%d) not a multiple of 4 bytes: dropping packet", argc);
-        return;
+static int oscparse_before(t_hang *a, t_hang *b){
+    return(a->h_time < b->h_time || (a->h_time == b->h_time
+        && (int)(a->h_seq - b->h_seq) < 0));
+}
+
+static void oscparse_push(t_oscparse *x, t_hang *h){
+    if(x->x_nheap == x->x_heapsize){
+        int size = x->x_heapsize ? x->x_heapsize * 2 : 64;
+        x->x_heap = (t_hang **)resizebytes(x->x_heap,
+            x->x_heapsize * sizeof(t_hang *), size * sizeof(t_hang *));
+        x->x_heapsize = size;
     }
-    if(argc > MAX_MESG)
-    {
-        post("oscparse: Packet size (%d) greater than max (%d). Change MAX_MESG and recompile if you want more.", argc, MAX_MESG);
-        return;
+    t_hang **heap = x->x_heap;
+    int i = x->x_nheap++;
+    while(i > 0){ // sift up
+        int parent = (i - 1) / 2;
+        if(!oscparse_before(h, heap[parent]))
+            break;
+        heap[i] = heap[parent];
+        i = parent;
     }
-    /* copy the list to a byte buffer, checking for bytes only */
-    for (i = 0; i < argc; ++i)
-    {
-        if (argv[i].a_type == A_FLOAT)
-        {
-            j = (int)argv[i].a_w.w_float;
-/*          if ((j == argv[i].a_w.w_float) && (j >= 0) && (j <= 255)) */
-/* this can miss bytes between 128 and 255 because they are interpreted somewhere as negative */
-/* , so change to this: */
-            if ((j == argv[i].a_w.w_float) && (j >= -128) && (j <= 255))
-            {
-                raw[i] = (char)j;
-            }
-            else
-            {
-                post("oscparse: Data out of range (%d), dropping packet", argv[i].a_w.w_float);
-                return;
-            }
-        }
-        else
-        {
-            post("oscparse: Data not float, dropping packet");
-            return;
-        }
+    heap[i] = h;
+}
+
+static t_hang *oscparse_pop(t_oscparse *x){
+    t_hang **heap = x->x_heap, *top = heap[0], *last = heap[--x->x_nheap];
+    int i = 0, n = x->x_nheap;
+    while(1){ // sift down
+        int child = 2*i + 1;
+        if(child >= n)
+            break;
+        if(child + 1 < n && oscparse_before(heap[child+1], heap[child]))
+            child++;
+        if(!oscparse_before(heap[child], last))
+            break;
+        heap[i] = heap[child];
+        i = child;
     }
-    oscparse_worker(x, s, argc, argv, raw);
+    if(n)
+        heap[i] = last;
+    return(top);
 }
 
-static void oscparse_worker(t_oscparse *x, t_symbol *s, int argc, t_atom *argv, char *buf) 
-{
-    int             size, messageLen, i;
-    char            *messageName, *args;
-    OSCTimeTag      tt;
-    // ag: The original implementation reserved an excessive amount of storage on the stack
-    // here which caused the object to crash with a C stack overflow on Windows. We use a more
-    // reasonable limit here (as each element of an OSC message must consist of at least 4 bytes,
-    // MAX_MESG/4 should always be big enough), and we can also allocate the memory in static
-    // storage, since it is only used in the non-recursive part of the function.
-    static t_atom   data_at[MAX_MESG/4] ={{0}};/* symbols making up the path + payload */
-    int             data_atc = 0;/* number of symbols to be output */
+static void oscparse_hang_free(t_hang *h){
+    freebytes(h, sizeof(t_hang) + h->h_n * sizeof(t_atom));
+}
 
-#ifdef DEBUG
-    printf(">>> oscparse_worker: %d bytes, abort=%d, reentry_count %d recursion_level %d\n",
-        argc, x->x_abort_bundle, x->x_reentry_count, x->x_recursion_level);
-#endif
-    if(x->x_abort_bundle) return; /* if backing quietly out of the recursive stack */
-    x->x_reentry_count++;
-    if ((argc%4) != 0)
-    {
-        post("oscparse: Packet size (%d) not a multiple of 4 bytes: dropping packet", argc);
-        goto oscparse_worker_out;
-    }
-    if(argc > MAX_MESG)
-    {
-        post("oscparse: Packet size (%d) greater than max (%d). Change MAX_MESG and recompile if you want more.", argc, MAX_MESG);
-        goto oscparse_worker_out;
+static void oscparse_tick(t_oscparse *x){
+    double now = clock_getlogicaltime();
+    while(x->x_nheap && x->x_heap[0]->h_time <= now){
+        t_hang *h = oscparse_pop(x);
+        outlet_anything(x->x_data_out, atom_getsymbol(h->h_atoms), h->h_n-1, h->h_atoms+1);
+        oscparse_hang_free(h);
     }
+    if(x->x_nheap)
+        clock_set(x->x_clock, x->x_heap[0]->h_time);
+}
 
-    if ((argc >= 8) && (strncmp(buf, "#bundle", 8) == 0))
-    { /* This is a bundle message. */
-#ifdef DEBUG
-        printf("oscparse: bundle msg:\n");
-#endif
+// output a parsed message now, or hold it if it's in a bundle that is due later
+static void oscparse_output(t_oscparse *x, t_atom *at, int ac, t_float delay){
+    if(!x->x_sched || delay <= 0){
+        outlet_anything(x->x_data_out, atom_getsymbol(at), ac-1, at+1);
+        return;
+    }
+    t_hang *h = (t_hang *)getbytes(sizeof(t_hang) + ac * sizeof(t_atom));
+    h->h_atoms = (t_atom *)(h + 1);
+    h->h_n = ac;
+    for(int i = 0; i < ac; i++)
+        h->h_atoms[i] = at[i];
+    h->h_time = clock_getsystimeafter(delay);
+    h->h_seq = x->x_seq++;
+    oscparse_push(x, h);
+    if(x->x_heap[0] == h)
+        clock_set(x->x_clock, h->h_time);
+}
 
-        if (argc < 16)
-        {
-            post("oscparse: Bundle message too small (%d bytes) for time tag", argc);
-            goto oscparse_worker_out;
-        }
+static void oscparse_clear(t_oscparse *x){
+    while(x->x_nheap)
+        oscparse_hang_free(x->x_heap[--x->x_nheap]);
+    clock_unset(x->x_clock);
+}
 
-        x->x_bundle_flag = 1;
+static void oscparse_sched(t_oscparse *x, t_floatarg f){
+    x->x_sched = (f != 0);
+}
 
-        /* Print the time tag */
-#ifdef DEBUG
-        printf("oscparse bundle timetag: [ %x.%0x\n", ntohl(*((uint32_t *)(buf+8))),
-            ntohl(*((uint32_t *)(buf+12))));
-#endif
-/* convert the timetag into a millisecond delay from now */
+/* parses the 'n' bytes of a packet or bundle element at 'buf', 'delay' is the
+   offset of the enclosing bundle if 'depth' > 0. Returns 0 if bundles were
+   nested so deep that we need to back out of the whole thing. */
+static int oscparse_worker(t_oscparse *x, char *buf, int n, t_atom *at, int depth, t_float delay){
+    int size, i, ac;
+    char *args;
+    OSCTimeTag tt;
+    if ((n%4) != 0){
+        post("oscparse: Packet size (%d) not a multiple of 4 bytes: dropping packet", n);
+        return(1);
+    }
+    if ((n >= 8) && (strncmp(buf, "#bundle", 8) == 0)){ /* This is a bundle message. */
+        if (n < 16){
+            post("oscparse: Bundle message too small (%d bytes) for time tag", n);
+            return(1);
+        }
+        /* convert the timetag into a millisecond delay from now */
         tt.seconds = ntohl(*((uint32_t *)(buf+8)));
         tt.fraction = ntohl(*((uint32_t *)(buf+12)));
-        /* pd can use a delay in milliseconds */
-        outlet_float(x->x_delay_out, oscparse_DeltaTime(tt));
-        /* Note: if we wanted to actually use the time tag as a little-endian
-          64-bit int, we'd have to word-swap the two 32-bit halves of it */
-
-        i = 16; /* Skip "#group\0" and time tag */
-
-        while(i < argc)
-        {
-            size = ntohl(*((int *) (buf + i)));
-            if ((size % 4) != 0)
-            {
+        delay = oscparse_DeltaTime(tt);
+        outlet_float(x->x_delay_out, delay);
+        /* the elements are parsed right where they are in the buffer */
+        for(i = 16; i < n; i += 4 + size){ /* Skip "#bundle\0" and time tag */
+            size = ntohl(*((int *)(buf + i)));
+            if ((size % 4) != 0){
                 post("oscparse: Bad size count %d in bundle (not a multiple of 4)", size);
-                goto oscparse_worker_out;
+                return(1);
             }
-            if ((size + i + 4) > argc)
-            {
+            if (size < 0 || size > n - i - 4){
                 post("oscparse: Bad size count %d in bundle (only %d bytes left in entire bundle)",
-                    size, argc-i-4);
-                goto oscparse_worker_out;
+                    size, n-i-4);
+                return(1);
             }
-
-            /* Recursively handle element of bundle */
-            x->x_recursion_level++;
-#ifdef DEBUG
-            printf("oscparse: bundle depth %d\n", x->x_recursion_level);
-#endif
-            if (x->x_recursion_level > MAX_BUNDLE_NESTING)
-            {
+            if (depth >= MAX_BUNDLE_NESTING){
                 post("oscparse: bundle depth %d exceeded", MAX_BUNDLE_NESTING);
-                x->x_abort_bundle = 1;/* we need to back out of the recursive stack*/
-                goto oscparse_worker_out;
+                return(0);
             }
-#ifdef DEBUG
-            printf("oscparse: bundle calling oscparse_worker(x=%p, s=%s, size=%d, argv[%d]=%p)\n",
-              x, s->s_name, size, i+4, &argv[i+4]);
-#endif
-            oscparse_worker(x, s, size, &argv[i+4], buf+i+4);
-            i += 4 + size;
-        }
-
-        if (i != argc)
-        {
-            post("oscparse: This can't happen");
+            if(!oscparse_worker(x, buf+i+4, size, at, depth+1, delay))
+                return(0);
         }
-
-        x->x_bundle_flag = 0; /* end of bundle */
-#ifdef DEBUG
-        printf("oscparse: bundle end ] depth is %d\n", x->x_recursion_level);
-#endif
-
-    } 
-    else if ((argc == 24) && (strcmp(buf, "#time") == 0))
-    {
-        post("oscparse: Time message: %s\n :).\n", buf);
-        goto oscparse_worker_out;
     }
-    else
-    { /* This is not a bundle message or a time message */
-
-        messageName = buf;
-#ifdef DEBUG
-        printf("oscparse: message name string: %s length %d\n", messageName, argc);
-#endif
-        args = oscparse_DataAfterAlignedString(messageName, buf+argc);
-        if (args == 0)
-        {
+    else if ((n == 24) && (strcmp(buf, "#time") == 0))
+        post("oscparse: Time message: %s\n :).\n", buf);
+    else{ /* This is not a bundle message or a time message */
+        args = oscparse_DataAfterAlignedString(buf, buf+n);
+        if (args == 0){
             post("oscparse: Bad message name string: Dropping entire message.");
-            goto oscparse_worker_out;
+            return(1);
         }
-        messageLen = args-messageName;
         /* put the OSC path into a single symbol */
-        data_atc = oscparse_path(data_at, messageName); /* returns 1 if path OK, else 0  */
-        if (data_atc == 1)
-        {
-#ifdef DEBUG
-            printf("oscparse_worker calling oscparse_Smessage: message length %d\n", argc-messageLen);
-#endif
-            oscparse_Smessage(data_at, &data_atc, (void *)args, argc-messageLen);
-            if (0 == x->x_bundle_flag)
+        if((ac = oscparse_path(at, buf))){
+            oscparse_Smessage(at, &ac, (void *)args, n-(args-buf));
+            if (!depth)
                 outlet_float(x->x_delay_out, 0); /* no delay for message not in a bundle */
+            oscparse_output(x, at, ac, delay);
+        }
+    }
+    return(1);
+}
+
+/* oscparse_list expects an OSC packet in the form of a list of floats on [0..255] */
+static void oscparse_list(t_oscparse *x, t_symbol *s, int argc, t_atom *argv){
+    s = NULL;
+    char *raw;
+    t_atom *at;
+    if ((argc%4) != 0){
+        post("oscparse: Packet size (%d) not a multiple of 4 bytes: dropping packet", argc);
+        return;
+    }
+    // the buffers are reused, unless a message we output comes back in
+    // while we're still parsing. Every byte makes at most one atom, so
+    // 'argc' atoms plus the path will always do. 4 zeros past the packet
+    // stop the string scans at its end.
+    if(x->x_busy){
+        raw = (char *)getbytes(argc + 4);
+        at = (t_atom *)getbytes((argc + 1) * sizeof(t_atom));
+    }
+    else{
+        if(argc > x->x_size){
+            x->x_raw = (char *)resizebytes(x->x_raw, x->x_size + 4, argc + 4);
+            x->x_at = (t_atom *)resizebytes(x->x_at,
+                (x->x_size + 1) * sizeof(t_atom), (argc + 1) * sizeof(t_atom));
+            x->x_size = argc;
+        }
+        raw = x->x_raw;
+        at = x->x_at;
+    }
+    /* copy the list to a byte buffer, checking for bytes only */
+    for(int i = 0; i < argc; i++){
+        if(argv[i].a_type != A_FLOAT){
+            post("oscparse: Data not float, dropping packet");
+            goto done;
+        }
+        t_float f = argv[i].a_w.w_float;
+        int j = (int)f;
+        /* bytes between 128 and 255 may come in as negative */
+        if(f < -128 || f > 255 || j != f){
+            post("oscparse: Data out of range (%g), dropping packet", f);
+            goto done;
         }
+        raw[i] = (char)j;
+    }
+    memset(raw + argc, 0, 4);
+    x->x_busy++;
+    oscparse_worker(x, raw, argc, at, 0, 0);
+    x->x_busy--;
+done:
+    if(raw != x->x_raw){
+        freebytes(raw, argc + 4);
+        freebytes(at, (argc + 1) * sizeof(t_atom));
     }
-    if (data_atc >= 1)
-        outlet_anything(x->x_data_out, atom_getsymbol(data_at), data_atc-1, data_at+1);
-    data_atc = 0;
-    x->x_abort_bundle = 0;
-oscparse_worker_out:
-    x->x_recursion_level = 0;
-    x->x_reentry_count--;
 }
 
 static void oscparse_PrintHeuristicallyTypeGuessedArgs(t_atom *data_at, int *data_atc, void *v, int n, int skipComma){
@@ -399,6 +414,7 @@ static void oscparse_PrintHeuristicallyTypeGuessedArgs(t_atom *data_at, int *dat
         else if (oscparse_IsNiceString(string, chars+n))
         {
             nextString = oscparse_DataAfterAlignedString(string, chars+n);
+            if (nextString == 0) break;
 #ifdef DEBUG
             printf("\"%s\" ", (i == 0 && skipComma) ? string +1 : string);
 #endif
@@ -461,6 +477,7 @@ static int oscparse_IsNiceString(char *string, char *boundary){
         /* if ((!isprint(string[i])) || (string + i >= boundary)) return 0; */ /* only ASCII printable chars */
         /*if ((0==(string[i]&0xE0)) || (string + i >= boundary)) return 0;*/ /* onl;y ASCII space (0x20) and above */
         if (string + i >= boundary) return 0; /* anything non-zero */
+    if (string + i >= boundary) return 0; /* the null is past the end */
     /* If we made it this far, it's a null-terminated sequence of characters
        within the given boundary.  Now we just make sure it's null padded... */
 
@@ -494,6 +511,12 @@ static void oscparse_PrintTypeTaggedArgs(t_atom *data_at, int *data_atc, void *v
 #endif
     if (p == NULL) return; /* malformed message */
     for (thisType = typeTags + 1; *thisType != 0; ++thisType){
+        /* don't read past the end if there's less data than type tags say */
+        int need = strchr("bmircf", *thisType) ? 4 : strchr("htd", *thisType) ? 8 : 0;
+        if (p + need > typeTags + n){
+            post("oscparse: PrintTypeTaggedArgs: Type tags go past the end of the message");
+            return;
+        }
         switch (*thisType){
             case 'b': /* blob: an int32 size count followed by that many 8-bit bytes */
             {
@@ -502,6 +525,10 @@ static void oscparse_PrintTypeTaggedArgs(t_atom *data_at, int *data_atc, void *v
                 printf("blob: %u bytes\n", blob_bytes);
 #endif
                 p += 4;
+                if (blob_bytes < 0 || blob_bytes > typeTags + n - p){
+                    post("oscparse: PrintTypeTaggedArgs: Bad blob size %d", blob_bytes);
+                    return;
+                }
                 for (i = 0; i < blob_bytes; ++i, ++p, ++myargc)
                     SETFLOAT(mya+myargc,(*(unsigned char *)p));
                 while (i%4)
@@ -610,19 +637,46 @@ static void oscparse_PrintTypeTaggedArgs(t_atom *data_at, int *data_atc, void *v
     *data_atc = myargc;
 }
 
-static void *oscparse_new(void){
-    t_oscparse *x;
-    x = (t_oscparse *)pd_new(oscparse_class);
+static void oscparse_free(t_oscparse *x){
+    oscparse_clear(x);
+    clock_free(x->x_clock);
+    if(x->x_heap)
+        freebytes(x->x_heap, x->x_heapsize * sizeof(t_hang *));
+    freebytes(x->x_raw, x->x_size + 4);
+    freebytes(x->x_at, (x->x_size + 1) * sizeof(t_atom));
+}
+
+static void *oscparse_new(t_symbol *s, int ac, t_atom *av){
+    s = NULL;
+    t_oscparse *x = (t_oscparse *)pd_new(oscparse_class);
+    x->x_sched = 0;
+    while(ac){
+        if(av->a_type == A_SYMBOL && atom_getsymbol(av) == gensym("-sched"))
+            x->x_sched = 1;
+        else
+            goto errstate;
+        ac--, av++;
+    }
+    x->x_size = 1024;
+    x->x_raw = (char *)getbytes(x->x_size + 4);
+    x->x_at = (t_atom *)getbytes((x->x_size + 1) * sizeof(t_atom));
+    x->x_busy = 0;
+    x->x_clock = clock_new(x, (t_method)oscparse_tick);
+    x->x_heap = NULL;
+    x->x_nheap = x->x_heapsize = 0;
+    x->x_seq = 0;
     x->x_data_out = outlet_new(&x->x_obj, &s_list);
     x->x_delay_out = outlet_new(&x->x_obj, &s_float);
-    x->x_bundle_flag = 0;
-    x->x_recursion_level = 0;
-    x->x_abort_bundle = 0;
     return(x);
+errstate:
+    pd_error(x, "[osc.parse]: improper args");
+    return(NULL);
 }
 
 void setup_osc0x2eparse(void){
     oscparse_class = class_new(gensym("osc.parse"), (t_newmethod)oscparse_new,
-        0, sizeof(t_oscparse), 0, 0);
+        (t_method)oscparse_free, sizeof(t_oscparse), 0, A_GIMME, 0);
     class_addlist(oscparse_class, (t_method)oscparse_list);
+    class_addmethod(oscparse_class, (t_method)oscparse_sched, gensym("sched"), A_FLOAT, 0);
+    class_addmethod(oscparse_class, (t_method)oscparse_clear, gensym("clear"), 0);
 }
@@ -31,8 +31,35 @@ MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
 */
 
 #include "m_pd.h"
+#include <string.h>
+#include <stdint.h>
 
 #define MAX_NUM 256 // maximum number of paths (prefixes) we can route
+#define REST_CACHE 64 // rest of path symbols we remember
+
+// The prefixes are compiled into a trie with one level per address segment,
+// so an address without wildcards is routed by walking down it once. Only
+// addresses with wildcards go through the pattern matching of every prefix.
+
+typedef struct _trie{
+    const char     *t_seg;      // segment, t_len chars, not terminated
+    int             t_len;
+    int            *t_routes;   // prefixes that end here
+    int             t_nroutes;
+    struct _trie   *t_children; // sorted by segment
+    int             t_nchildren;
+}t_trie;
+
+typedef struct _restcache{
+    t_symbol   *c_addr;
+    int         c_depth;
+    t_symbol   *c_rest;
+}t_restcache;
+
+typedef struct _match{
+    int         m_route;
+    int         m_depth;
+}t_match;
 
 typedef struct _oscroute{
     t_object    x_obj; /* required header */
@@ -40,6 +67,10 @@ typedef struct _oscroute{
     char        **x_prefixes; /* the OSC addresses to be matched */
     int         *x_prefix_depth; /* the number of slashes in each prefix */
     void        **x_outlets; /* one for each prefix plus one for everything else */
+    t_trie      x_trie; /* the literal prefixes */
+    int         *x_any; // "/*" prefixes, matching everything
+    int         x_nany;
+    t_restcache x_cache[REST_CACHE];
 }t_oscroute;
 
 static const char *theWholePattern;  // for warnings
@@ -222,81 +253,182 @@ static int oscroute_count_slashes(char *prefix){ // find the path depth of the p
     return(i);
 }
 
-static void oscroute_doanything(t_oscroute *x, t_symbol *s, int argc, t_atom *argv){
-    char    *pattern, *nextSlash;
-    int     i = 0, pattern_depth = 0, matchedAnything = 0;
-    int     noPath = 0; // nonzero if we are dealing with a simple list (as from a previous [oscroute])
-    pattern = (char *)s->s_name;
-    if (pattern[0] != '/'){
-        /* output unmatched data on rightmost outlet */
-        outlet_anything(x->x_outlets[x->x_num], s, argc, argv);
-        return;
+static int oscroute_segcmp(const char *seg, int len, t_trie *t){
+    int c = memcmp(seg, t->t_seg, len < t->t_len ? len : t->t_len);
+    return(c ? c : len - t->t_len);
+}
+
+static t_trie *oscroute_child(t_trie *t, const char *seg, int len){
+    int lo = 0, hi = t->t_nchildren - 1;
+    while(lo <= hi){
+        int mid = (lo + hi) / 2, c = oscroute_segcmp(seg, len, &t->t_children[mid]);
+        if(!c)
+            return(&t->t_children[mid]);
+        if(c < 0)
+            hi = mid - 1;
+        else
+            lo = mid + 1;
     }
-    pattern_depth = oscroute_count_slashes(pattern);
-    nextSlash = NextSlashOrNull(pattern+1);
-    if (*nextSlash == '\0'){ /* pattern_depth == 1 */
-        /* last level of the address, so we'll output the argument list */
-        for (i = 0; i < x->x_num; ++i){
-            if((x->x_prefix_depth[i] <= pattern_depth) &&
-            (MyPatternMatch(pattern+1, x->x_prefixes[i]+1))){
-                ++matchedAnything;
-                if(noPath){ // just a list starting with a symbol
-                  // The special symbol is s
-                  outlet_anything(x->x_outlets[i], s, argc, argv);
-                }
-                else{ // normal OSC path
-                    // I hate stupid Max lists with a special first element
-                    if(argc == 0)
-                        outlet_bang(x->x_outlets[i]);
-                    else if(argv[0].a_type == A_SYMBOL)
-                        outlet_anything(x->x_outlets[i], argv[0].a_w.w_symbol, argc-1, argv+1);
-                    else if (argc > 1){
-                        // Multiple arguments starting with a number, so naturally we have
-                        // to use a special function to output this "list", since it's what
-                        // Max originally meant by "list".
-                        outlet_list(x->x_outlets[i], 0L, argc, argv);
-                    }
-                    else{
-                        // There was only one argument, and it was a number, so we output it
-                        // not as a list
-                        if (argv[0].a_type == A_FLOAT)
-                            outlet_float(x->x_outlets[i], argv[0].a_w.w_float);
-                        else
-                            pd_error(x, "* oscroute: unrecognized atom type!");
-                    }
-                }
-            }
+    return(NULL);
+}
+
+static void oscroute_trie_add(t_trie *t, const char *prefix, int route){
+    const char *seg = prefix + 1;
+    while(1){
+        int len = (int)(NextSlashOrNull((char *)seg) - seg), i = 0;
+        t_trie *child = oscroute_child(t, seg, len);
+        if(!child){
+            while(i < t->t_nchildren && oscroute_segcmp(seg, len, &t->t_children[i]) > 0)
+                i++;
+            t->t_children = (t_trie *)resizebytes(t->t_children,
+                t->t_nchildren * sizeof(t_trie), (t->t_nchildren + 1) * sizeof(t_trie));
+            memmove(&t->t_children[i+1], &t->t_children[i], (t->t_nchildren - i) * sizeof(t_trie));
+            t->t_nchildren++;
+            child = &t->t_children[i];
+            memset(child, 0, sizeof(*child));
+            child->t_seg = seg;
+            child->t_len = len;
         }
+        t = child;
+        if(seg[len] == '\0')
+            break;
+        seg += len + 1;
+    }
+    t->t_routes = (int *)resizebytes(t->t_routes,
+        t->t_nroutes * sizeof(int), (t->t_nroutes + 1) * sizeof(int));
+    t->t_routes[t->t_nroutes++] = route;
+}
+
+static void oscroute_trie_free(t_trie *t){
+    for(int i = 0; i < t->t_nchildren; i++)
+        oscroute_trie_free(&t->t_children[i]);
+    if(t->t_children)
+        freebytes(t->t_children, t->t_nchildren * sizeof(t_trie));
+    if(t->t_routes)
+        freebytes(t->t_routes, t->t_nroutes * sizeof(int));
+}
+
+// the address past its first 'depth' levels, from the cache if we can
+static t_symbol *oscroute_rest(t_oscroute *x, t_symbol *s, int depth){
+    t_restcache *c = &x->x_cache[(((uintptr_t)s >> 4) + depth * 31) % REST_CACHE];
+    if(c->c_addr != s || c->c_depth != depth){
+        c->c_addr = s;
+        c->c_depth = depth;
+        c->c_rest = gensym(NthSlashOrNull((char *)s->s_name + 1, depth));
     }
-    else{ // There's more address afterwards, so output list begins with next slash.
-        t_symbol *restOfPattern = 0; /* avoid the gensym unless we have to output */
-        char patternBegin[1000];
-        /* Get the incoming pattern to match against all our prefixes */
-        for (i = 0; i < x->x_num; ++i){
-            restOfPattern = 0;
-            if (x->x_prefix_depth[i] <= pattern_depth){
-                StrCopyUntilNthSlash(patternBegin, pattern+1, x->x_prefix_depth[i]);
-                if (MyPatternMatch(patternBegin, x->x_prefixes[i]+1)){
-                    ++matchedAnything;
-                    nextSlash = NthSlashOrNull(pattern+1, x->x_prefix_depth[i]);
-                    if (*nextSlash != '\0'){
-                        restOfPattern = gensym(nextSlash);
-                        outlet_anything(x->x_outlets[i], restOfPattern, argc, argv);
-                    }
-                    else if (argc == 0)
-                        outlet_bang(x->x_outlets[i]);
-                    else
-                    {
-                        if (argv[0].a_type == A_SYMBOL) // Promote the symbol that was argv[0] to the special symbol
-                            outlet_anything(x->x_outlets[i], argv[0].a_w.w_symbol, argc-1, argv+1);
-                        else
-                            outlet_anything(x->x_outlets[i], gensym("list"), argc, argv);
-                    }
-                }
+    return(c->c_rest);
+}
+
+static int oscroute_haswildcard(const char *p){
+    for(; *p; p++)
+        if(strchr("*?[]{}\\", *p))
+            return(1);
+    return(0);
+}
+
+static void oscroute_output(t_oscroute *x, int i, t_symbol *s, int pattern_depth,
+int depth, int argc, t_atom *argv){
+    void *out = x->x_outlets[i];
+    if(pattern_depth == 1){ // last level of the address, so we output the argument list
+        // I hate stupid Max lists with a special first element
+        if(argc == 0)
+            outlet_bang(out);
+        else if(argv[0].a_type == A_SYMBOL)
+            outlet_anything(out, argv[0].a_w.w_symbol, argc-1, argv+1);
+        else if (argc > 1){
+            // Multiple arguments starting with a number, so naturally we have
+            // to use a special function to output this "list", since it's what
+            // Max originally meant by "list".
+            outlet_list(out, 0L, argc, argv);
+        }
+        else{
+            // There was only one argument, and it was a number, so we output it
+            // not as a list
+            if (argv[0].a_type == A_FLOAT)
+                outlet_float(out, argv[0].a_w.w_float);
+            else
+                pd_error(x, "* oscroute: unrecognized atom type!");
+        }
+    }
+    else if(depth < pattern_depth) // output list begins with next slash
+        outlet_anything(out, oscroute_rest(x, s, depth), argc, argv);
+    else if (argc == 0)
+        outlet_bang(out);
+    else{
+        if (argv[0].a_type == A_SYMBOL) // Promote the symbol that was argv[0] to the special symbol
+            outlet_anything(out, argv[0].a_w.w_symbol, argc-1, argv+1);
+        else
+            outlet_anything(out, gensym("list"), argc, argv);
+    }
+}
+
+// walk down the trie along the address, collecting the prefixes on the way
+static int oscroute_literal(t_oscroute *x, const char *pattern, t_match *m){
+    int n = 0, depth = 0;
+    for(int i = 0; i < x->x_nany; i++){
+        m[n].m_route = x->x_any[i];
+        m[n++].m_depth = 1;
+    }
+    t_trie *t = &x->x_trie;
+    const char *seg = pattern + 1;
+    while(1){
+        int len = (int)(NextSlashOrNull((char *)seg) - seg);
+        if(!(t = oscroute_child(t, seg, len)))
+            break;
+        depth++;
+        for(int i = 0; i < t->t_nroutes; i++){
+            m[n].m_route = t->t_routes[i];
+            m[n++].m_depth = depth;
+        }
+        if(seg[len] == '\0')
+            break;
+        seg += len + 1;
+    }
+    // outlets fire in the order of the arguments
+    for(int i = 1; i < n; i++){
+        t_match tmp = m[i];
+        int j = i;
+        for(; j > 0 && m[j-1].m_route > tmp.m_route; j--)
+            m[j] = m[j-1];
+        m[j] = tmp;
+    }
+    return(n);
+}
+
+// the incoming address has wildcards, so match it against every prefix
+static int oscroute_pattern(t_oscroute *x, char *pattern, int pattern_depth, t_match *m){
+    int n = 0, size = strlen(pattern) + 1;
+    char buf[MAXPDSTRING], *patternBegin = size > MAXPDSTRING ? (char *)getbytes(size) : buf;
+    for (int i = 0; i < x->x_num; ++i){
+        if (x->x_prefix_depth[i] <= pattern_depth){
+            StrCopyUntilNthSlash(patternBegin, pattern+1, x->x_prefix_depth[i]);
+            if (MyPatternMatch(patternBegin, x->x_prefixes[i]+1)){
+                m[n].m_route = i;
+                m[n++].m_depth = x->x_prefix_depth[i];
             }
         }
     }
-    if (!matchedAnything)
+    if(patternBegin != buf)
+        freebytes(patternBegin, size);
+    return(n);
+}
+
+static void oscroute_doanything(t_oscroute *x, t_symbol *s, int argc, t_atom *argv){
+    char *pattern = (char *)s->s_name;
+    t_match m[MAX_NUM];
+    if (pattern[0] != '/'){
+        /* output unmatched data on rightmost outlet */
+        outlet_anything(x->x_outlets[x->x_num], s, argc, argv);
+        return;
+    }
+    int pattern_depth = oscroute_count_slashes(pattern), n;
+    if(oscroute_haswildcard(pattern))
+        n = oscroute_pattern(x, pattern, pattern_depth, m);
+    else
+        n = oscroute_literal(x, pattern, m);
+    for(int i = 0; i < n; i++)
+        oscroute_output(x, m[i].m_route, s, pattern_depth, m[i].m_depth, argc, argv);
+    if (!n)
         // output unmatched data on rightmost outlet a la normal 'route' object, jdl 20020908
         outlet_anything(x->x_outlets[x->x_num], s, argc, argv);
 }
@@ -326,6 +458,8 @@ static void oscroute_free(t_oscroute *x){
     freebytes(x->x_prefixes, x->x_num*sizeof(char *)); /* the OSC addresses to be matched */
     freebytes(x->x_prefix_depth, x->x_num*sizeof(int));  /* the number of slashes in each prefix */
     freebytes(x->x_outlets, (x->x_num+1)*sizeof(void *)); /* one for each prefix plus one for everything else */
+    freebytes(x->x_any, x->x_num*sizeof(int));
+    oscroute_trie_free(&x->x_trie);
 }
 
 static void *oscroute_new(t_symbol *s, int argc, t_atom *argv){
@@ -358,9 +492,17 @@ static void *oscroute_new(t_symbol *s, int argc, t_atom *argv){
     x->x_outlets = (void **)getzbytes((x->x_num+1)*sizeof(void *)); /* one for each prefix plus one for everything else */
 /* put the pointer to the path in x_prefixes */
 /* put the number of levels in x_prefix_depth */
+    x->x_any = (int *)getzbytes(x->x_num*sizeof(int));
+    x->x_nany = 0;
+    memset(&x->x_trie, 0, sizeof(x->x_trie));
+    memset(x->x_cache, 0, sizeof(x->x_cache));
     for (i = 0; i < x->x_num; ++i){
         x->x_prefixes[i] = (char *)argv[i].a_w.w_symbol->s_name;
         x->x_prefix_depth[i] = oscroute_count_slashes(x->x_prefixes[i]);
+        if(!strcmp(x->x_prefixes[i], "/*")) // see MyPatternMatch()
+            x->x_any[x->x_nany++] = i;
+        else
+            oscroute_trie_add(&x->x_trie, x->x_prefixes[i], i);
     }
     /* Have to create the outlets in reverse order */
     /* well, not in pd ? */
@@ -2,106 +2,198 @@
 
 #include "m_pd.h"
 
+// Pending messages are kept in a heap ordered by output time, driven by a
+// single clock set to the earliest one. Hangs are recycled in a free list
+// and hold short messages inline, so nothing gets allocated once it warms up.
+
+#define HANG_ATOMS 8 // atoms stored inline in a hang
+
 static t_class *pipe2_class;
 
-typedef struct _hang
-{
-    t_clock             *h_clock;
-    struct _hang        *h_next;
-    struct _pipe2    *h_owner;
-    int                 h_n; /* number of atoms in h_list */
-    t_atom              *h_atoms; /* pointer to a list of h_n t_atoms */
+typedef struct _hang{
+    struct _hang    *h_next;    // next in the free list
+    double           h_time;    // logical time to output
+    unsigned int     h_seq;     // keeps same time hangs in arrival order
+    int              h_any;     // h_atoms[0] is a selector
+    int              h_n;       // number of atoms in h_atoms
+    int              h_size;    // room in h_atoms
+    t_atom          *h_atoms;   // h_inline or allocated when bigger
+    t_atom           h_inline[HANG_ATOMS];
 }t_hang;
 
 typedef struct _pipe2{
     t_object    x_obj;
     float       x_deltime;
-    t_outlet    *x_pipe2out;
-    t_hang      *x_hang;
+    t_outlet   *x_pipe2out;
+    t_clock    *x_clock;
+    t_hang    **x_heap;
+    int         x_nheap;
+    int         x_heapsize;
+    t_hang     *x_pool;
+    unsigned int x_seq;
 }t_pipe2;
 
-static void *pipe2_new(t_symbol *s, int argc, t_atom *argv);
-static void pipe2_hang_free(t_hang *h);
-static void pipe2_hang_tick(t_hang *h);
-static void pipe2_any_hang_tick(t_hang *h);
-static void pipe2_list(t_pipe2 *x, t_symbol *s, int ac, t_atom *av);
-static void pipe2_anything(t_pipe2 *x, t_symbol *s, int ac, t_atom *av);
-void pipe2_setup(void);
-
-static void pipe2_hang_tick(t_hang *h){
-    t_pipe2  *x = h->h_owner;
-    t_hang      *h2, *h3;
-    /* excise h from the linked list of hangs */
-    if (x->x_hang == h) x->x_hang = h->h_next;
-    else for (h2 = x->x_hang; ((h3 = h2->h_next)!=NULL); h2 = h3){
-        if (h3 == h){
-            h2->h_next = h3->h_next;
+static int pipe2_before(t_hang *a, t_hang *b){
+    return(a->h_time < b->h_time || (a->h_time == b->h_time
+        && (int)(a->h_seq - b->h_seq) < 0));
+}
+
+static void pipe2_push(t_pipe2 *x, t_hang *h){
+    if(x->x_nheap == x->x_heapsize){
+        int size = x->x_heapsize ? x->x_heapsize * 2 : 64;
+        x->x_heap = (t_hang **)resizebytes(x->x_heap,
+            x->x_heapsize * sizeof(t_hang *), size * sizeof(t_hang *));
+        x->x_heapsize = size;
+    }
+    t_hang **heap = x->x_heap;
+    int i = x->x_nheap++;
+    while(i > 0){ // sift up
+        int parent = (i - 1) / 2;
+        if(!pipe2_before(h, heap[parent]))
             break;
-        }
+        heap[i] = heap[parent];
+        i = parent;
     }
-    /* output h's list */
-    outlet_list(x->x_pipe2out, &s_list, h->h_n, h->h_atoms);
-    /* free h */
-    pipe2_hang_free(h);
-}
-
-static void pipe2_any_hang_tick(t_hang *h){
-    t_pipe2  *x = h->h_owner;
-    t_hang      *h2, *h3;
-    /* excise h from the linked list of hangs */
-    if (x->x_hang == h) x->x_hang = h->h_next;
-    else for (h2 = x->x_hang; ((h3 = h2->h_next)!=NULL); h2 = h3){
-        if (h3 == h){
-            h2->h_next = h3->h_next;
+    heap[i] = h;
+}
+
+static t_hang *pipe2_pop(t_hang **heap, int *n){
+    t_hang *top = heap[0], *last = heap[--*n];
+    int i = 0;
+    while(1){ // sift down
+        int child = 2*i + 1;
+        if(child >= *n)
             break;
-        }
+        if(child + 1 < *n && pipe2_before(heap[child+1], heap[child]))
+            child++;
+        if(!pipe2_before(heap[child], last))
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if(*n)
+        heap[i] = last;
+    return(top);
+}
+
+static t_hang *pipe2_hang_get(t_pipe2 *x, int n){
+    t_hang *h = x->x_pool;
+    if(h)
+        x->x_pool = h->h_next;
+    else{
+        h = (t_hang *)getbytes(sizeof(t_hang));
+        h->h_atoms = h->h_inline;
+        h->h_size = HANG_ATOMS;
+    }
+    if(n > h->h_size){
+        if(h->h_atoms != h->h_inline)
+            freebytes(h->h_atoms, h->h_size * sizeof(t_atom));
+        h->h_atoms = (t_atom *)getbytes(n * sizeof(t_atom));
+        h->h_size = n;
+    }
+    h->h_n = n;
+    return(h);
+}
+
+static void pipe2_hang_release(t_pipe2 *x, t_hang *h){
+    h->h_next = x->x_pool;
+    x->x_pool = h;
+}
+
+static void pipe2_hang_free(t_hang *h){
+    if(h->h_atoms != h->h_inline)
+        freebytes(h->h_atoms, h->h_size * sizeof(t_atom));
+    freebytes(h, sizeof(t_hang));
+}
+
+static void pipe2_output(t_pipe2 *x, t_hang *h){
+    if(h->h_any)
+        outlet_anything(x->x_pipe2out, h->h_atoms[0].a_w.w_symbol, h->h_n-1, &h->h_atoms[1]);
+    else
+        outlet_list(x->x_pipe2out, &s_list, h->h_n, h->h_atoms);
+}
+
+static void pipe2_reschedule(t_pipe2 *x){
+    if(x->x_nheap)
+        clock_set(x->x_clock, x->x_heap[0]->h_time);
+    else
+        clock_unset(x->x_clock);
+}
+
+// output everything that's due, a hang is only recycled after its output
+// so whatever that triggers back into us can't touch it
+static void pipe2_tick(t_pipe2 *x){
+    double now = clock_getlogicaltime();
+    while(x->x_nheap && x->x_heap[0]->h_time <= now){
+        t_hang *h = pipe2_pop(x->x_heap, &x->x_nheap);
+        pipe2_output(x, h);
+        pipe2_hang_release(x, h);
     }
-    /* output h's atoms */
-    outlet_anything(x->x_pipe2out, h->h_atoms[0].a_w.w_symbol, h->h_n-1, &h->h_atoms[1]);
-    /* free h */
-    pipe2_hang_free(h);
+    pipe2_reschedule(x);
+}
+
+static void pipe2_schedule(t_pipe2 *x, t_hang *h){
+    h->h_time = clock_getsystimeafter(x->x_deltime);
+    h->h_seq = x->x_seq++;
+    pipe2_push(x, h);
+    if(x->x_heap[0] == h)
+        clock_set(x->x_clock, h->h_time);
 }
 
 static void pipe2_list(t_pipe2 *x, t_symbol *s, int ac, t_atom *av){
     s = NULL;
-    if (x->x_deltime > 0){ // if delay is real, save the list for output in delay milliseconds
-        t_hang *h;
-        int i;
-        h = (t_hang *)getbytes(sizeof(t_hang));
-        h->h_n = ac;
-        h->h_atoms = (t_atom *)getbytes(h->h_n*sizeof(t_atom));
-        for(i = 0; i < h->h_n; ++i)
+    if(x->x_deltime > 0){ // if delay is real, save the list for output in delay milliseconds
+        t_hang *h = pipe2_hang_get(x, ac);
+        for(int i = 0; i < ac; i++)
             h->h_atoms[i] = av[i];
-        h->h_next = x->x_hang;
-        x->x_hang = h;
-        h->h_owner = x;
-        h->h_clock = clock_new(h, (t_method)pipe2_hang_tick);
-        clock_delay(h->h_clock, (x->x_deltime >= 0 ? x->x_deltime : 0));
+        h->h_any = 0;
+        pipe2_schedule(x, h);
     }
     else // otherwise just pass the list straight through
         outlet_list(x->x_pipe2out, &s_list, ac, av);
 }
 
 static void pipe2_anything(t_pipe2 *x, t_symbol *s, int ac, t_atom *av){
-    if (x->x_deltime > 0){ // if delay is real, save the list for output in delay milliseconds
-        t_hang *h;
-        int i;
-        h = (t_hang *)getbytes(sizeof(t_hang));
-        h->h_n = ac+1;
-        h->h_atoms = (t_atom *)getbytes(h->h_n*sizeof(t_atom));
+    if(x->x_deltime > 0){ // if delay is real, save the message for output in delay milliseconds
+        t_hang *h = pipe2_hang_get(x, ac+1);
         SETSYMBOL(&h->h_atoms[0], s);
-        for(i = 1; i < h->h_n; ++i)
-            h->h_atoms[i] = av[i-1];
-        h->h_next = x->x_hang;
-        x->x_hang = h;
-        h->h_owner = x;
-        h->h_clock = clock_new(h, (t_method)pipe2_any_hang_tick);
-        clock_delay(h->h_clock, (x->x_deltime >= 0 ? x->x_deltime : 0));
+        for(int i = 0; i < ac; i++)
+            h->h_atoms[i+1] = av[i];
+        h->h_any = 1;
+        pipe2_schedule(x, h);
     }
     else  // otherwise just pass it straight through
         outlet_anything(x->x_pipe2out, s, ac, av);
 }
 
+// outputs in time order what's pending now, messages that come back in
+// while flushing go to a new heap and wait for their own time
+static void pipe2_flush(t_pipe2 *x){
+    t_hang **heap = x->x_heap;
+    int n = x->x_nheap, size = x->x_heapsize;
+    x->x_heap = NULL;
+    x->x_nheap = x->x_heapsize = 0;
+    clock_unset(x->x_clock);
+    while(n){
+        t_hang *h = pipe2_pop(heap, &n);
+        pipe2_output(x, h);
+        pipe2_hang_release(x, h);
+    }
+    if(!x->x_heap){ // keep the old one if nothing came in
+        x->x_heap = heap;
+        x->x_heapsize = size;
+    }
+    else if(heap)
+        freebytes(heap, size * sizeof(t_hang *));
+}
+
+static void pipe2_clear(t_pipe2 *x){
+    for(int i = 0; i < x->x_nheap; i++)
+        pipe2_hang_release(x, x->x_heap[i]);
+    x->x_nheap = 0;
+    clock_unset(x->x_clock);
+}
+
 static void *pipe2_new(t_symbol *s, int argc, t_atom *argv){
     s = NULL;
     t_pipe2  *x = (t_pipe2 *)pd_new(pipe2_class);
@@ -120,22 +212,24 @@ static void *pipe2_new(t_symbol *s, int argc, t_atom *argv){
         deltime = 0;
     x->x_pipe2out = outlet_new(&x->x_obj, &s_list);
     floatinlet_new(&x->x_obj, &x->x_deltime);
-    x->x_hang = NULL;
+    x->x_clock = clock_new(x, (t_method)pipe2_tick);
+    x->x_heap = NULL;
+    x->x_nheap = x->x_heapsize = 0;
+    x->x_pool = NULL;
+    x->x_seq = 0;
     x->x_deltime = deltime;
     return (x);
 }
 
-static void pipe2_hang_free(t_hang *h){
-    freebytes(h->h_atoms, h->h_n*sizeof(t_atom));
-    clock_free(h->h_clock);
-    freebytes(h, sizeof(t_hang));
-}
-
 static void pipe2_free(t_pipe2 *x){
-    t_hang *hang;
-    while ((hang = x->x_hang) != NULL){
-        x->x_hang = hang->h_next;
-        pipe2_hang_free(hang);
+    pipe2_clear(x);
+    clock_free(x->x_clock);
+    if(x->x_heap)
+        freebytes(x->x_heap, x->x_heapsize * sizeof(t_hang *));
+    t_hang *h;
+    while((h = x->x_pool) != NULL){
+        x->x_pool = h->h_next;
+        pipe2_hang_free(h);
     }
 }
 
@@ -144,4 +238,6 @@ void pipe2_setup(void){
         (t_method)pipe2_free, sizeof(t_pipe2), 0, A_GIMME, 0);
     class_addlist(pipe2_class, pipe2_list);
     class_addanything(pipe2_class, pipe2_anything);
+    class_addmethod(pipe2_class, (t_method)pipe2_flush, gensym("flush"), 0);
+    class_addmethod(pipe2_class, (t_method)pipe2_clear, gensym("clear"), 0);
 }
@@ -5,13 +5,19 @@
 #include <string.h>
 #include <random.h>
 
+// The weights left to draw from are kept in a Fenwick tree (binary indexed
+// tree), so a draw is a walk down from its root and taking one out in
+// unrepeat mode or changing a single weight is O(log n) too. Memory only
+// depends on the histogram size, not on how large the weights are.
+
 typedef struct _rand_hist{
     t_object       x_obj;
     int            x_size;       // histogram size
-    int            x_n;          // number of values with a probability weigth
+    int            x_n;          // sum of the weights we draw from
     int           *x_probs;      // array with probability weigths
     int           *x_ovalues;    // array with number of times a value was output
-    int           *x_candidates; // array of candidates
+    int           *x_tree;       // Fenwick tree of the weights, 1 based
+    int            x_top;        // highest power of 2 <= x_size
     int            x_id;
     int            x_u_mode;
     t_random_state x_rstate;
@@ -24,23 +30,72 @@ static void rand_hist_seed(t_rand_hist *x, t_symbol *s, int ac, t_atom *av){
     random_init(&x->x_rstate, get_seed(s, ac, av, x->x_id));
 }
 
-static void update_candidates(t_rand_hist *x){ // update candidates
-    x->x_n = 0; // number of eligible values
-    for(int i = 0; i < x->x_size; i++) // get number of eligible values
-        x->x_n += (*(x->x_probs+i) - *(x->x_ovalues+i));
-    if(!x->x_n)
-        return;
-    x->x_candidates = (int*)getbytes(x->x_n*sizeof(int)); // init candidates array
-    for(int i = 0, n = 0; i < x->x_size; i++){ // populate candidates
-        int dif = *(x->x_probs+i) - *(x->x_ovalues+i);
-        while(dif--)
-            *(x->x_candidates+n++) = i;
+static int rand_hist_weight(t_rand_hist *x, int i){
+    int w = x->x_probs[i] - (x->x_u_mode ? x->x_ovalues[i] : 0);
+    return(w < 0 ? 0 : w);
+}
+
+static void update_candidates(t_rand_hist *x){ // rebuild the tree in O(n)
+    int *tree = x->x_tree;
+    x->x_n = 0;
+    for(int i = 1; i <= x->x_size; i++){
+        tree[i] = rand_hist_weight(x, i-1);
+        x->x_n += tree[i];
+    }
+    for(int i = 1; i <= x->x_size; i++){
+        int j = i + (i & -i);
+        if(j <= x->x_size)
+            tree[j] += tree[i];
     }
 }
 
-static void rand_hist_bang(t_rand_hist *x){
-    if(x->x_u_mode)
+static void rand_hist_add(t_rand_hist *x, int i, int d){
+    for(i++; i <= x->x_size; i += i & -i)
+        x->x_tree[i] += d;
+    x->x_n += d;
+}
+
+// index of the n-th unit of weight, counting from 0 in index order
+static int rand_hist_find(t_rand_hist *x, int n){
+    int i = 0;
+    for(int step = x->x_top; step; step >>= 1){
+        if(i + step <= x->x_size && x->x_tree[i + step] <= n){
+            i += step;
+            n -= x->x_tree[i];
+        }
+    }
+    return(i);
+}
+
+// weight of a single index changed, reset the memory in unrepeat mode
+static void rand_hist_changed(t_rand_hist *x, int i, int old){
+    if(x->x_u_mode){
+        memset(x->x_ovalues, 0x0, x->x_size*sizeof(int));
         update_candidates(x);
+    }
+    else
+        rand_hist_add(x, i, x->x_probs[i] - old);
+}
+
+// weights all changed, reset the memory in unrepeat mode
+static void rand_hist_reset(t_rand_hist *x){
+    if(x->x_u_mode)
+        memset(x->x_ovalues, 0x0, x->x_size*sizeof(int));
+    update_candidates(x);
+}
+
+static void rand_hist_resize(t_rand_hist *x, int n){
+    if(n != x->x_size){
+        x->x_probs = (int*)resizebytes(x->x_probs, x->x_size*sizeof(int), n*sizeof(int));
+        x->x_ovalues = (int*)resizebytes(x->x_ovalues, x->x_size*sizeof(int), n*sizeof(int));
+        x->x_tree = (int*)resizebytes(x->x_tree, (x->x_size+1)*sizeof(int), (n+1)*sizeof(int));
+        x->x_size = n;
+    }
+    for(x->x_top = 1; x->x_top*2 <= n; x->x_top *= 2);
+    memset(x->x_ovalues, 0x0, x->x_size*sizeof(int));
+}
+
+static void rand_hist_bang(t_rand_hist *x){
     if(!x->x_n){
         post("[rand.hist]: probabilities are null");
         return;
@@ -52,13 +107,14 @@ static void rand_hist_bang(t_rand_hist *x){
     int n = (int)(noise * x->x_n);
     if(n >= x->x_n)
         n = x->x_n-1;
-    int v = *(x->x_candidates+n);
+    int v = rand_hist_find(x, n);
     outlet_float(x->x_obj.ob_outlet, v);
     if(x->x_u_mode){
         *(x->x_ovalues+v) += 1;
-        if(x->x_n == 1){ // end
+        rand_hist_add(x, v, -1);
+        if(!x->x_n){ // end
             outlet_bang(x->x_bang_outlet);
-            memset(x->x_ovalues, 0x0, x->x_size*sizeof(int));
+            rand_hist_reset(x);
         }
     }
 }
@@ -66,15 +122,9 @@ static void rand_hist_bang(t_rand_hist *x){
 static void rand_hist_size(t_rand_hist *x, t_float f){ // set histogram size
     int n = f < 1 ? 1 : (int)f;
     if(n != x->x_size){
-        x->x_probs = (int*)getbytes((x->x_size=n)*sizeof(int));
-        x->x_ovalues = (int*)getbytes((x->x_size=n)*sizeof(int));
-        memset(x->x_ovalues, 0x0, x->x_size*sizeof(int));
-        for(int i = 0; i < x->x_size; i++) // ????
-            *(x->x_probs+i) = 0;
-        if(!x->x_u_mode)
-            update_candidates(x);
-        else
-            memset(x->x_ovalues, 0x0, x->x_size*sizeof(int));
+        rand_hist_resize(x, n);
+        memset(x->x_probs, 0x0, x->x_size*sizeof(int));
+        update_candidates(x);
     }
 }
 
@@ -83,16 +133,12 @@ static void rand_hist_list(t_rand_hist *x, t_symbol*s, int ac, t_atom *av){
     if(!ac)
         rand_hist_bang(x);
     else{
-        x->x_size = ac;
-        x->x_probs = (int*)getbytes(x->x_size*sizeof(int));
-        x->x_ovalues = (int*)getbytes(x->x_size*sizeof(int));
+        rand_hist_resize(x, ac);
         for(int i = 0; i < x->x_size; i++){
-            int v = (int)av[i].a_w.w_float;
+            int v = (int)atom_getfloat(av+i);
             *(x->x_probs + i) = v < 0 ? 0 : v;
         }
-        memset(x->x_ovalues, 0x0, x->x_size*sizeof(int));
-        if(!x->x_u_mode)
-            update_candidates(x);
+        update_candidates(x);
     }
 }
 
@@ -100,10 +146,7 @@ static void rand_hist_unrepeat(t_rand_hist *x, t_float f){
     int mode = (int)(f != 0);
     if(x->x_u_mode != mode){
         x->x_u_mode = mode;
-        if(x->x_u_mode)
-            memset(x->x_ovalues, 0x0, x->x_size*sizeof(int));
-        else
-            update_candidates(x);
+        rand_hist_reset(x);
     }
 }
 
@@ -113,11 +156,9 @@ static void rand_hist_set(t_rand_hist *x, t_float f, t_float v){
         post("[rand.hist]: %d not available", i);
         return;
     }
+    int old = x->x_probs[i];
     *(x->x_probs+i) = v < 0 ? 0 : (int)v;
-    if(!x->x_u_mode)
-        update_candidates(x);
-    else
-        memset(x->x_ovalues, 0x0, x->x_size*sizeof(int));
+    rand_hist_changed(x, i, old);
 }
 
 static void rand_hist_inc(t_rand_hist *x, t_float f){
@@ -127,10 +168,7 @@ static void rand_hist_inc(t_rand_hist *x, t_float f){
         return;
     }
     *(x->x_probs+v) += 1;
-    if(!x->x_u_mode)
-        update_candidates(x);
-    else
-        memset(x->x_ovalues, 0x0, x->x_size*sizeof(int));
+    rand_hist_changed(x, v, x->x_probs[v]-1);
 }
 
 static void rand_hist_dec(t_rand_hist *x, t_float f){
@@ -139,35 +177,28 @@ static void rand_hist_dec(t_rand_hist *x, t_float f){
         post("[rand.hist]: %d not available", v);
         return;
     }
+    int old = x->x_probs[v];
     if(*(x->x_probs+v))
         *(x->x_probs+v) -= 1;
-    if(!x->x_u_mode)
-        update_candidates(x);
-    else
-        memset(x->x_ovalues, 0x0, x->x_size*sizeof(int));
+    rand_hist_changed(x, v, old);
 }
 
 static void rand_hist_eq(t_rand_hist *x, t_float f){
     int v = f < 0 ? 0 : (int)f;
     for(int i = 0; i < x->x_size; i++)
         *(x->x_probs+i) = v;
-    if(!x->x_u_mode)
-        update_candidates(x);
-    else
-        memset(x->x_ovalues, 0x0, x->x_size*sizeof(int));
+    rand_hist_reset(x);
 }
 
 static void rand_hist_clear(t_rand_hist *x){
-    for(int i = 0; i < x->x_size; i++)
-        *(x->x_probs+i) = 0;
-    if(!x->x_u_mode)
-        update_candidates(x);
-    else
-        memset(x->x_ovalues, 0x0, x->x_size*sizeof(int));
+    memset(x->x_probs, 0x0, x->x_size*sizeof(int));
+    rand_hist_reset(x);
 }
 
 static void rand_hist_restart(t_rand_hist *x){
     memset(x->x_ovalues, 0x0, x->x_size*sizeof(int));
+    if(x->x_u_mode)
+        update_candidates(x);
 }
 
 static t_rand_hist *rand_hist_new(t_symbol *s, int ac, t_atom *av){
@@ -226,19 +257,17 @@ static t_rand_hist *rand_hist_new(t_symbol *s, int ac, t_atom *av){
     }
     if(ac && av[0].a_type == A_FLOAT)
         x->x_size = ac;
-    x->x_probs = (int*)getbytes(x->x_size*sizeof(int));
-    x->x_ovalues = (int*)getbytes(x->x_size*sizeof(int));
-    memset(x->x_ovalues, 0x0, x->x_size*sizeof(int));
+    if(x->x_size < 1)
+        x->x_size = 1;
+    int size = x->x_size;
+    x->x_size = 0;
+    x->x_probs = x->x_ovalues = x->x_tree = NULL;
+    rand_hist_resize(x, size);
     for(int i = 0; i < x->x_size; i++){
-        if(ac){
-            *(x->x_probs+i) = (int)av[i].a_w.w_float;
-            ac--;
-        }
-        else
-            *(x->x_probs+i) = eq;
+        int v = i < ac ? (int)atom_getfloat(av+i) : eq;
+        *(x->x_probs+i) = v < 0 ? 0 : v;
     }
-    if(!x->x_u_mode)
-        update_candidates(x);
+    update_candidates(x);
     outlet_new(&x->x_obj, &s_float);
     x->x_bang_outlet = outlet_new(&x->x_obj, &s_bang);
     return(x);
@@ -250,7 +279,7 @@ errstate:
 static void rand_hist_free(t_rand_hist *x){
     freebytes(x->x_probs, x->x_size*sizeof(int));
     freebytes(x->x_ovalues, x->x_size*sizeof(int));
-    freebytes(x->x_candidates, x->x_n*sizeof(int));
+    freebytes(x->x_tree, (x->x_size+1)*sizeof(int));
 }
 
 void setup_rand0x2ehist(void){
@@ -0,0 +1,184 @@
+// porres 2026
+
+#include "m_pd.h"
+#include "buffer.h"
+#include "sfile.h"
+#include <string.h>
+
+// Holds a named sample store (see buffer.h) that [tabplayer~], [tabreader~],
+// [tabwriter~], [wavetable~] and friends take as an array name. Samples are
+// float32 and contiguous per channel, half of what arrays take on 64 bit Pd.
+
+#define READ_FRAMES 4096
+
+static t_class *store_class, *store_data_class;
+
+typedef struct _sample_store{
+    t_object    x_obj;
+    t_store    *x_store;
+    t_symbol   *x_bound;            // "else-store-<name>", if we got it
+    t_canvas   *x_canvas;
+    int         x_mmap;
+    t_outlet   *x_info;
+}t_sample_store;
+
+// bound objects pick up the new vectors when the dsp chain is rebuilt
+static void store_changed(t_sample_store *x){
+    store_mirror(x->x_store);
+    canvas_update_dsp();
+}
+
+static void store_size(t_sample_store *x, t_floatarg f1, t_floatarg f2){
+    int npts = f1 < 1 ? 1 : (int)f1;
+    int nchans = f2 < 1 ? x->x_store->st_nchans : f2 > buffer_MAXCHANS ? buffer_MAXCHANS : (int)f2;
+    if(!store_alloc(x->x_store, nchans, npts, x->x_mmap, 1)){
+        pd_error(x, "[sample.store]: out of memory");
+        return;
+    }
+    store_changed(x);
+}
+
+static void store_clear(t_sample_store *x){
+    t_store *st = x->x_store;
+    for(int ch = 0; ch < st->st_nchans; ch++)
+        memset(st->st_vectors[ch], 0, st->st_npts * sizeof(float));
+    store_mirror(st);
+}
+
+static void store_mirrorto(t_sample_store *x, t_symbol *s){
+    x->x_store->st_mirror = s != &s_ ? s : NULL;
+    store_mirror(x->x_store);
+}
+
+static void store_read(t_sample_store *x, t_symbol *s){
+    char path[MAXPDSTRING], *bufptr;
+    t_sfinfo info;
+    FILE *fp = NULL;
+    int fd = canvas_open(x->x_canvas, s->s_name, "", path, &bufptr, MAXPDSTRING, 1);
+    if(fd < 0){
+        pd_error(x, "[sample.store]: can't find file '%s'", s->s_name);
+        return;
+    }
+    path[strlen(path)]='/';
+    sys_close(fd);
+    if(!(fp = sys_fopen(path, "rb")) || !sfile_readheader(fp, &info)){
+        if(fp)
+            fclose(fp);
+        pd_error(x, "[sample.store]: '%s': unknown or bad sound file format", s->s_name);
+        return;
+    }
+    if(info.i_nframes > SHARED_INT_MAX || info.i_nchans > buffer_MAXCHANS){
+        fclose(fp);
+        pd_error(x, "[sample.store]: '%s' is too large", s->s_name);
+        return;
+    }
+    t_store *st = x->x_store;
+    int npts = info.i_nframes < 1 ? 1 : (int)info.i_nframes;
+    if(!store_alloc(st, info.i_nchans, npts, x->x_mmap, 0)){
+        fclose(fp);
+        pd_error(x, "[sample.store]: out of memory");
+        return;
+    }
+    int framesize = info.i_nchans * info.i_bytes;
+    unsigned char *raw = (unsigned char *)getbytes(READ_FRAMES * framesize);
+    for(long long onset = 0; onset < info.i_nframes; onset += READ_FRAMES){
+        int got = (int)sfile_read(fp, &info, onset, READ_FRAMES, raw);
+        for(int ch = 0; ch < info.i_nchans; ch++){
+            float *out = st->st_vectors[ch] + onset;
+            unsigned char *p = raw + ch * info.i_bytes;
+            for(int i = 0; i < got; i++, p += framesize)
+                out[i] = sfile_decode(p, &info);
+        }
+        if(got < READ_FRAMES)
+            break;
+    }
+    freebytes(raw, READ_FRAMES * framesize);
+    fclose(fp);
+    store_changed(x);
+    t_atom at[2];
+    SETFLOAT(at, info.i_sr);
+    SETFLOAT(at+1, info.i_nchans);
+    outlet_list(x->x_info, &s_list, 2, at);
+    outlet_float(x->x_obj.ob_outlet, info.i_nframes);
+}
+
+static void store_free(t_sample_store *x){
+    if(x->x_bound)
+        pd_unbind(&x->x_store->st_pd, x->x_bound);
+    x->x_store->st_mirror = NULL;
+    store_release(x->x_store); // whoever still plays from it keeps it
+}
+
+static void *store_new(t_symbol *s, int ac, t_atom *av){
+    s = NULL;
+    t_sample_store *x = (t_sample_store *)pd_new(store_class);
+    t_symbol *name = NULL, *mirror = NULL;
+    int nchans = 1, npts = 1, floatarg = 0;
+    x->x_mmap = 0;
+    while(ac){
+        if(av->a_type == A_SYMBOL){
+            t_symbol *sym = atom_getsymbol(av);
+            if(sym == gensym("-mmap") && !name){
+                x->x_mmap = 1;
+                ac--, av++;
+            }
+            else if(sym == gensym("-mirror") && ac >= 2 && !name){
+                mirror = atom_getsymbol(av+1);
+                ac-=2, av+=2;
+            }
+            else if(!name){
+                name = sym;
+                ac--, av++;
+            }
+            else
+                goto errstate;
+        }
+        else{
+            t_float f = atom_getfloat(av);
+            if(floatarg++ == 0)
+                nchans = f < 1 ? 1 : f > buffer_MAXCHANS ? buffer_MAXCHANS : (int)f;
+            else
+                npts = f < 1 ? 1 : (int)f;
+            ac--, av++;
+        }
+    }
+    if(!name)
+        goto errstate;
+    x->x_canvas = canvas_getcurrent();
+    t_store *st = x->x_store = (t_store *)pd_new(store_data_class);
+    st->st_version = STORE_VERSION;
+    st->st_refs = 1;
+    st->st_name = name;
+    st->st_mirror = mirror;
+    if(!store_alloc(st, nchans, npts, x->x_mmap, 0)){
+        freebytes(st, sizeof(*st));
+        pd_error(x, "[sample.store]: out of memory");
+        return(NULL);
+    }
+    char buf[MAXPDSTRING];
+    snprintf(buf, MAXPDSTRING, "else-store-%s", name->s_name);
+    x->x_bound = gensym(buf);
+    if(x->x_bound->s_thing){
+        pd_error(x, "[sample.store]: '%s' is already defined", name->s_name);
+        x->x_bound = NULL;
+    }
+    else
+        pd_bind(&st->st_pd, x->x_bound);
+    outlet_new(&x->x_obj, &s_float);
+    x->x_info = outlet_new(&x->x_obj, &s_list);
+    return(x);
+    errstate:
+        pd_error(x, "[sample.store]: improper args");
+        return(NULL);
+}
+
+void setup_sample0x2estore(void){
+    store_class = class_new(gensym("sample.store"), (t_newmethod)store_new,
+        (t_method)store_free, sizeof(t_sample_store), 0, A_GIMME, 0);
+    class_addmethod(store_class, (t_method)store_read, gensym("read"), A_SYMBOL, 0);
+    class_addmethod(store_class, (t_method)store_size, gensym("size"), A_FLOAT, A_DEFFLOAT, 0);
+    class_addmethod(store_class, (t_method)store_clear, gensym("clear"), 0);
+    class_addmethod(store_class, (t_method)store_mirrorto, gensym("mirror"), A_DEFSYMBOL, 0);
+    store_data_class = class_new(gensym("sample.store data"), 0, 0,
+        sizeof(t_store), CLASS_PD, 0);
+}
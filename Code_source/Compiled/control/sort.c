@@ -1,8 +1,8 @@
 // Based on matt barber's sort method for cyclone's zl
 
 #include <string.h>
-#include <stdlib.h>
 #include "m_pd.h"
+#include "atomsort.h"
 
 #define INISIZE 128
 #define MAXSIZE 2147483647
@@ -21,82 +21,24 @@ typedef struct _sort{
     t_sortdata  x_outbuf1;
     t_sortdata  x_outbuf2;
     float       x_dir;
+    int         x_stable;   // equal symbols keep their input order
     t_outlet   *x_out2;
 }t_sort;
 
 static t_class *sort_class;
 
-static void swap(t_atom *av, int i, int j){
-	t_atom temp = av[j];
-	av[j] = av[i];
-	av[i] = temp; 
-}
-
-static int compare(t_atom *a1, t_atom *a2){
-	if(a1->a_type == A_FLOAT && a2->a_type == A_SYMBOL)
-		return(-1);
-	else if(a1->a_type == A_SYMBOL && a2->a_type == A_FLOAT)
-		return(1);
-	else if(a1->a_type == A_FLOAT && a2->a_type == A_FLOAT){
-		if(a1->a_w.w_float < a2->a_w.w_float)
-			return(-1);
-		else if(a1->a_w.w_float > a2->a_w.w_float)
-			return(1);
-        else
-            return(0);
-	}
-	else
-		return(strcmp(a1->a_w.w_symbol->s_name, a2->a_w.w_symbol->s_name));
-}
-
-static void sort_qsort(t_sort *x, t_atom *av1, t_atom *av2, int left, int right, float dir){
-    if(left >= right)
-        return;
-    swap(av1, left, (left + right)/2);
-    if(av2)
-    	swap(av2, left, (left + right)/2);
-    int last = left;
-    for(int i = left+1; i <= right; i++){
-        if((dir * compare(av1+i, av1 + left)) < 0){
-            swap(av1, ++last, i);
-            if(av2)
-            	swap(av2, last, i);
-        }
-    }
-    swap(av1, left, last);
-    if(av2) 
-    	swap(av2, left, last);
-    sort_qsort(x, av1, av2, left, last-1, dir);
-    sort_qsort(x, av1, av2, last+1, right, dir);
-}
-
-static void sort_rev(int n, t_atom *av){
-	for(int i = 0, j = n-1; i < n/2; i++, j--)
-		swap(av, i, j);
-}
-
 static void sort_sort(t_sort *x, int natoms, t_atom *buf, int bang){
     x->x_dir = x->x_dir >= 0 ? 1 : -1;
-	if(buf){
-    	t_atom *buf2 = x->x_outbuf2.d_buf;
-    	x->x_outbuf2.d_natoms = natoms;
-    	if(bang){
-    		if(x->x_inbuf1.d_dir != x->x_dir){
-    			x->x_inbuf1.d_dir = x->x_dir;
-    			sort_rev(natoms, buf2);
-    			sort_rev(natoms, buf);
-    		}
-            outlet_list(x->x_out2, &s_list, natoms, buf2);
-            outlet_list(((t_object *)x)->ob_outlet, &s_list, natoms, buf);
-    	}
-    	else{
-			memcpy(buf, x->x_inbuf1.d_buf, natoms*sizeof(*buf));
-			for(int i = 0; i < natoms; i++)
-    			SETFLOAT(&buf2[i], i); // indexes
-    		sort_qsort(x, buf, buf2, 0, natoms-1, x->x_inbuf1.d_dir = x->x_dir);
-            outlet_list(x->x_out2, &s_list, natoms, buf2);
-            outlet_list(((t_object *)x)->ob_outlet, &s_list, natoms, buf);
-		}
+    if(buf){
+        t_atom *buf2 = x->x_outbuf2.d_buf;
+        x->x_outbuf2.d_natoms = natoms;
+        // a bang only sorts again if the direction changed
+        if(!bang || x->x_inbuf1.d_dir != x->x_dir){
+            memcpy(buf, x->x_inbuf1.d_buf, natoms*sizeof(*buf));
+            atomsort(buf, buf2, natoms, x->x_inbuf1.d_dir = x->x_dir, x->x_stable);
+        }
+        outlet_list(x->x_out2, &s_list, natoms, buf2);
+        outlet_list(((t_object *)x)->ob_outlet, &s_list, natoms, buf);
     }
 }
 
@@ -147,6 +89,10 @@ static void sort_anything(t_sort *x, t_symbol *s, int ac, t_atom *av){
     doit(x, 0);
 }
 
+static void sort_stable(t_sort *x, t_floatarg f){
+    x->x_stable = (f != 0);
+}
+
 static void sortdata_free(t_sortdata *d){
     if(d->d_buf != d->d_bufini)
         freebytes(d->d_buf, d->d_size*sizeof(*d->d_buf));
@@ -164,12 +110,18 @@ static void sortdata_init(t_sortdata *d){
     d->d_buf = d->d_bufini;
 }
 
-static void *sort_new(t_floatarg f){
+static void *sort_new(t_symbol *s, int ac, t_atom *av){
+    s = NULL;
     t_sort *x = (t_sort *)pd_new(sort_class);
     sortdata_init(&x->x_inbuf1);
     sortdata_init(&x->x_outbuf1);
     sortdata_init(&x->x_outbuf2);
-    x->x_dir = f;
+    x->x_stable = 0;
+    if(ac && av->a_type == A_SYMBOL && atom_getsymbol(av) == gensym("-stable")){
+        x->x_stable = 1;
+        ac--, av++;
+    }
+    x->x_dir = atom_getfloatarg(0, ac, av);
     floatinlet_new(&x->x_obj, &x->x_dir);
     outlet_new((t_object *)x, &s_list);
     x->x_out2 = outlet_new((t_object *)x, &s_list);
@@ -178,7 +130,8 @@ static void *sort_new(t_floatarg f){
 
 void sort_setup(void){
     sort_class = class_new(gensym("sort"), (t_newmethod)sort_new,
-        (t_method)sort_free, sizeof(t_sort), 0, A_DEFFLOAT, 0);
+        (t_method)sort_free, sizeof(t_sort), 0, A_GIMME, 0);
     class_addlist(sort_class, sort_list);
     class_addanything(sort_class, sort_anything);
+    class_addmethod(sort_class, (t_method)sort_stable, gensym("stable"), A_FLOAT, 0);
 }
@@ -54,10 +54,11 @@ static void tabreader_set(t_tabreader *x, t_symbol *s){
 
 static void tabreader_float(t_tabreader *x, t_float f){
     t_buffer *buf = x->x_buffer;
+    buffer_validate(buf, 1); // 2nd arg for error posting
     t_word *vp = buf->c_vectors[0];
+    float *fp = buf->c_fvectors[0];
     int npts = x->x_loop ? buf->c_npts : buf->c_npts - 1;
-    buffer_validate(buf, 1); // 2nd arg for error posting
-    if(vp){
+    if(vp || fp){
         double index = (double)(f);
         double xpos = x->x_idx ? index : index*npts;
         if(xpos < 0)
@@ -81,12 +82,12 @@ static void tabreader_float(t_tabreader *x, t_float f){
                 ndx2 = x->x_loop ? ndx2 - npts : npts;
         }
         double a = 0, b = 0, c = 0, d = 0;
-        b = (double)vp[ndx].w_float;
+        b = buffer_sample(vp, fp, ndx);
         if(x->x_i_mode){
-            c = (double)vp[ndx1].w_float;
+            c = buffer_sample(vp, fp, ndx1);
             if(x->x_i_mode > 2){
-                a = (double)vp[ndxm1].w_float;
-                d = (double)vp[ndx2].w_float;
+                a = buffer_sample(vp, fp, ndxm1);
+                d = buffer_sample(vp, fp, ndx2);
             }
         }
         float out = b; // no interpolation
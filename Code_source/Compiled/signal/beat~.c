@@ -2,6 +2,21 @@
 
 #include <m_pd.h>
 #include <aubio/src/aubio.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/time.h>
+
+// The analysis runs on a worker thread. The perform routine only copies the
+// input to a ring, the worker takes it a hop at a time and sends the beats
+// back through a second ring, which a clock empties on the scheduler thread.
+
+#define RING_SIZE       65536 // samples, a power of 2
+#define EVENT_SIZE      64    // beats, a power of 2
+#define MAX_HOP_SIZE    (RING_SIZE/4)
+#define WORKER_WAIT     10    // ms, when not woken by the perform routine
+
+#define ring_load(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ring_store(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
 
 static t_class *beat_class;
 
@@ -10,17 +25,28 @@ int DEFAULT_HOP_SIZE = 512;
 int MIN_BUFFER_SIZE = 64;
 
 typedef struct _beat{
-    t_object       x_obj;
-    t_float        x_f;
-    uint_t         x_sr;
-    t_int          x_pos; // frames % blocksize
-    t_int          x_wsize;
-    t_int          x_hopsize;
-    t_int          x_mode;
-    aubio_tempo_t *x_t;
-    fvec_t        *x_vec;
-    fvec_t        *x_out;
-    t_outlet      *x_bpmout;
+    t_object        x_obj;
+    t_float         x_f;
+    uint_t          x_sr;
+    t_int           x_wsize;
+    t_int           x_hopsize;
+    t_int           x_mode;
+    aubio_tempo_t  *x_t;
+    fvec_t         *x_vec;
+    fvec_t         *x_out;
+    t_outlet       *x_bpmout;
+    t_clock        *x_clock;
+    pthread_t       x_thread;
+    pthread_mutex_t x_mutex;    // guards the aubio objects
+    pthread_cond_t  x_cond;
+    int             x_quit;
+    int             x_running;  // the worker was started
+    t_sample        x_ring[RING_SIZE];
+    unsigned int    x_write;    // written by the perform routine only
+    unsigned int    x_read;     // written by the worker only
+    t_float         x_events[EVENT_SIZE]; // bpm at each beat
+    unsigned int    x_evwrite;  // written by the worker only
+    unsigned int    x_evread;   // written by the clock only
 }t_beat;
 
 static const char* modelLabels[9] ={
@@ -35,10 +61,33 @@ static const char* modelLabels[9] ={
     "mkl",
 };
 
-void beat_mode(t_beat *x, t_floatarg f){
-    x->x_mode = f < 0 ? 0 : f > 9 ? 9 : (int)f;
+// make a new tempo object, with the settings of the old one if any. The
+// new sizes are only set here, with the lock, as the worker reads the hop
+// size and fills x_vec with it
+static void beat_renew(t_beat *x, int mode, int wsize, int hop, uint_t sr){
+    smpl_t thresh = 0.3, silence = -70;
+    pthread_mutex_lock(&x->x_mutex);
+    x->x_mode = mode;
+    x->x_wsize = wsize;
+    ring_store(&x->x_hopsize, hop);
+    x->x_sr = sr;
+    if(x->x_t){
+        thresh = aubio_tempo_get_threshold(x->x_t);
+        silence = aubio_tempo_get_silence(x->x_t);
+        del_aubio_tempo(x->x_t);
+    }
+    if(x->x_vec)
+        del_fvec(x->x_vec);
     x->x_t = new_aubio_tempo(modelLabels[x->x_mode],
         x->x_wsize, x->x_hopsize, x->x_sr);
+    aubio_tempo_set_threshold(x->x_t, thresh);
+    aubio_tempo_set_silence(x->x_t, silence);
+    x->x_vec = (fvec_t *)new_fvec(x->x_hopsize);
+    pthread_mutex_unlock(&x->x_mutex);
+}
+
+void beat_mode(t_beat *x, t_floatarg f){
+    beat_renew(x, f < 0 ? 0 : f > 8 ? 8 : (int)f, x->x_wsize, x->x_hopsize, x->x_sr);
     post("[beat~] mode = %s", modelLabels[x->x_mode]);
 }
 
@@ -46,59 +95,130 @@ void beat_window(t_beat *x, t_floatarg f){ // window size
     int size = (int)f;
     if(size < MIN_BUFFER_SIZE)
         size = MIN_BUFFER_SIZE;
-    x->x_wsize = size;
-    x->x_t = new_aubio_tempo(modelLabels[x->x_mode],
-        x->x_wsize, x->x_hopsize, x->x_sr);
+    beat_renew(x, x->x_mode, size, x->x_hopsize, x->x_sr);
 }
 
 void beat_hop(t_beat *x, t_floatarg f){
-    x->x_hopsize = f < MIN_BUFFER_SIZE ? MIN_BUFFER_SIZE : (int)f;
-    x->x_vec = (fvec_t *)new_fvec(x->x_hopsize);
-    x->x_t = new_aubio_tempo(modelLabels[x->x_mode],
-        x->x_wsize, x->x_hopsize, x->x_sr);
+    int hop = f < MIN_BUFFER_SIZE ? MIN_BUFFER_SIZE :
+        f > MAX_HOP_SIZE ? MAX_HOP_SIZE : (int)f;
+    beat_renew(x, x->x_mode, x->x_wsize, hop, x->x_sr);
 }
 
 void beat_thresh(t_beat *x, t_floatarg f){
     float thresh = (f < 0.01) ? 0.01 : (f > 1.) ? 1. : f;
+    pthread_mutex_lock(&x->x_mutex);
     aubio_tempo_set_threshold(x->x_t, thresh);
+    pthread_mutex_unlock(&x->x_mutex);
 }
 
 void beat_silence(t_beat *x, t_floatarg f){
+    pthread_mutex_lock(&x->x_mutex);
     aubio_tempo_set_silence(x->x_t, f);
+    pthread_mutex_unlock(&x->x_mutex);
+}
+
+static void *beat_worker(void *arg){
+    t_beat *x = (t_beat *)arg;
+    pthread_mutex_lock(&x->x_mutex);
+    while(!x->x_quit){
+        unsigned int read = x->x_read, hop = x->x_hopsize;
+        if(ring_load(&x->x_write) - read < hop){
+            struct timeval now;
+            struct timespec until;
+            gettimeofday(&now, NULL);
+            until.tv_sec = now.tv_sec;
+            until.tv_nsec = now.tv_usec * 1000 + WORKER_WAIT * 1000000;
+            if(until.tv_nsec >= 1000000000)
+                until.tv_sec++, until.tv_nsec -= 1000000000;
+            pthread_cond_timedwait(&x->x_cond, &x->x_mutex, &until);
+            continue;
+        }
+        for(unsigned int i = 0; i < hop; i++)
+            fvec_set_sample(x->x_vec, x->x_ring[(read + i) & (RING_SIZE-1)], i);
+        ring_store(&x->x_read, read + hop);
+        uint_t last = aubio_tempo_get_last(x->x_t);
+        aubio_tempo_do(x->x_t, x->x_vec, x->x_out);
+        // a beat right on a hop boundary has no fraction to report in x_out,
+        // but it moves the last beat position all the same
+        if(x->x_out->data[0] || (aubio_tempo_get_last(x->x_t) != last
+        && !aubio_silence_detection(x->x_vec, aubio_tempo_get_silence(x->x_t)))){
+            unsigned int ev = x->x_evwrite;
+            if(ev - ring_load(&x->x_evread) < EVENT_SIZE){ // else the beat is dropped
+                x->x_events[ev & (EVENT_SIZE-1)] = aubio_tempo_get_bpm(x->x_t);
+                ring_store(&x->x_evwrite, ev + 1);
+            }
+        }
+        // let control messages through between hops
+        pthread_mutex_unlock(&x->x_mutex);
+        pthread_mutex_lock(&x->x_mutex);
+    }
+    pthread_mutex_unlock(&x->x_mutex);
+    return(NULL);
+}
+
+static void beat_tick(t_beat *x){
+    unsigned int ev = x->x_evread, end = ring_load(&x->x_evwrite);
+    while(ev != end){
+        t_float bpm = x->x_events[ev & (EVENT_SIZE-1)];
+        ring_store(&x->x_evread, ++ev);
+        outlet_float(x->x_bpmout, bpm);
+    }
 }
 
 static t_int *beat_perform(t_int *w){
     t_beat *x = (t_beat *)(w[1]);
     t_sample *in = (t_sample *)(w[2]);
-    int n = (int)(w[3]);
-    for(int i = 0; i < n; i++){ // write input to datanew
-        fvec_set_sample(x->x_vec, in[i], x->x_pos);
-        if(x->x_pos < x->x_hopsize-1)
-            x->x_pos++;
-        else{  // time for fft
-            aubio_tempo_do(x->x_t, x->x_vec, x->x_out);
-            if(x->x_out->data[0])
-                outlet_float(x->x_bpmout, aubio_tempo_get_bpm(x->x_t));
-            x->x_pos = 0;
+    unsigned int n = (unsigned int)(w[3]);
+    unsigned int write = x->x_write;
+    if(write - ring_load(&x->x_read) <= RING_SIZE - n){ // else the block is dropped
+        unsigned int pos = write & (RING_SIZE-1);
+        unsigned int part = RING_SIZE - pos < n ? RING_SIZE - pos : n;
+        memcpy(x->x_ring + pos, in, part * sizeof(t_sample));
+        memcpy(x->x_ring, in + part, (n - part) * sizeof(t_sample));
+        ring_store(&x->x_write, write + n);
+        if(write + n - ring_load(&x->x_read) >= (unsigned int)ring_load(&x->x_hopsize)
+        && pthread_mutex_trylock(&x->x_mutex) == 0){ // never wait for the worker
+            pthread_cond_signal(&x->x_cond);
+            pthread_mutex_unlock(&x->x_mutex);
         }
     }
+    if(x->x_evread != ring_load(&x->x_evwrite))
+        clock_delay(x->x_clock, 0);
     return(w+4);
 }
 
 static void beat_dsp(t_beat *x, t_signal **sp){
-    x->x_sr = (uint_t)sys_getsr();
-    dsp_add(beat_perform, 3, x, sp[0]->s_vec, sp[0]->s_n);
+    uint_t sr = (uint_t)sp[0]->s_sr;
+    if(sr != x->x_sr)
+        beat_renew(x, x->x_mode, x->x_wsize, x->x_hopsize, sr);
+    dsp_add(beat_perform, 3, x, sp[0]->s_vec, (t_int)sp[0]->s_n);
 }
 
+// also takes a half made object, from a failure in beat_new()
 static void beat_free(t_beat *x){
-    del_aubio_tempo(x->x_t);
-    del_fvec(x->x_out);
-    del_fvec(x->x_vec);
+    if(x->x_running){
+        pthread_mutex_lock(&x->x_mutex);
+        x->x_quit = 1;
+        pthread_cond_signal(&x->x_cond);
+        pthread_mutex_unlock(&x->x_mutex);
+        pthread_join(x->x_thread, NULL);
+        pthread_cond_destroy(&x->x_cond);
+        pthread_mutex_destroy(&x->x_mutex);
+    }
+    if(x->x_clock)
+        clock_free(x->x_clock);
+    if(x->x_t)
+        del_aubio_tempo(x->x_t);
+    if(x->x_out)
+        del_fvec(x->x_out);
+    if(x->x_vec)
+        del_fvec(x->x_vec);
 }
 
 static void *beat_new(t_symbol *s, int ac, t_atom *av){
     s = NULL;
     t_beat *x = (t_beat *)pd_new(beat_class);
+    x->x_running = 0;
     float thresh = 0.3;
     x->x_wsize = DEFAULT_WINDOW_SIZE;
     x->x_hopsize = DEFAULT_HOP_SIZE;
@@ -114,7 +234,7 @@ static void *beat_new(t_symbol *s, int ac, t_atom *av){
             if(sym == gensym("-mode")){
                 if((av)->a_type == A_FLOAT){
                     mode = (int)atom_getfloat(av);
-                    mode = mode < 0 ? 0 : mode > 9 ? 9 : (int)mode;
+                    mode = mode < 0 ? 0 : mode > 8 ? 8 : (int)mode;
                     ac--, av++;
                 }
                 else
@@ -145,21 +265,37 @@ static void *beat_new(t_symbol *s, int ac, t_atom *av){
                     x->x_hopsize = atom_getfloat(av);
                     if(x->x_hopsize < MIN_BUFFER_SIZE)
                         x->x_hopsize = MIN_BUFFER_SIZE;
+                    if(x->x_hopsize > MAX_HOP_SIZE)
+                        x->x_hopsize = MAX_HOP_SIZE;
                     ac--, av++;
                 }
             }
         }
     }
+    x->x_mode = mode;
+    x->x_sr = (uint_t)sys_getsr();
     x->x_t = new_aubio_tempo(modelLabels[mode], x->x_wsize,
-        x->x_hopsize, (uint_t)sys_getsr());
+        x->x_hopsize, x->x_sr);
     aubio_tempo_set_threshold(x->x_t, thresh);
     aubio_tempo_set_silence(x->x_t, silence);
     x->x_out = (fvec_t *)new_fvec(2);
     x->x_vec = (fvec_t *)new_fvec(x->x_hopsize);
     x->x_bpmout = outlet_new(&x->x_obj, &s_float);
+    x->x_clock = clock_new(x, (t_method)beat_tick);
+    pthread_mutex_init(&x->x_mutex, NULL);
+    pthread_cond_init(&x->x_cond, NULL);
+    if(pthread_create(&x->x_thread, NULL, beat_worker, x) != 0){
+        pd_error(x, "[beat~]: couldn't start analysis thread");
+        pthread_cond_destroy(&x->x_cond);
+        pthread_mutex_destroy(&x->x_mutex);
+        pd_free((t_pd *)x);
+        return(NULL);
+    }
+    x->x_running = 1;
     return(void *)x;
 errstate:
     pd_error(x, "[beat~]: improper args");
+    pd_free((t_pd *)x);
     return(NULL);
 }
 
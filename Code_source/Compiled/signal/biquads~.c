@@ -1,4 +1,5 @@
 #include "m_pd.h"
+#include "biquad.h"
 
 #define COEFFS 5   // number of coeffs per filter stage
 #define MAX_COEFFS 250 // defining max number of coeffs to take
@@ -10,22 +11,17 @@ typedef struct _biquads{
     t_object  x_obj;
     t_inlet  *x_coefflet;
     t_outlet *x_outlet;
-    double    x_xnm1[STAGES];
-    double    x_xnm2[STAGES];
-    double    x_ynm1[STAGES];
-    double    x_ynm2[STAGES];
+    t_biquad *x_bq; // STAGES * x_nchans filters, stage major
+    int       x_nchans;
     t_int     x_bypass;
     int 	  x_numfilt; // number of biquad filters
-	double 	  x_coeff[MAX_COEFFS]; // array of coeffs
-// the coeff array is an easy/cheap way of doing this
-// without malloc/calloc-ing - maybe worth changing in the future
 }t_biquads;
 
 void *biquads_new(void);
 
 void biquads_clear(t_biquads *x){
-    for(int i = 0; i < x->x_numfilt; i++)
-        x->x_xnm1[i] = x->x_xnm2[i] = x->x_ynm1[i] = x->x_ynm2[i] = 0.f;
+    for(int i = 0; i < STAGES * x->x_nchans; i++)
+        biquad_clear(&x->x_bq[i]);
 }
 
 void biquads_bypass(t_biquads *x, t_floatarg f){
@@ -41,64 +37,59 @@ static void biquads_list(t_biquads *x, t_symbol *s, int argc, t_atom *argv){
 	int curfilt = 0; // filter counter
 	while(curfilt < numfilt){
         int curidx = COEFFS*curfilt; // current starting index
-        t_float b1 = atom_getfloatarg(curidx, argc, argv);
-        t_float b2 = atom_getfloatarg(curidx+1, argc, argv);
-		t_float a0 = atom_getfloatarg(curidx+2, argc, argv);
-		t_float a1 = atom_getfloatarg(curidx+3, argc, argv);
-		t_float a2 = atom_getfloatarg(curidx+4, argc, argv);
-		x->x_coeff[curidx] = (double)b1;
-		x->x_coeff[curidx+1] = (double)b2;
-		x->x_coeff[curidx+2] = (double)a0;
-		x->x_coeff[curidx+3] = (double)a1;
-		x->x_coeff[curidx+4] = (double)a2;
+        t_biquad_coeffs c;
+        c.b1 = atom_getfloatarg(curidx, argc, argv);
+        c.b2 = atom_getfloatarg(curidx+1, argc, argv);
+		c.a0 = atom_getfloatarg(curidx+2, argc, argv);
+		c.a1 = atom_getfloatarg(curidx+3, argc, argv);
+		c.a2 = atom_getfloatarg(curidx+4, argc, argv);
+        for(int j = 0; j < x->x_nchans; j++)
+            biquad_set(&x->x_bq[curfilt * x->x_nchans + j], &c, 0);
 		curfilt++;
 	};
 }
 
 static t_int * biquads_perform(t_int *w){
     t_biquads *x = (t_biquads *)(w[1]);
-    int nblock = (int)(w[2]);
+    int n = (int)(w[2]);
     t_float *in = (t_float *)(w[3]);
     t_float *out = (t_float *)(w[4]);
-    t_int bypass = x->x_bypass;
+    int chs = x->x_nchans;
     int numfilt = x->x_numfilt;
-    while(nblock--){
-      if(bypass)
-          *out++ = *in++;
-      else{
-          double xn = *in++;
-          int curfilt = 0; // filter section counter
-          while(curfilt < numfilt){
-              int curidx = COEFFS*curfilt; // current starting index
-              double b1 = x->x_coeff[curidx];
-              double b2 = x->x_coeff[curidx+1];
-              double a0 = x->x_coeff[curidx+2];
-              double a1 = x->x_coeff[curidx+3];
-              double a2 = x->x_coeff[curidx+4];
-              double xnm1 = x->x_xnm1[curfilt];
-              double xnm2 = x->x_xnm2[curfilt];
-              double ynm1 = x->x_ynm1[curfilt];
-              double ynm2 = x->x_ynm2[curfilt];
-              double yn = a0*xn + a1*xnm1 + a2*xnm2 + b1*ynm1 + b2*ynm2; // biquad section
-              x->x_xnm2[curfilt] = xnm1;
-              x->x_xnm1[curfilt] = xn;
-              x->x_ynm2[curfilt] = ynm1;
-              x->x_ynm1[curfilt] = yn;
-              xn = yn; // next stage's xn is previous yn!
-              curfilt++; // iterate the filter section counter
-        };
-        *out++ = xn; // xn is the cascaded output
-      };
-  };
-  return(w + 5);
+    if(x->x_bypass || !numfilt){
+        if(in != out)
+            for(int i = 0; i < chs*n; i++)
+                out[i] = in[i];
+        return(w + 5);
+    }
+    // run the cascade a stage at a time over the whole block, the first stage
+    // reads the input and the others filter the output in place
+    for(int curfilt = 0; curfilt < numfilt; curfilt++)
+        biquad_run_mc(&x->x_bq[curfilt * chs], chs, curfilt ? out : in, out, n, n);
+    return(w + 5);
 }
 
 static void biquads_dsp(t_biquads *x, t_signal **sp){
-  dsp_add(biquads_perform, 4, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec);
+    int chs = sp[0]->s_nchans;
+    signal_setmultiout(&sp[1], chs);
+    if(x->x_nchans != chs){ // regroup stages for the new channel count
+        t_biquad *bq = (t_biquad *)getbytes(STAGES * chs * sizeof(*bq));
+        for(int i = 0; i < STAGES; i++){
+            for(int j = 0; j < chs; j++){
+                bq[i*chs + j] = x->x_bq[i * x->x_nchans];
+                biquad_clear(&bq[i*chs + j]);
+            }
+        }
+        freebytes(x->x_bq, STAGES * x->x_nchans * sizeof(*x->x_bq));
+        x->x_bq = bq;
+        x->x_nchans = chs;
+    }
+    dsp_add(biquads_perform, 4, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec);
 }
 
 static void *biquads_free(t_biquads *x){
 	outlet_free(x->x_outlet);
+    freebytes(x->x_bq, STAGES * x->x_nchans * sizeof(*x->x_bq));
 	return (void *)x;
 }
 
@@ -107,17 +98,18 @@ void *biquads_new(void){
   x->x_outlet = outlet_new(&x->x_obj, &s_signal);
   x->x_bypass = 0;
   x->x_numfilt = 0; // setting number of filters to 0 initially bc no coeffs
-  int i;
-  for(i = 0; i < MAX_COEFFS; i++) // zeroing out coeff array
-	x->x_coeff[i] = 0.f;
-  for(i = 0; i < STAGES; i++) // zeroing out filter's memory
-	x->x_xnm1[i] = x->x_xnm2[i] = x->x_ynm1[i] = x->x_ynm2[i] = 0.f;
+  x->x_nchans = 1;
+  x->x_bq = (t_biquad *)getbytes(STAGES * sizeof(*x->x_bq));
+  for(int i = 0; i < STAGES; i++){ // zeroing out coeffs and filter's memory
+    biquad_init(&x->x_bq[i]);
+    x->x_bq[i].c.a0 = x->x_bq[i].target.a0 = 0;
+  }
   return(x);
 }
 
 void biquads_tilde_setup(void){
     biquads_class = class_new(gensym("biquads~"), (t_newmethod)biquads_new,
-        (t_method)biquads_free, sizeof(t_biquads), CLASS_DEFAULT, 0);
+        (t_method)biquads_free, sizeof(t_biquads), CLASS_MULTICHANNEL, 0);
     class_addmethod(biquads_class, nullfn, gensym("signal"), 0);
     class_addmethod(biquads_class, (t_method) biquads_dsp, gensym("dsp"), A_CANT, 0);
     class_addmethod(biquads_class, (t_method) biquads_clear, gensym("clear"), 0);
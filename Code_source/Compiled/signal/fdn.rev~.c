@@ -24,6 +24,13 @@
 #include <string.h>
 #include <math.h>
 
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define FDN_FTZ // flush denormals in hardware instead of checking every sample
+#endif
+
+#define FDN_SUB 64 // maximum sub-block, also bounded by the shortest delay line
+
 typedef  union _isdenorm{
     t_float f;
     uint32_t ui;
@@ -48,14 +55,21 @@ typedef struct fdnctl{
     t_int   *c_tap;         // cirular feed: N+1 pointers: 1 read, (N-1)r/w, 1 write
     t_float *c_time_ms;
     t_int    c_bufsize;
-    t_float *c_vector[2];
-    t_float *c_vectorbuffer;
-    t_int    c_curvector;
+    t_int    c_minlen;      // shortest line in samples
+    t_int    c_hadamard;    // mixing matrix: hadamard or householder (default)
+    t_float *c_state;       // damping filter states
+    t_float *c_mix;
+    t_float *c_block;       // lines read/written a sub-block at a time
+    t_int    c_nouts;
+    t_int    c_nrows;       // outputs that get a row, the rest are silent
+    t_float *c_outsign;     // decorrelated output taps, rows of a hadamard matrix
+    t_float **c_outvec;
 }t_fdnctl;
 
 typedef struct fdn{
     t_object x_obj;
     t_fdnctl x_ctl;
+    t_int    x_mc;
     t_int    x_exp;
     t_float  x_damping;
     t_float  x_t60_lo;
@@ -100,11 +114,17 @@ static void fdn_delsizes(t_fdn *x){
     tap[0] = (start & mask);
     float *length = x->x_ctl.c_time_ms;
     float scale = sys_getsr() * .001f;
-    t_int sum = 0;
+    t_int sum = 0, minlen = mask;
     for(t_int t = 1; t <= x->x_ctl.c_order; t++){
-        sum += (t_int)(length[t-1] * scale); // delay time in samples
+        t_int len = (t_int)(length[t-1] * scale); // delay time in samples
+        if(len < 1)
+            len = 1;
+        if(len < minlen)
+            minlen = len;
+        sum += len;
         tap[t] = (start+sum)&mask;
     }
+    x->x_ctl.c_minlen = minlen;
     if(sum > mask)
         post("[fdn.rev~]: not enough delay memory (this could lead to instability)");
     fdn_setgain(x);
@@ -114,6 +134,12 @@ static void fdn_order(t_fdn *x, t_int order){
     x->x_ctl.c_order = order;
     x->x_ctl.c_leak = -2./ order;
     x->x_ctl.c_input = 1./ sqrt(order); // ???
+// rows from 'order' on are the plain sum or repeat lower rows with these lines
+    t_int nouts = x->x_ctl.c_nouts;
+    x->x_ctl.c_nrows = nouts < order ? nouts : order - 1;
+    if(nouts >= order)
+        post("[fdn.rev~]: only %d decorrelated outputs with %d delay lines, the rest are silent",
+            (int)(order - 1), (int)order);
 }
 
 static void fdn_set(t_fdn *x, t_float size, t_float min, t_float max){
@@ -156,6 +182,13 @@ static void fdn_exp(t_fdn *x, t_float mode){
     x->x_exp = (t_int)(mode != 0);
 }
 
+static void fdn_hadamard(t_fdn *x, t_float mode){
+    x->x_ctl.c_hadamard = (t_int)(mode != 0);
+    t_int order = x->x_ctl.c_order;
+    if(x->x_ctl.c_hadamard && (order & (order - 1)))
+        post("[fdn.rev~]: hadamard matrix needs a power of 2 number of lines, using householder");
+}
+
 static void fdn_list (t_fdn *x,  t_symbol *s, int argc, t_atom *argv){
     t_symbol *dummy = s;
     dummy = NULL;
@@ -193,85 +226,127 @@ static void fdn_print(t_fdn *x){
 static void fdn_clear(t_fdn *x){
     if(x->x_ctl.c_buf)
         memset(x->x_ctl.c_buf, 0, x->x_ctl.c_bufsize * sizeof(float));
-    if(x->x_ctl.c_vectorbuffer)
-        memset(x->x_ctl.c_vectorbuffer, 0, x->x_ctl.c_maxorder * 2 * sizeof(float));
+    if(x->x_ctl.c_state)
+        memset(x->x_ctl.c_state, 0, x->x_ctl.c_maxorder * sizeof(float));
+}
+
+// in place fast walsh-hadamard transform, n is a power of 2 (at least 4)
+static void fdn_fwht(t_float *v, t_int n){
+    for(t_int i = 0; i < n; i += 4){ // first two stages together
+        t_float a = v[i] + v[i+1], b = v[i] - v[i+1];
+        t_float c = v[i+2] + v[i+3], d = v[i+2] - v[i+3];
+        v[i] = a + c;
+        v[i+1] = b + d;
+        v[i+2] = a - c;
+        v[i+3] = b - d;
+    }
+    for(t_int h = 4; h < n; h <<= 1){
+        for(t_int i = 0; i < n; i += 2*h){
+            for(t_int j = i; j < i + h; j++){
+                t_float a = v[j], b = v[j+h];
+                v[j] = a + b;
+                v[j+h] = a - b;
+            }
+        }
+    }
 }
 
 static t_int *fdn_perform(t_int *w){
     t_fdnctl *ctl       = (t_fdnctl *)(w[1]);
     t_int n             = (t_int)(w[2]);
-    t_float *in         = (float *)(w[3]);
-    t_float *outl       = (float *)(w[4]);
-    t_float *outr       = (float *)(w[5]);
+    t_float *in         = (t_float *)(w[3]);
     t_float *gain_in    = ctl->c_gain_in;
     t_float *gain_state = ctl->c_gain_state;
+    t_float *state      = ctl->c_state;
+    t_float *c          = ctl->c_mix;
+    t_float *blk        = ctl->c_block;
     t_int order         = ctl->c_order;
+    t_int maxorder      = ctl->c_maxorder;
     t_int *tap          = ctl->c_tap;
     t_float *buf        = ctl->c_buf;
     t_int mask          = ctl->c_bufsize - 1;
-    t_int i, j;
-    t_float x, y, left, right, z;
-    t_float *cvec, *lvec;
-    t_float save;
-    for(i = 0; i < n; i++){
-        x = *in++;
-        y = 0;
-        left = 0;
-        right = 0;
-// get temporary vector buffers
-        cvec = ctl->c_vector[ctl->c_curvector];
-        lvec = ctl->c_vector[ctl->c_curvector ^ 1];
-        ctl->c_curvector ^= 1;
-// read input vector + get sum and left/right output
-        for(j = 0; j < order;){
-            z = buf[tap[j]];
-            cvec[j] = z;
-            y     += z;
-            left  += z;
-            right += z;
-            j++;
-            z = buf[tap[j]];
-            cvec[j] = z;
-            y     += z;
-            left  -= z;
-            right += z;
-            j++;
-            z = buf[tap[j]];
-            cvec[j] = z;
-            y     += z;
-            left  += z;
-            right -= z;
-            j++;
-            z = buf[tap[j]];
-            cvec[j] = z;
-            y     += z;
-            left  -= z;
-            right -= z;
-            j++;
-        }
-        *outl++ = left;
-        *outr++ = right;
-        y *=  ctl->c_leak; // y == leak to all inputs
-// perform feedback (todo: decouple feedback & permutation)
-        save = cvec[0];
-        for(j = 0; j < order-1; j++)
-            cvec[j] = cvec[j+1] + y + x;
-        cvec[order-1] = save + y + x;
-// apply gain + store result vector in delay lines + increment taps
-        tap[0] = (tap[0] + 1)&mask;
-        for(j = 0; j < order; j++){
-            save = gain_in[j] * cvec[j] + gain_state[j] * lvec[j];
-            save = denorm_check(save) ? 0 : save;
-            cvec[j] = save;
-            buf[tap[j+1]] = save;
-            tap[j+1] = (tap[j+1] + 1) & mask;
+    t_int hadamard      = ctl->c_hadamard && !(order & (order - 1));
+    t_float norm        = 1. / sqrt(order);
+    t_float xin[FDN_SUB];
+    t_int i, j, k, t, m;
+#ifdef FDN_FTZ
+    unsigned int csr = _mm_getcsr();
+    _mm_setcsr(csr | 0x8040); // flush to zero + denormals are zero
+#endif
+// lines are never read closer than their length from where they're written, so
+// a sub-block up to the shortest length can be read first and written at the end
+    for(i = 0; i < n; i += m){
+        m = n - i;
+        if(m > FDN_SUB)
+            m = FDN_SUB;
+        if(m > ctl->c_minlen)
+            m = ctl->c_minlen;
+        for(t = 0; t < m; t++)
+            xin[t] = in[i+t];
+        for(t = 0; t < m; t++)
+            for(j = 0; j < order; j++)
+                blk[t*maxorder + j] = buf[(tap[j] + t) & mask];
+        for(t = 0; t < m; t++){
+            t_float *z = blk + t*maxorder, x = xin[t];
+            for(k = 0; k < ctl->c_nrows; k++){
+                t_float *sign = ctl->c_outsign + k*maxorder, sum = 0;
+                for(j = 0; j < order; j++)
+                    sum += sign[j] * z[j];
+                ctl->c_outvec[k][i+t] = sum;
+            }
+            for(; k < ctl->c_nouts; k++)
+                ctl->c_outvec[k][i+t] = 0;
+            if(hadamard){
+                for(j = 0; j < order; j++)
+                    c[j] = z[j];
+                fdn_fwht(c, order);
+                for(j = 0; j < order; j++)
+                    c[j] = c[j] * norm + x;
+            }
+            else{ // householder (leak to all inputs) + permutation
+                t_float y = 0;
+                for(j = 0; j < order; j++)
+                    y += z[j];
+                y = y * ctl->c_leak + x;
+                for(j = 0; j < order-1; j++)
+                    c[j] = z[j+1] + y;
+                c[order-1] = z[0] + y;
+            }
+// apply gain, the result goes back to the lines
+            for(j = 0; j < order; j++){
+                t_float save = gain_in[j] * c[j] + gain_state[j] * state[j];
+#ifndef FDN_FTZ
+                save = denorm_check(save) ? 0 : save;
+#endif
+                state[j] = z[j] = save;
+            }
         }
+        for(t = 0; t < m; t++)
+            for(j = 0; j < order; j++)
+                buf[(tap[j+1] + t) & mask] = blk[t*maxorder + j];
+        for(j = 0; j <= order; j++)
+            tap[j] = (tap[j] + m) & mask;
     }
-    return(w+6);
+#ifdef FDN_FTZ
+    _mm_setcsr(csr);
+#endif
+    return(w+4);
 }
 
 static void fdn_dsp(t_fdn *x, t_signal **sp){
-  dsp_add(fdn_perform, 5, &x->x_ctl, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec);
+    t_int nouts = x->x_ctl.c_nouts, n = sp[0]->s_n;
+    if(x->x_mc){ // one multichannel outlet
+        signal_setmultiout(&sp[1], nouts);
+        for(t_int k = 0; k < nouts; k++)
+            x->x_ctl.c_outvec[k] = sp[1]->s_vec + k*n;
+    }
+    else{
+        for(t_int k = 0; k < nouts; k++){
+            signal_setmultiout(&sp[k+1], 1);
+            x->x_ctl.c_outvec[k] = sp[k+1]->s_vec;
+        }
+    }
+    dsp_add(fdn_perform, 3, &x->x_ctl, n, sp[0]->s_vec);
 }
 
 static void fdn_free(t_fdn *x){
@@ -285,8 +360,16 @@ static void fdn_free(t_fdn *x){
         free( x->x_ctl.c_gain_state);
     if(x->x_ctl.c_buf)
         free (x->x_ctl.c_buf);
-    if(x->x_ctl.c_vectorbuffer)
-        free (x->x_ctl.c_vectorbuffer);
+    if(x->x_ctl.c_state)
+        free (x->x_ctl.c_state);
+    if(x->x_ctl.c_mix)
+        free (x->x_ctl.c_mix);
+    if(x->x_ctl.c_block)
+        free (x->x_ctl.c_block);
+    if(x->x_ctl.c_outsign)
+        free (x->x_ctl.c_outsign);
+    if(x->x_ctl.c_outvec)
+        free (x->x_ctl.c_outvec);
 }
 
 static void *fdn_new(t_symbol *s, int ac, t_atom *av){
@@ -298,7 +381,10 @@ static void *fdn_new(t_symbol *s, int ac, t_atom *av){
     t_int size = 23;
     t_float t60 = 4;
     t_float damping = 0;
+    t_int nouts = 2;
     x->x_exp = 0;
+    x->x_mc = 0;
+    x->x_ctl.c_hadamard = 0;
 ////////////////////////////////////////////////////////////////////////////////////
     int argnum = 0;
     int flag = 0;
@@ -359,8 +445,26 @@ static void *fdn_new(t_symbol *s, int ac, t_atom *av){
                 else
                     goto errstate;
             }
-            else if(!strcmp(cursym->s_name, "-exp"))
+            else if(!strcmp(cursym->s_name, "-mc")){
+                if(ac >= 2 && (av+1)->a_type == A_FLOAT){
+                    nouts = (int)atom_getfloatarg(1, ac, av);
+                    x->x_mc = 1;
+                    ac -= 2;
+                    av += 2;
+                }
+                else
+                    goto errstate;
+            }
+            else if(!strcmp(cursym->s_name, "-hadamard")){
+                x->x_ctl.c_hadamard = 1;
+                ac--;
+                av++;
+            }
+            else if(!strcmp(cursym->s_name, "-exp")){
                 x->x_exp = 1;
+                ac--;
+                av++;
+            }
             else
                 goto errstate;
         }
@@ -387,11 +491,24 @@ static void *fdn_new(t_symbol *s, int ac, t_atom *av){
     x->x_ctl.c_time_ms = (t_float *)malloc(order * sizeof(t_float));
     x->x_ctl.c_gain_in = (t_float *)malloc(order * sizeof(t_float));
     x->x_ctl.c_gain_state = (t_float *)malloc(order * sizeof(t_float));
-    x->x_ctl.c_vectorbuffer = (t_float *)malloc(order * 2 * sizeof(float));
-    memset(x->x_ctl.c_vectorbuffer, 0, order * 2 * sizeof(float));
-    x->x_ctl.c_curvector = 0;
-    x->x_ctl.c_vector[0] = &x->x_ctl.c_vectorbuffer[0];
-    x->x_ctl.c_vector[1] = &x->x_ctl.c_vectorbuffer[order];
+    x->x_ctl.c_state = (t_float *)malloc(order * sizeof(t_float));
+    x->x_ctl.c_mix = (t_float *)malloc(order * sizeof(t_float));
+    x->x_ctl.c_block = (t_float *)malloc(order * FDN_SUB * sizeof(t_float));
+    if(nouts < 1)
+        nouts = 1;
+    if(nouts > order)
+        nouts = order;
+    x->x_ctl.c_nouts = nouts;
+    x->x_ctl.c_outvec = (t_float **)malloc(nouts * sizeof(t_float *));
+    x->x_ctl.c_outsign = (t_float *)malloc(nouts * order * sizeof(t_float));
+    for(t_int k = 0; k < nouts; k++){ // row k+1, 1 and 2 are the stereo pair
+        for(t_int j = 0; j < order; j++){
+            t_int bits = j & (k+1), sign = 1;
+            for(; bits; bits &= bits - 1)
+                sign = -sign;
+            x->x_ctl.c_outsign[k*order + j] = sign;
+        }
+    }
 // default input list
     t_atom at[8];
     SETFLOAT(at, 7.f);
@@ -407,8 +524,10 @@ static void *fdn_new(t_symbol *s, int ac, t_atom *av){
     fdn_clear(x);
     inlet_new(&x->x_obj, &x->x_obj.ob_pd, gensym("float"), gensym("time"));
     inlet_new(&x->x_obj, &x->x_obj.ob_pd, gensym("float"), gensym("damping"));
-    outlet_new(&x->x_obj, gensym("signal"));
-    outlet_new(&x->x_obj, gensym("signal"));
+    if(x->x_mc)
+        outlet_new(&x->x_obj, gensym("signal"));
+    else for(t_int k = 0; k < nouts; k++)
+        outlet_new(&x->x_obj, gensym("signal"));
     return(void *)x;
 errstate:
     pd_error(x, "[fdn.rev~]: improper args");
@@ -417,7 +536,7 @@ errstate:
 
 void setup_fdn0x2erev_tilde(void){
     fdn_class = class_new(gensym("fdn.rev~"), (t_newmethod)fdn_new,
-    	(t_method)fdn_free, sizeof(t_fdn), 0, A_GIMME, 0);
+    	(t_method)fdn_free, sizeof(t_fdn), CLASS_MULTICHANNEL, A_GIMME, 0);
     class_addmethod(fdn_class, nullfn, gensym("signal"), 0);
     class_addmethod(fdn_class, (t_method)fdn_dsp, gensym("dsp"), A_CANT, 0);
     class_addlist(fdn_class, (t_method)fdn_list);
@@ -426,6 +545,7 @@ void setup_fdn0x2erev_tilde(void){
     class_addmethod(fdn_class, (t_method)fdn_set, gensym("set"),
         A_DEFFLOAT, A_DEFFLOAT, A_DEFFLOAT, 0);
     class_addmethod(fdn_class, (t_method)fdn_exp, gensym("exp"), A_DEFFLOAT, 0);
+    class_addmethod(fdn_class, (t_method)fdn_hadamard, gensym("hadamard"), A_DEFFLOAT, 0);
     class_addmethod(fdn_class, (t_method)fdn_clear, gensym("clear"), 0);
     class_addmethod(fdn_class, (t_method)fdn_print, gensym("print"), 0);
 }
@@ -25,23 +25,18 @@
 #include <math.h>
 #include <string.h>
 
-typedef struct{
-    int    size;
-    int    idx;
-    float *buf;
-}t_fixeddelay;
-
-typedef struct{
-    int    size;
-    float  coeff;
-    int    idx;
-    float *buf;
-}t_diffuser;
+#define GVERB_CHUNK 64 // samples processed per pass through the stages
 
+/* All delay lines of a reverb instance live in one contiguous region of the
+ * arena, one region per channel: the 4 FDN lines interleaved (so the 4 lines
+ * are read and written together), the tapped delay and the 8 diffusers. */
 typedef struct{
-    float  damp;
-    float  delay;
-}t_damper;
+    float  in_damp;         // input damper state
+    float  fdn_damp[4];     // fdn damper states
+    int    fdn_idx;         // write position shared by the 4 fdn lines
+    int    tap_idx;
+    int    dif_idx[8];      // 0-3 left diffusers, 4-7 right diffusers
+}t_gverb_chan;
 
 typedef struct{
     t_object        x_obj;
@@ -54,25 +49,28 @@ typedef struct{
     float           x_maxsize;      // maximum room size
     float           x_size;         // room size
     float           x_decay;        // decay time in seconds
+    float           x_spread;       // 0-100
     float           x_maxdelay;
     float           x_largestdelay;
-    t_damper       *x_in_damper;
-    t_damper      **x_fdndamps;
-    t_fixeddelay  **x_fdndels;
-    t_fixeddelay   *x_tapdelay;
-    float          *x_fdngains;
-    int            *x_fdnlens;
+    float           x_fdngains[4];
+    int             x_fdnlens[4];
     float           x_fdndamp;
-    t_diffuser    **x_ldifs;
-    t_diffuser    **x_rdifs;
-    int            *x_taps;
-    float          *x_tapgains;
-    float          *x_d;
-    float          *x_u;
-    float          *x_f;
+    int             x_taps[4];
+    float           x_tapgains[4];
     double          x_alpha;
+    float          *x_arena;
+    int             x_chsize;       // arena floats per channel
+    int             x_fdncap;
+    int             x_tapcap;
+    int             x_difoff[8];    // diffuser offsets in a channel's region
+    int             x_difcap[8];
+    int             x_difsize[8];
+    t_gverb_chan   *x_ch;
+    int             x_nchans;
 }t_gverb;
 
+static const float gverb_difcoeff[4] = {0.75, 0.75, 0.625, 0.625};
+
 void *gverb_class;
 
 /* This FDN reverb can be smoothened by setting the matrix elements at the
@@ -102,70 +100,6 @@ static inline void gverb_fdn_matrix(float *a, float *b){
     b[3] = 0.5f*(+dl0 + dl1 + dl2 + dl3);
 }
 
-static inline float diffuser_do(t_diffuser *d, float f){
-    f = f - d->buf[d->idx]*d->coeff;
-    if(PD_BADFLOAT(f)) f = 0.0f;
-    float y = d->buf[d->idx] + f*d->coeff;
-    d->buf[d->idx] = f;
-    d->idx = (d->idx + 1) % d->size;
-    return(y);
-}
-
-static inline float fixeddelay_read(t_fixeddelay *d, int n){
-    int i = (d->idx - n + d->size) % d->size;
-    return(d->buf[i]);
-}
-
-static inline void fixeddelay_write(t_fixeddelay *d, float f){
-    if(PD_BADFLOAT(f)) f = 0.0f;
-    d->buf[d->idx] = f;
-    d->idx = (d->idx + 1) % d->size;
-}
-
-static inline void damper_set(t_damper *d, float f){
-    d->damp = f; // clip?
-}
-
-static inline float damper_do(t_damper *d, float f){
-    d->delay = f*(1.0-d->damp) + d->delay*d->damp;
-    return(d->delay);
-}
-
-static inline void gverb_do(t_gverb *x, float in, float *l, float *r){
-    float z;
-    unsigned int i;
-    float lsum, rsum, sum, sign;
-    if(PD_BADFLOAT(in) || fabsf(in) > 100000.0f) in = 0.0f;
-    z = damper_do(x->x_in_damper, in);
-    z = diffuser_do(x->x_ldifs[0], z);
-    for(i = 0; i < 4; i++)
-        x->x_u[i] = x->x_tapgains[i]*fixeddelay_read(x->x_tapdelay,x->x_taps[i]);
-    fixeddelay_write(x->x_tapdelay, z);
-    for(i = 0; i < 4; i++){
-        x->x_d[i] = damper_do(x->x_fdndamps[i],
-                            x->x_fdngains[i]*fixeddelay_read(x->x_fdndels[i],
-                                                           x->x_fdnlens[i]));
-    }
-    sum = 0.0f;
-    sign = 1.0f;
-    for(i = 0; i < 4; i++){
-        sum += sign*(x->x_late*x->x_d[i] + x->x_early*x->x_u[i]);
-        sign = -sign;
-    }
-    lsum = rsum = (sum += in*x->x_early);
-    gverb_fdn_matrix(x->x_d, x->x_f);
-    for(i = 0; i < 4; i++)
-        fixeddelay_write(x->x_fdndels[i], x->x_u[i]+x->x_f[i]);
-    lsum = diffuser_do(x->x_ldifs[1], lsum);
-    lsum = diffuser_do(x->x_ldifs[2], lsum);
-    lsum = diffuser_do(x->x_ldifs[3], lsum);
-    rsum = diffuser_do(x->x_rdifs[1], rsum);
-    rsum = diffuser_do(x->x_rdifs[2], rsum);
-    rsum = diffuser_do(x->x_rdifs[3], rsum);
-    *l = lsum;
-    *r = rsum;
-}
-
 int isprime(int n){
     const unsigned int lim = (int)sqrtf((float)n);
     if(n == 2) return(1);
@@ -196,103 +130,173 @@ int ff_round(float f){ // Round float to int (faster than f_trunc)
     return *((int*)&f) - 0x4b400000;
 }
 
-t_diffuser *diffuser_make(int size, float coeff){
-    t_diffuser *d = (t_diffuser *)t_getbytes(sizeof(t_diffuser));
-    if(!d) return (NULL);
-    d->size = size;
-    d->coeff = coeff;
-    d->idx = 0;
-    d->buf = (float *)t_getbytes(size*sizeof(float));
-    if(!d->buf) return (NULL);
-    for(int i = 0; i < size; i++) d->buf[i] = 0.0;
-    return(d);
-}
-
-void diffuser_free(t_diffuser *d){
-    t_freebytes(d->buf, d->size*sizeof(float));
-    t_freebytes(d, sizeof(t_diffuser));
-}
-
-void diffuser_clear(t_diffuser *d){
-    memset(d->buf, 0, d->size * sizeof(float));
-}
-
-t_damper *damper_make(float f){
-    t_damper *d = (t_damper *)t_getbytes(sizeof(t_damper));
-    if(!d) return (NULL);
-    d->damp = f;
-    d->delay = 0.0;
-    return(d);
-}
-
-void damper_free(t_damper *d){
-    t_freebytes(d, sizeof(t_damper));
-}
-
-void damper_clear(t_damper *d){
-    d->delay = 0.0f;
-}
-
-void fixeddelay_clear(t_fixeddelay *d){
-    memset(d->buf, 0, d->size * sizeof(float));
+// allpass diffuser over a block, the ring is as long as the delay so it's
+// processed in contiguous runs up to the wrap point
+static void gverb_diffuse(float *buf, int size, int *idxp, float coeff, float *io, int n){
+    int idx = *idxp;
+    while(n > 0){
+        int m = size - idx < n ? size - idx : n;
+        float *b = buf + idx;
+        for(int i = 0; i < m; i++){
+            float f = io[i] - b[i]*coeff;
+            if(PD_BADFLOAT(f))
+                f = 0.0f;
+            io[i] = b[i] + f*coeff;
+            b[i] = f;
+        }
+        io += m, n -= m, idx += m;
+        if(idx == size)
+            idx = 0;
+    }
+    *idxp = idx;
+}
+
+// diffuser lengths for a spread (0-100) and the shortest fdn line
+static void gverb_difsizes(float spread, int fdnlen, int *sizes){
+    static const float r[4] = {0.125541f, 0.854046f, -0.568366f, -0.126815f};
+    float diffscale = (float)fdnlen/(210+159+562+410);
+    float spread2 = 3.0*spread;
+    for(int side = 0; side < 2; side++){
+        int a, b = 210, c, cc, d, dd, e;
+        a = spread*r[2*side];
+        c = 210+159+a;
+        cc = c-b;
+        a = spread2*r[2*side+1];
+        d = 210+159+562+a;
+        dd = d-c;
+        e = 1341-d;
+        sizes[4*side] = (int)(diffscale*b);
+        sizes[4*side+1] = (int)(diffscale*cc);
+        sizes[4*side+2] = (int)(diffscale*dd);
+        sizes[4*side+3] = (int)(diffscale*e);
+    }
+    for(int i = 0; i < 8; i++)
+        if(sizes[i] < 1)
+            sizes[i] = 1;
 }
 
-t_fixeddelay *fixeddelay_make(int size){
-    t_fixeddelay *d = (t_fixeddelay *)t_getbytes(sizeof(t_fixeddelay));
-    if(!d) return (NULL);
-    d->size = size;
-    d->idx = 0;
-    d->buf = (float *)t_getbytes(size*sizeof(float));
-    if(!d->buf) return (NULL);
-    for(int i = 0; i < size; i++)
-        d->buf[i] = 0.0;
-    return(d);
+static void gverb_clearchans(t_gverb *x){
+    memset(x->x_arena, 0, x->x_nchans * x->x_chsize * sizeof(float));
+    memset(x->x_ch, 0, x->x_nchans * sizeof(t_gverb_chan));
 }
 
-void fixeddelay_free(t_fixeddelay *d){
-    t_freebytes(d->buf, d->size*sizeof(float));
-    t_freebytes(d, sizeof(t_diffuser));
+// size the arena regions for the maximum room size
+static void gverb_layout(t_gverb *x, int nchans){
+    int lo[8], hi[8];
+    if(x->x_arena){
+        freebytes(x->x_arena, x->x_nchans * x->x_chsize * sizeof(float));
+        freebytes(x->x_ch, x->x_nchans * sizeof(t_gverb_chan));
+    }
+    x->x_fdncap = (int)x->x_maxdelay + 2;
+    x->x_tapcap = (int)(0.41f*x->x_maxdelay) + 7 + GVERB_CHUNK;
+    int fdnmin = (int)(0.63245f*x->x_maxdelay) + 1;
+    gverb_difsizes(0, fdnmin, lo);
+    gverb_difsizes(100, fdnmin, hi);
+    int off = 4*x->x_fdncap + x->x_tapcap;
+    for(int i = 0; i < 8; i++){
+        x->x_difcap[i] = (lo[i] > hi[i] ? lo[i] : hi[i]) + 1;
+        x->x_difoff[i] = off;
+        off += x->x_difcap[i];
+    }
+    x->x_chsize = off;
+    x->x_nchans = nchans;
+    x->x_arena = (float *)getbytes(nchans * x->x_chsize * sizeof(float));
+    x->x_ch = (t_gverb_chan *)getbytes(nchans * sizeof(t_gverb_chan));
+}
+
+static void gverb_run(t_gverb *x, t_gverb_chan *ch, float *region,
+t_float *in, t_float *outl, t_float *outr, int n){
+    float *fdnbuf = region, *tapbuf = region + 4*x->x_fdncap;
+    int fdncap = x->x_fdncap, tapcap = x->x_tapcap;
+    float bw = x->x_in_bw, damp = x->x_fdndamp;
+    float early = x->x_early, late = x->x_late, dry = x->x_dry, wet = x->x_wet;
+    float xin[GVERB_CHUNK], z[GVERB_CHUNK], u[GVERB_CHUNK][4];
+    float l[GVERB_CHUNK], r[GVERB_CHUNK];
+    for(int i = 0; i < n; i += GVERB_CHUNK){
+        int m = n - i < GVERB_CHUNK ? n - i : GVERB_CHUNK;
+        int j, k;
+    // input damper and first diffuser
+        float zs = ch->in_damp;
+        for(j = 0; j < m; j++){
+            float f = xin[j] = in[i+j];
+            if(PD_BADFLOAT(f) || fabsf(f) > 100000.0f)
+                f = 0.0f;
+            l[j] = f; // cleaned input, for the early reflections sum
+            zs = f*bw + zs*(1.0f-bw);
+            z[j] = zs;
+        }
+        ch->in_damp = zs;
+        gverb_diffuse(region + x->x_difoff[0], x->x_difsize[0], &ch->dif_idx[0],
+            gverb_difcoeff[0], z, m);
+    // tapped delay, written first so taps read this chunk's samples too
+        int w = ch->tap_idx;
+        for(j = 0; j < m; j++){
+            tapbuf[w] = PD_BADFLOAT(z[j]) ? 0.0f : z[j];
+            if(++w == tapcap)
+                w = 0;
+        }
+        for(k = 0; k < 4; k++){
+            int rd = ch->tap_idx - x->x_taps[k];
+            float g = x->x_tapgains[k];
+            if(rd < 0)
+                rd += tapcap;
+            for(j = 0; j < m; j++){
+                u[j][k] = g*tapbuf[rd];
+                if(++rd == tapcap)
+                    rd = 0;
+            }
+        }
+        ch->tap_idx = w;
+    // fdn, the 4 lines are processed together
+        w = ch->fdn_idx;
+        for(j = 0; j < m; j++){
+            float d[4], f[4], sum = l[j]*early;
+            for(k = 0; k < 4; k++){
+                int rd = w - x->x_fdnlens[k];
+                if(rd < 0)
+                    rd += fdncap;
+                float v = x->x_fdngains[k]*fdnbuf[4*rd + k];
+                d[k] = ch->fdn_damp[k] = v*(1.0f-damp) + ch->fdn_damp[k]*damp;
+            }
+            sum += (late*d[0] + early*u[j][0]) - (late*d[1] + early*u[j][1])
+                + (late*d[2] + early*u[j][2]) - (late*d[3] + early*u[j][3]);
+            gverb_fdn_matrix(d, f);
+            for(k = 0; k < 4; k++){
+                float v = u[j][k] + f[k];
+                fdnbuf[4*w + k] = PD_BADFLOAT(v) ? 0.0f : v;
+            }
+            if(++w == fdncap)
+                w = 0;
+            l[j] = r[j] = sum;
+        }
+        ch->fdn_idx = w;
+    // output diffusers
+        for(k = 1; k < 4; k++){
+            gverb_diffuse(region + x->x_difoff[k], x->x_difsize[k],
+                &ch->dif_idx[k], gverb_difcoeff[k], l, m);
+            gverb_diffuse(region + x->x_difoff[k+4], x->x_difsize[k+4],
+                &ch->dif_idx[k+4], gverb_difcoeff[k], r, m);
+        }
+        for(j = 0; j < m; j++){
+            outl[i+j] = xin[j]*dry + l[j]*wet;
+            outr[i+j] = xin[j]*dry + r[j]*wet;
+        }
+    }
 }
 
 // METHODS!!!
 
 static inline void gverb_spread(t_gverb *x, t_floatarg f){
-    float spread1 = (f < 0 ? 0 : f > 1 ? 1 : f) * 100;
-    float spread2 = 3.0*spread1;
-    int a, b = 210, c, cc, d, dd, e;
-// Diffuser section
-    float diffscale = (float)x->x_fdnlens[3]/(210+159+562+410);
-// Left
-    a = spread1*0.125541f;
-    c = 159+a+b;
-    cc = c-b;
-    a = spread2*0.854046f;
-    d = 159+562+a+b;
-    dd = d-c;
-    e = 1341-d;
-    x->x_ldifs[0] = diffuser_make((int)(diffscale*b), 0.75);
-    x->x_ldifs[1] = diffuser_make((int)(diffscale*cc), 0.75);
-    x->x_ldifs[2] = diffuser_make((int)(diffscale*dd), 0.625);
-    x->x_ldifs[3] = diffuser_make((int)(diffscale*e), 0.625);
-    if(!x->x_ldifs[0] || !x->x_ldifs[1] || !x->x_ldifs[2] || !x->x_ldifs[3]){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return;
-    }
-// Right
-    a = spread1*-0.568366f;
-    c = 159+a+b;
-    cc = c-b;
-    a = spread2*-0.126815f;
-    d = 159+562+a+b;
-    dd = d-c;
-    e = 1341-d;
-    x->x_rdifs[0] = diffuser_make((int)(diffscale*b), 0.75);
-    x->x_rdifs[1] = diffuser_make((int)(diffscale*cc), 0.75);
-    x->x_rdifs[2] = diffuser_make((int)(diffscale*dd), 0.625);
-    x->x_rdifs[3] = diffuser_make((int)(diffscale*e), 0.625);
-    if(!x->x_rdifs[0] || !x->x_rdifs[1] || !x->x_rdifs[2] || !x->x_rdifs[3]){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return;
+    x->x_spread = (f < 0 ? 0 : f > 1 ? 1 : f) * 100;
+    gverb_difsizes(x->x_spread, x->x_fdnlens[3], x->x_difsize);
+    for(int i = 0; i < 8; i++){ // new diffusers start empty
+        if(x->x_difsize[i] > x->x_difcap[i])
+            x->x_difsize[i] = x->x_difcap[i];
+        for(int j = 0; j < x->x_nchans; j++){
+            memset(x->x_arena + j*x->x_chsize + x->x_difoff[i], 0,
+                x->x_difcap[i] * sizeof(float));
+            x->x_ch[j].dif_idx[i] = 0;
+        }
     }
 }
 
@@ -326,13 +330,10 @@ static inline void gverb_decay(t_gverb *x, t_floatarg f){
 
 static inline void gverb_damp(t_gverb *x, t_floatarg f){
     x->x_fdndamp = f < 0.0f ? 0.0f : f > 1.0f ? 1.0f : f;
-    for(int i = 0; i < 4; i++)
-        damper_set(x->x_fdndamps[i], x->x_fdndamp);
 }
 
 static inline void gverb_bw(t_gverb *x, t_floatarg f){
     x->x_in_bw = f < 0.0f ? 0.0f : f > 1.0f ? 1.0f : f;
-    damper_set(x->x_in_damper, 1.0f - x->x_in_bw);
 }
 
 static inline void gverb_dry(t_gverb *x, t_floatarg f){
@@ -352,17 +353,7 @@ static inline void gverb_late(t_gverb *x, t_floatarg f){
 }
 
 void gverb_clear(t_gverb *x){
-    damper_clear(x->x_in_damper);
-    for(int i = 0; i < 4; i++){
-        fixeddelay_clear(x->x_fdndels[i]);
-        damper_clear(x->x_fdndamps[i]);
-        diffuser_clear(x->x_ldifs[i]);
-        diffuser_clear(x->x_rdifs[i]);
-    }
-    memset(x->x_d, 0, 4 * sizeof(float));
-    memset(x->x_u, 0, 4 * sizeof(float));
-    memset(x->x_f, 0, 4 * sizeof(float));
-    fixeddelay_clear(x->x_tapdelay);
+    gverb_clearchans(x);
 }
 
 t_int *gverb_perform(t_int *w){
@@ -371,19 +362,28 @@ t_int *gverb_perform(t_int *w){
     t_float *out1 = (t_float *)(w[3]);
     t_float *out2 = (t_float *)(w[4]);
     int n = (int)(w[5]);
-    t_float in;
-    t_float outL, outR;
-    while(n--){
-        in = *input++;
-        gverb_do(x, in, &outL, &outR);
-        *out1++ = (in * x->x_dry) + (outL * x->x_wet);
-        *out2++ = (in * x->x_dry) + (outR * x->x_wet);
-    }
+    for(int j = 0; j < x->x_nchans; j++) // one independent reverb per channel
+        gverb_run(x, &x->x_ch[j], x->x_arena + j*x->x_chsize,
+            input + j*n, out1 + j*n, out2 + j*n, n);
     return(w+6);
 }
 
 void gverb_dsp(t_gverb *x, t_signal **sp){
-    if(x->x_sr != sp[0]->s_sr) x->x_sr = sp[0]->s_sr;
+    int chs = sp[0]->s_nchans;
+    signal_setmultiout(&sp[1], chs);
+    signal_setmultiout(&sp[2], chs);
+    if(x->x_sr != sp[0]->s_sr){ // delay lengths depend on the sample rate
+        x->x_sr = sp[0]->s_sr;
+        x->x_maxdelay = x->x_sr*x->x_maxsize/340.0;
+        gverb_layout(x, chs);
+        gverb_decay(x, x->x_decay);
+        gverb_size(x, x->x_size);
+        gverb_spread(x, x->x_spread/100);
+    }
+    else if(x->x_nchans != chs){
+        gverb_layout(x, chs);
+        gverb_spread(x, x->x_spread/100);
+    }
     dsp_add(gverb_perform, 5, x, sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec, sp[0]->s_n);
 }
 
@@ -403,25 +403,8 @@ void gverb_print(t_gverb *x){
 }
 
 void gverb_free(t_gverb *x){
-    damper_free(x->x_in_damper);
-    for(int i = 0; i < 4; i++){
-        fixeddelay_free(x->x_fdndels[i]);
-        damper_free(x->x_fdndamps[i]);
-        diffuser_free(x->x_ldifs[i]);
-        diffuser_free(x->x_rdifs[i]);
-    }
-    t_freebytes(x->x_fdndels, 4*sizeof(t_fixeddelay *));
-    t_freebytes(x->x_fdngains, 4*sizeof(float));
-    t_freebytes(x->x_fdnlens, 4*sizeof(int));
-    t_freebytes(x->x_fdndamps, 4*sizeof(t_damper *));
-    t_freebytes(x->x_d, 4*sizeof(float));
-    t_freebytes(x->x_u, 4*sizeof(float));
-    t_freebytes(x->x_f, 4*sizeof(float));
-    t_freebytes(x->x_ldifs, 4*sizeof(t_diffuser *));
-    t_freebytes(x->x_rdifs, 4*sizeof(t_diffuser *));
-    t_freebytes(x->x_taps, 4*sizeof(int));
-    t_freebytes(x->x_tapgains, 4*sizeof(float));
-    fixeddelay_free(x->x_tapdelay);
+    freebytes(x->x_arena, x->x_nchans * x->x_chsize * sizeof(float));
+    freebytes(x->x_ch, x->x_nchans * sizeof(t_gverb_chan));
 }
 
 t_gverb *gverb_new(t_symbol *s, short ac, t_atom *av){
@@ -504,12 +487,8 @@ t_gverb *gverb_new(t_symbol *s, short ac, t_atom *av){
             goto errstate;
     };
 /////////////////////////////////////////////////////////////////////////////////////
-    float ga, gb, gt;
+    float ga, gt;
     int i, n;
-    float r;
-    float diffscale;
-    int a, b, c, cc, d, dd, e;
-    float spread1, spread2;
     x->x_sr = sys_getsr();
     x->x_fdndamp = damp;
     x->x_maxsize = maxsize;
@@ -519,123 +498,28 @@ t_gverb *gverb_new(t_symbol *s, short ac, t_atom *av){
     x->x_wet = wet;
     x->x_early = early;
     x->x_late = late;
+    x->x_in_bw = in_bw;
+    x->x_spread = spread;
     x->x_maxdelay = x->x_sr*x->x_maxsize/340.0;
     x->x_largestdelay = x->x_sr*x->x_size/340.0;
     outlet_new(&x->x_obj, gensym("signal"));
     outlet_new(&x->x_obj, gensym("signal"));
-// Input damper
-    x->x_in_bw = in_bw;
-    x->x_in_damper = damper_make(1.0 - x->x_in_bw);
+    gverb_layout(x, 1);
 // FDN section
-    x->x_fdndels = (t_fixeddelay **)t_getbytes(4*sizeof(t_fixeddelay *));
-    if(!x->x_fdndels){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return (NULL);
-    }
-    for(i = 0; i < 4; i++){
-        x->x_fdndels[i] = fixeddelay_make((int)x->x_maxdelay+1000);
-        if(!x->x_fdndels[i]){
-            pd_error(x, "[giga.rev~]: out of memory");
-            return (NULL);
-        }
-    }
-    x->x_fdngains = (float *)t_getbytes(4*sizeof(float));
-    x->x_fdnlens = (int *)t_getbytes(4*sizeof(int));
-    if(!x->x_fdngains || !x->x_fdnlens){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return (NULL);
-    }
-    x->x_fdndamps = (t_damper **)t_getbytes(4*sizeof(t_damper *));
-    if(!x->x_fdndamps){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return (NULL);
-    }
-    for(i = 0; i < 4; i++){
-        x->x_fdndamps[i] = damper_make(x->x_fdndamp);
-        if(!x->x_fdndamps[i]){
-            pd_error(x, "[giga.rev~]: out of memory");
-            return (NULL);
-        }
-    }
     ga = 60.0;
     gt = x->x_decay;
     ga = pow(10.0,-ga/20.0);
     n = x->x_sr*gt;
     x->x_alpha = pow((double)ga,(double)1.0/(double)n);
-    gb = 0.0;
-    for(i = 0; i < 4; i++){
-        if(i == 0) gb = 1.000000*x->x_largestdelay;
-        if(i == 1) gb = 0.816490*x->x_largestdelay;
-        if(i == 2) gb = 0.707100*x->x_largestdelay;
-        if(i == 3) gb = 0.632450*x->x_largestdelay;
-        x->x_fdnlens[i] = (int)gb;
+    x->x_fdnlens[0] = (int)(1.000000*x->x_largestdelay);
+    x->x_fdnlens[1] = (int)(0.816490*x->x_largestdelay);
+    x->x_fdnlens[2] = (int)(0.707100*x->x_largestdelay);
+    x->x_fdnlens[3] = (int)(0.632450*x->x_largestdelay);
+    for(i = 0; i < 4; i++)
         x->x_fdngains[i] = -powf((float)x->x_alpha, x->x_fdnlens[i]);
-    }
-    x->x_d = (float *)t_getbytes(4*sizeof(float));
-    x->x_u = (float *)t_getbytes(4*sizeof(float));
-    x->x_f = (float *)t_getbytes(4*sizeof(float));
-    if(!x->x_d || !x->x_u || !x->x_f){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return (NULL);
-    }
 // Diffuser section
-    diffscale = (float)x->x_fdnlens[3]/(210+159+562+410);
-    spread1 = spread;
-    spread2 = 3.0*spread;
-    b = 210;
-    r = 0.125541f;
-    a = spread1*r;
-    c = 210+159+a;
-    cc = c-b;
-    r = 0.854046f;
-    a = spread2*r;
-    d = 210+159+562+a;
-    dd = d-c;
-    e = 1341-d;
-    x->x_ldifs = (t_diffuser **)t_getbytes(4*sizeof(t_diffuser *));
-    if(!x->x_ldifs){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return (NULL);
-    }
-    x->x_ldifs[0] = diffuser_make((int)(diffscale*b), 0.75);
-    x->x_ldifs[1] = diffuser_make((int)(diffscale*cc), 0.75);
-    x->x_ldifs[2] = diffuser_make((int)(diffscale*dd), 0.625);
-    x->x_ldifs[3] = diffuser_make((int)(diffscale*e), 0.625);
-    if(!x->x_ldifs[0] || !x->x_ldifs[1] || !x->x_ldifs[2] || !x->x_ldifs[3]){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return (NULL);
-    }
-    b = 210;
-    r = -0.568366f;
-    a = spread1*r;
-    c = 210+159+a;
-    cc = c-b;
-    r = -0.126815f;
-    a = spread2*r;
-    d = 210+159+562+a;
-    dd = d-c;
-    e = 1341-d;
-    x->x_rdifs = (t_diffuser **)t_getbytes(4*sizeof(t_diffuser *));
-    if(!x->x_rdifs){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return (NULL);
-    }
-    x->x_rdifs[0] = diffuser_make((int)(diffscale*b), 0.75);
-    x->x_rdifs[1] = diffuser_make((int)(diffscale*cc), 0.75);
-    x->x_rdifs[2] = diffuser_make((int)(diffscale*dd), 0.625);
-    x->x_rdifs[3] = diffuser_make((int)(diffscale*e), 0.625);
-    if(!x->x_rdifs[0] || !x->x_rdifs[1] || !x->x_rdifs[2] || !x->x_rdifs[3]){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return (NULL);
-    }
+    gverb_difsizes(x->x_spread, x->x_fdnlens[3], x->x_difsize);
 // Tapped delay section
-    x->x_tapdelay = fixeddelay_make(44000);
-    x->x_taps = (int *)t_getbytes(4*sizeof(int));
-    x->x_tapgains = (float *)t_getbytes(4*sizeof(float));
-    if(!x->x_tapdelay || !x->x_taps || !x->x_tapgains){
-        pd_error(x, "[giga.rev~]: out of memory");
-        return (NULL);
-    }
     x->x_taps[0] = 5+0.410*x->x_largestdelay;
     x->x_taps[1] = 5+0.300*x->x_largestdelay;
     x->x_taps[2] = 5+0.155*x->x_largestdelay;
@@ -650,7 +534,7 @@ t_gverb *gverb_new(t_symbol *s, short ac, t_atom *av){
 
 void setup_giga0x2erev_tilde(void){
     gverb_class = class_new(gensym("giga.rev~"), (t_newmethod)gverb_new,
-        (t_method)gverb_free, sizeof(t_gverb), 0, A_GIMME, 0);
+        (t_method)gverb_free, sizeof(t_gverb), CLASS_MULTICHANNEL, A_GIMME, 0);
     class_addmethod(gverb_class, nullfn, gensym("signal"), 0);
     class_addmethod(gverb_class, (t_method)gverb_dsp, gensym("dsp"), A_CANT, 0);
     class_addmethod(gverb_class, (t_method)gverb_spread, gensym("spread"), A_FLOAT, 0);
@@ -1,69 +1,85 @@
 // Porres 2017
 
 #include "m_pd.h"
+#include "biquad.h"
 #include <math.h>
 
-#define PI 3.14159265358979323846
-
 typedef struct _highshelf{
     t_object    x_obj;
-    t_int       x_n;
     t_inlet    *x_inlet_freq;
     t_inlet    *x_inlet_q;
     t_inlet    *x_inlet_amp;
     t_outlet   *x_out;
+    t_biquad   *x_bq;
+    int         x_nchans;
     t_float     x_nyq;
+    t_float     x_freq; // control rate (-k) parameters
+    t_float     x_sl;
+    t_float     x_gain;
+    int         x_ctl;
     int         x_bypass;
-    double      x_xnm1;
-    double      x_xnm2;
-    double      x_ynm1;
-    double      x_ynm2;
-    double      x_f;
-    double      x_slope;
-    double      x_db;
-    double      x_a0;
-    double      x_a1;
-    double      x_a2;
-    double      x_b1;
-    double      x_b2;
 }t_highshelf;
 
 static t_class *highshelf_class;
 
-static void update_coeffs(t_highshelf *x, double f, double slope, double db){
-    x->x_f = f;
-    x->x_slope = slope;
-    x->x_db = db;
-    double amp = pow(10, db / 40);
-    double omega = f * PI/x->x_nyq;
-    double alphaS = sin(omega) * sqrt((amp*amp + 1) * (1/slope - 1) + 2*amp);
-    double cos_w = cos(omega);
+static void update_coeffs(t_highshelf *x, t_biquad *bq, double f, double slope, double db, int n){
+    t_biquad_coeffs c;
+    bq->param[0] = f;
+    bq->param[1] = slope;
+    bq->param[2] = db;
+    double sin_w, cos_w, onemcos_w;
+    double amp = exp(db * BIQUAD_LOG10_40);
+    double omega = f * BIQUAD_PI/x->x_nyq;
+    biquad_sincos(omega, &sin_w, &cos_w, &onemcos_w);
+    double alphaS = sin_w * sqrt((amp*amp + 1) * (1/slope - 1) + 2*amp);
     double b0 = (amp+1) - (amp-1)*cos_w + alphaS;
-    x->x_a0 = amp*(amp+1 + (amp-1)*cos_w + alphaS) / b0;
-    x->x_a1 = -2*amp*(amp-1 + (amp+1)*cos_w) / b0;
-    x->x_a2 = amp*(amp+1 + (amp-1)*cos_w - alphaS) / b0;
-    x->x_b1 = -2*(amp-1 - (amp+1)*cos_w) / b0;
-    x->x_b2 = -(amp+1 - (amp-1)*cos_w - alphaS) / b0;
+    c.a0 = amp*(amp+1 + (amp-1)*cos_w + alphaS) / b0;
+    c.a1 = -2*amp*(amp-1 + (amp+1)*cos_w) / b0;
+    c.a2 = amp*(amp+1 + (amp-1)*cos_w - alphaS) / b0;
+    c.b1 = -2*(amp-1 - (amp+1)*cos_w) / b0;
+    c.b2 = -(amp+1 - (amp-1)*cos_w - alphaS) / b0;
+    biquad_set(bq, &c, n);
+}
+
+static void update_all(t_highshelf *x){
+    for(int j = 0; j < x->x_nchans; j++){
+        t_biquad *bq = &x->x_bq[j];
+        update_coeffs(x, bq, bq->param[0], bq->param[1], bq->param[2], 0);
+    }
 }
 
 static t_int *highshelf_perform(t_int *w){
     t_highshelf *x = (t_highshelf *)(w[1]);
-    int nblock = (int)(w[2]);
-    t_float *in1 = (t_float *)(w[3]);
-    t_float *in2 = (t_float *)(w[4]);
-    t_float *in3 = (t_float *)(w[5]);
-    t_float *in4 = (t_float *)(w[6]);
-    t_float *out = (t_float *)(w[7]);
-    double xnm1 = x->x_xnm1;
-    double xnm2 = x->x_xnm2;
-    double ynm1 = x->x_ynm1;
-    double ynm2 = x->x_ynm2;
+    int n = (int)(w[2]);
+    int ch2 = (int)(w[3]);
+    int ch3 = (int)(w[4]);
+    int ch4 = (int)(w[5]);
+    t_float *in1 = (t_float *)(w[6]);
+    t_float *in2 = (t_float *)(w[7]);
+    t_float *in3 = (t_float *)(w[8]);
+    t_float *in4 = (t_float *)(w[9]);
+    t_float *out = (t_float *)(w[10]);
     t_float nyq = x->x_nyq;
-    while(nblock--){
-        double xn = *in1++, f = *in2++, slope = *in3++, db = *in4++, yn;
-        if(x->x_bypass)
-            *out++ = xn;
-        else{
+    int chs = x->x_nchans;
+    if(x->x_bypass){
+        if(in1 != out)
+            for(int i = 0; i < chs*n; i++)
+                out[i] = in1[i];
+        return(w+11);
+    }
+    int step = x->x_ctl ? n : BIQUAD_STEP;
+    for(int i = 0; i < n; i += step){
+        int m = n - i < step ? n - i : step;
+        for(int j = 0; j < chs; j++){
+            t_biquad *bq = &x->x_bq[j];
+            double f, slope, db;
+            if(x->x_ctl)
+                f = x->x_freq, slope = x->x_sl, db = x->x_gain;
+            else{ // target is the parameter at the end of this chunk
+                f = in2[(ch2 == 1 ? 0 : j*n) + i+m-1];
+                slope = in3[(ch3 == 1 ? 0 : j*n) + i+m-1];
+                db = in4[(ch4 == 1 ? 0 : j*n) + i+m-1];
+            }
             if(f < 0.1)
                 f = 0.1;
             if(f > nyq - 0.1)
@@ -72,45 +88,58 @@ static t_int *highshelf_perform(t_int *w){
                 slope = 0.000001;
             if(slope > 1)
                 slope = 1;
-            if(f != x->x_f || slope != x->x_slope || db != x->x_db)
-                update_coeffs(x, f, slope, db);
-            yn = x->x_a0 * xn + x->x_a1 * xnm1 + x->x_a2 * xnm2 + x->x_b1 * ynm1 + x->x_b2 * ynm2;
-            *out++ = yn;
-            xnm2 = xnm1;
-            xnm1 = xn;
-            ynm2 = ynm1;
-            ynm1 = yn;
+            if(f != bq->param[0] || slope != bq->param[1] || db != bq->param[2])
+                update_coeffs(x, bq, f, slope, db, m);
         }
+        biquad_run_mc(x->x_bq, chs, in1+i, out+i, n, m);
     }
-    x->x_xnm1 = xnm1;
-    x->x_xnm2 = xnm2;
-    x->x_ynm1 = ynm1;
-    x->x_ynm2 = ynm2;
-    return(w+8);
+    return(w+11);
 }
 
 static void highshelf_dsp(t_highshelf *x, t_signal **sp){
+    int chs = sp[0]->s_nchans, n = sp[0]->s_n;
+    int ch2 = x->x_ctl ? 1 : sp[1]->s_nchans, ch3 = x->x_ctl ? 1 : sp[2]->s_nchans;
+    int ch4 = x->x_ctl ? 1 : sp[3]->s_nchans;
+    t_signal **out = x->x_ctl ? &sp[1] : &sp[4];
+    signal_setmultiout(out, chs);
+    if(x->x_nchans != chs){
+        x->x_bq = biquad_resize(x->x_bq, x->x_nchans, chs);
+        x->x_nchans = chs;
+    }
     t_float nyq = sp[0]->s_sr / 2;
     if(nyq != x->x_nyq){
         x->x_nyq = nyq;
-        update_coeffs(x, x->x_f, x->x_slope, x->x_db);
+        update_all(x);
     }
-    dsp_add(highshelf_perform, 7, x, sp[0]->s_n, sp[0]->s_vec,
-        sp[1]->s_vec, sp[2]->s_vec, sp[3]->s_vec, sp[4]->s_vec);
+    if((ch2 > 1 && ch2 != chs) || (ch3 > 1 && ch3 != chs) || (ch4 > 1 && ch4 != chs)){
+        dsp_add_zero((*out)->s_vec, chs*n);
+        pd_error(x, "[highshelf~]: channel sizes mismatch");
+    }
+    else if(x->x_ctl)
+        dsp_add(highshelf_perform, 10, x, n, ch2, ch3, ch4, sp[0]->s_vec, 0, 0, 0, (*out)->s_vec);
+    else
+        dsp_add(highshelf_perform, 10, x, n, ch2, ch3, ch4, sp[0]->s_vec,
+            sp[1]->s_vec, sp[2]->s_vec, sp[3]->s_vec, (*out)->s_vec);
 }
 
 static void highshelf_clear(t_highshelf *x){
-    x->x_xnm1 = x->x_xnm2 = x->x_ynm1 = x->x_ynm2 = 0.;
+    for(int j = 0; j < x->x_nchans; j++)
+        biquad_clear(&x->x_bq[j]);
 }
 
 static void highshelf_bypass(t_highshelf *x, t_floatarg f){
     x->x_bypass = (int)(f != 0);
 }
 
+static void highshelf_free(t_highshelf *x){
+    freebytes(x->x_bq, x->x_nchans * sizeof(*x->x_bq));
+}
+
 static void *highshelf_new(t_symbol *s, int argc, t_atom *argv){
     s = NULL;
     t_highshelf *x = (t_highshelf *)pd_new(highshelf_class);
     float freq = 0.1, slope = 0.000001, db = 0;
+    int ctl = 0;
     int argnum = 0;
     while(argc > 0){
         if(argv -> a_type == A_FLOAT){
@@ -130,17 +159,34 @@ static void *highshelf_new(t_symbol *s, int argc, t_atom *argv){
             };
             argnum++, argc--, argv++;
         }
-        else if(argv -> a_type == A_SYMBOL)
+        else if(argv -> a_type == A_SYMBOL && !argnum
+        && atom_getsymbolarg(0, argc, argv) == gensym("-k")){
+            ctl = 1;
+            argc--, argv++;
+        }
+        else
             goto errstate;
     };
+    x->x_ctl = ctl;
     x->x_nyq = sys_getsr()/2;
-    update_coeffs(x, (double)freq, (double)slope, (double)db);
-    x->x_inlet_freq = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
-    pd_float((t_pd *)x->x_inlet_freq, freq);
-    x->x_inlet_q = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
-    pd_float((t_pd *)x->x_inlet_q, slope);
-    x->x_inlet_amp = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
-    pd_float((t_pd *)x->x_inlet_amp, db);
+    x->x_bq = (t_biquad *)getbytes(sizeof(*x->x_bq));
+    x->x_nchans = 1;
+    biquad_init(x->x_bq);
+    update_coeffs(x, x->x_bq, (double)freq, (double)slope, (double)db, 0);
+    x->x_freq = freq, x->x_sl = slope, x->x_gain = db;
+    if(ctl){
+        x->x_inlet_freq = floatinlet_new((t_object *)x, &x->x_freq);
+        x->x_inlet_q = floatinlet_new((t_object *)x, &x->x_sl);
+        x->x_inlet_amp = floatinlet_new((t_object *)x, &x->x_gain);
+    }
+    else{
+        x->x_inlet_freq = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
+        pd_float((t_pd *)x->x_inlet_freq, freq);
+        x->x_inlet_q = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
+        pd_float((t_pd *)x->x_inlet_q, slope);
+        x->x_inlet_amp = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
+        pd_float((t_pd *)x->x_inlet_amp, db);
+    }
     x->x_out = outlet_new((t_object *)x, &s_signal);
     return(x);
     errstate:
@@ -149,8 +195,8 @@ static void *highshelf_new(t_symbol *s, int argc, t_atom *argv){
 }
 
 void highshelf_tilde_setup(void){
-    highshelf_class = class_new(gensym("highshelf~"), (t_newmethod)highshelf_new, 0,
-        sizeof(t_highshelf), CLASS_DEFAULT, A_GIMME, 0);
+    highshelf_class = class_new(gensym("highshelf~"), (t_newmethod)highshelf_new,
+        (t_method)highshelf_free, sizeof(t_highshelf), CLASS_MULTICHANNEL, A_GIMME, 0);
     class_addmethod(highshelf_class, (t_method)highshelf_dsp, gensym("dsp"), A_CANT, 0);
     class_addmethod(highshelf_class, nullfn, gensym("signal"), 0);
     class_addmethod(highshelf_class, (t_method)highshelf_clear, gensym("clear"), 0);
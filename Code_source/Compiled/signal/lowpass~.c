@@ -1,111 +1,128 @@
 // Porres 2017
 
 #include "m_pd.h"
+#include "biquad.h"
 #include <math.h>
 
-#define PI 3.14159265358979323846
-#define HALF_LOG2 log(2)/2
-
 typedef struct _lowpass{
     t_object    x_obj;
-    t_int       x_n;
     t_inlet    *x_inlet_freq;
     t_inlet    *x_inlet_q;
     t_outlet   *x_out;
+    t_biquad   *x_bq;
+    int         x_nchans;
     t_float     x_nyq;
+    t_float     x_freq; // control rate (-k) parameters
+    t_float     x_q;
+    int         x_ctl;
     int         x_bypass;
     int         x_bw;
-    double      x_xnm1;
-    double      x_xnm2;
-    double      x_ynm1;
-    double      x_ynm2;
-    double      x_f;
-    double      x_reson;
-    double      x_a0;
-    double      x_a1;
-    double      x_a2;
-    double      x_b1;
-    double      x_b2;
 }t_lowpass;
 
 static t_class *lowpass_class;
 
-static void update_coeffs(t_lowpass *x, double f, double reson){
-    x->x_f = f;
-    x->x_reson = reson;
-    double q;
-    double omega = f * PI/x->x_nyq;
+static void update_coeffs(t_lowpass *x, t_biquad *bq, double f, double reson, int n){
+    t_biquad_coeffs c;
+    bq->param[0] = f;
+    bq->param[1] = reson;
+    double q, sin_w, cos_w, onemcos_w;
+    double omega = f * BIQUAD_PI/x->x_nyq;
+    biquad_sincos(omega, &sin_w, &cos_w, &onemcos_w);
     if(x->x_bw){ // reson is bw in octaves
          if(reson < 0.000001)
              reson = 0.000001;
-         q = 1 / (2 * sinh(HALF_LOG2 * reson * omega/sin(omega)));
+         q = 1 / (2 * sinh(BIQUAD_HALF_LOG2 * reson * omega/sin_w));
     }
     else
         q = reson;
     if(q < 0.000001) // force bypass
-        x->x_a0 = 1, x->x_a2 = x->x_b1 = x->x_b2 = 0;
+        c.a0 = 1, c.a1 = c.a2 = c.b1 = c.b2 = 0;
     else{
-        double alphaQ = sin(omega) / (2*q);
-        double cos_w = cos(omega);
+        double alphaQ = sin_w / (2*q);
         double b0 = alphaQ + 1;
-        x->x_a0 = (1 - cos_w) / (2 * b0);
-        x->x_a1 = (1 - cos_w) / b0;
-        x->x_a2 = x->x_a0;
-        x->x_b1 = 2*cos_w / b0;
-        x->x_b2 = (alphaQ - 1) / b0;
+        c.a0 = onemcos_w / (2 * b0);
+        c.a1 = onemcos_w / b0;
+        c.a2 = c.a0;
+        c.b1 = 2*cos_w / b0;
+        c.b2 = (alphaQ - 1) / b0;
     }
+    biquad_set(bq, &c, n);
+}
+
+static void update_all(t_lowpass *x){
+    for(int j = 0; j < x->x_nchans; j++)
+        update_coeffs(x, &x->x_bq[j], x->x_bq[j].param[0], x->x_bq[j].param[1], 0);
 }
 
 static t_int *lowpass_perform(t_int *w){
     t_lowpass *x = (t_lowpass *)(w[1]);
-    int nblock = (int)(w[2]);
-    t_float *in1 = (t_float *)(w[3]);
-    t_float *in2 = (t_float *)(w[4]);
-    t_float *in3 = (t_float *)(w[5]);
-    t_float *out = (t_float *)(w[6]);
-    double xnm1 = x->x_xnm1;
-    double xnm2 = x->x_xnm2;
-    double ynm1 = x->x_ynm1;
-    double ynm2 = x->x_ynm2;
+    int n = (int)(w[2]);
+    int ch2 = (int)(w[3]);
+    int ch3 = (int)(w[4]);
+    t_float *in1 = (t_float *)(w[5]);
+    t_float *in2 = (t_float *)(w[6]);
+    t_float *in3 = (t_float *)(w[7]);
+    t_float *out = (t_float *)(w[8]);
     t_float nyq = x->x_nyq;
-    while (nblock--){
-        double xn = *in1++, f = *in2++, reson = *in3++, yn;
-        if(f < 0.000001)
-            f = 0.000001;
-        if(f > nyq - 0.000001)
-            f = nyq - 0.000001;
-        if(x->x_bypass)
-            *out++ = xn;
-        else{
-            if(f != x->x_f || reson != x->x_reson)
-                update_coeffs(x, (double)f, (double)reson);
-            yn = x->x_a0 * xn + x->x_a1 * xnm1 + x->x_a2 * xnm2 + x->x_b1 * ynm1 + x->x_b2 * ynm2;
-            *out++ = yn;
-            xnm2 = xnm1;
-            xnm1 = xn;
-            ynm2 = ynm1;
-            ynm1 = yn;
+    int chs = x->x_nchans;
+    if(x->x_bypass){
+        if(in1 != out)
+            for(int i = 0; i < chs*n; i++)
+                out[i] = in1[i];
+        return(w+9);
+    }
+    int step = x->x_ctl ? n : BIQUAD_STEP;
+    for(int i = 0; i < n; i += step){
+        int m = n - i < step ? n - i : step;
+        for(int j = 0; j < chs; j++){
+            t_biquad *bq = &x->x_bq[j];
+            double f, reson;
+            if(x->x_ctl)
+                f = x->x_freq, reson = x->x_q;
+            else{ // target is the parameter at the end of this chunk
+                f = in2[(ch2 == 1 ? 0 : j*n) + i+m-1];
+                reson = in3[(ch3 == 1 ? 0 : j*n) + i+m-1];
+            }
+            if(f < 0.000001)
+                f = 0.000001;
+            if(f > nyq - 0.000001)
+                f = nyq - 0.000001;
+            if(f != bq->param[0] || reson != bq->param[1])
+                update_coeffs(x, bq, f, reson, m);
         }
+        biquad_run_mc(x->x_bq, chs, in1+i, out+i, n, m);
     }
-    x->x_xnm1 = xnm1;
-    x->x_xnm2 = xnm2;
-    x->x_ynm1 = ynm1;
-    x->x_ynm2 = ynm2;
-    return(w+7);
+    return(w+9);
 }
 
 static void lowpass_dsp(t_lowpass *x, t_signal **sp){
+    int chs = sp[0]->s_nchans, n = sp[0]->s_n;
+    int ch2 = x->x_ctl ? 1 : sp[1]->s_nchans, ch3 = x->x_ctl ? 1 : sp[2]->s_nchans;
+    t_signal **out = x->x_ctl ? &sp[1] : &sp[3];
+    signal_setmultiout(out, chs);
+    if(x->x_nchans != chs){
+        x->x_bq = biquad_resize(x->x_bq, x->x_nchans, chs);
+        x->x_nchans = chs;
+    }
     t_float nyq = sp[0]->s_sr / 2;
     if(nyq != x->x_nyq){
         x->x_nyq = nyq;
-        update_coeffs(x, x->x_f, x->x_reson);
+        update_all(x);
     }
-    dsp_add(lowpass_perform, 6, x, sp[0]->s_n, sp[0]->s_vec,
-            sp[1]->s_vec, sp[2]->s_vec, sp[3]->s_vec);
+    if((ch2 > 1 && ch2 != chs) || (ch3 > 1 && ch3 != chs)){
+        dsp_add_zero((*out)->s_vec, chs*n);
+        pd_error(x, "[lowpass~]: channel sizes mismatch");
+    }
+    else if(x->x_ctl)
+        dsp_add(lowpass_perform, 8, x, n, ch2, ch3, sp[0]->s_vec, 0, 0, (*out)->s_vec);
+    else
+        dsp_add(lowpass_perform, 8, x, n, ch2, ch3, sp[0]->s_vec,
+            sp[1]->s_vec, sp[2]->s_vec, (*out)->s_vec);
 }
 
 static void lowpass_clear(t_lowpass *x){
-    x->x_xnm1 = x->x_xnm2 = x->x_ynm1 = x->x_ynm2 = 0.;
+    for(int j = 0; j < x->x_nchans; j++)
+        biquad_clear(&x->x_bq[j]);
 }
 
 static void lowpass_bypass(t_lowpass *x, t_floatarg f){
@@ -114,12 +131,16 @@ static void lowpass_bypass(t_lowpass *x, t_floatarg f){
 
 static void lowpass_bw(t_lowpass *x){
     x->x_bw = 1;
-    update_coeffs(x, x->x_f, x->x_reson);
+    update_all(x);
 }
 
 static void lowpass_q(t_lowpass *x){
     x->x_bw = 0;
-    update_coeffs(x, x->x_f, x->x_reson);
+    update_all(x);
+}
+
+static void lowpass_free(t_lowpass *x){
+    freebytes(x->x_bq, x->x_nchans * sizeof(*x->x_bq));
 }
 
 static void *lowpass_new(t_symbol *s, int argc, t_atom *argv){
@@ -128,6 +149,7 @@ static void *lowpass_new(t_symbol *s, int argc, t_atom *argv){
     float freq = 0.000001;
     float reson = 1;
     float bw = 0;
+    int ctl = 0;
     int argnum = 0;
     while(argc > 0){
         if(argv->a_type == A_FLOAT){ //if current argument is a float
@@ -146,10 +168,15 @@ static void *lowpass_new(t_symbol *s, int argc, t_atom *argv){
             argc--, argv++;
         }
         else if(argv->a_type == A_SYMBOL && !argnum){
-            if(atom_getsymbolarg(0, argc, argv) == gensym("-bw")){
+            t_symbol *curarg = atom_getsymbolarg(0, argc, argv);
+            if(curarg == gensym("-bw")){
                 bw = 1;
                 argc--, argv++;
             }
+            else if(curarg == gensym("-k")){
+                ctl = 1;
+                argc--, argv++;
+            }
             else
                 goto errstate;
         }
@@ -157,12 +184,23 @@ static void *lowpass_new(t_symbol *s, int argc, t_atom *argv){
             goto errstate;
     };
     x->x_bw = bw;
+    x->x_ctl = ctl;
     x->x_nyq = sys_getsr()/2;
-    update_coeffs(x, (double)freq, (double)reson);
-    x->x_inlet_freq = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
-    pd_float((t_pd *)x->x_inlet_freq, freq);
-    x->x_inlet_q = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
-    pd_float((t_pd *)x->x_inlet_q, reson);
+    x->x_bq = (t_biquad *)getbytes(sizeof(*x->x_bq));
+    x->x_nchans = 1;
+    biquad_init(x->x_bq);
+    update_coeffs(x, x->x_bq, (double)freq, (double)reson, 0);
+    x->x_freq = freq, x->x_q = reson;
+    if(ctl){
+        x->x_inlet_freq = floatinlet_new((t_object *)x, &x->x_freq);
+        x->x_inlet_q = floatinlet_new((t_object *)x, &x->x_q);
+    }
+    else{
+        x->x_inlet_freq = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
+        pd_float((t_pd *)x->x_inlet_freq, freq);
+        x->x_inlet_q = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
+        pd_float((t_pd *)x->x_inlet_q, reson);
+    }
     x->x_out = outlet_new((t_object *)x, &s_signal);
     return (x);
 errstate:
@@ -171,8 +209,8 @@ errstate:
 }
 
 void lowpass_tilde_setup(void){
-    lowpass_class = class_new(gensym("lowpass~"), (t_newmethod)lowpass_new, 0,
-        sizeof(t_lowpass), CLASS_DEFAULT, A_GIMME, 0);
+    lowpass_class = class_new(gensym("lowpass~"), (t_newmethod)lowpass_new,
+        (t_method)lowpass_free, sizeof(t_lowpass), CLASS_MULTICHANNEL, A_GIMME, 0);
     class_addmethod(lowpass_class, (t_method)lowpass_dsp, gensym("dsp"), A_CANT, 0);
     class_addmethod(lowpass_class, nullfn, gensym("signal"), 0);
     class_addmethod(lowpass_class, (t_method)lowpass_clear, gensym("clear"), 0);
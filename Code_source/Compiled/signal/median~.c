@@ -1,47 +1,158 @@
 // by schiavoni and porres 2017-2020
 
+// Running median (or any other percentile) over a sliding window of arbitrary
+// size. The window is split into a max heap holding the lower values and a min
+// heap holding the upper ones, each sample replaces the oldest in place and is
+// sifted back into order, so an update costs O(log n) instead of a sort.
+
 #include "m_pd.h"
 #include <stdlib.h>
+#include <math.h>
 
 static t_class *median_class;
 
 typedef struct _median {
     t_object     x_obj;
-    t_inlet     *median;
-    t_float      x_samples;
-    t_float     *x_temp;
-    t_int        x_block_size;
+    t_float     *x_data;    // circular buffer with the window's samples
+    int         *x_heap;    // window slots, [0, lo) max heap, [lo, n) min heap
+    int         *x_pos;     // position of each window slot in x_heap
+    int          x_n;       // window size
+    int          x_lo;      // size of the max heap
+    int          x_idx;     // oldest slot, next one to be replaced
+    int          x_hold;    // output only once every window
+    int          x_count;
+    t_float      x_rank;    // 0-1 (0.5 is the median)
+    t_float      x_frac;
+    t_float      x_last;
     t_outlet    *x_outlet;
 }t_median;
 
-void median_sort(t_float *a, int n) {
-    if(n < 2)
-        return;
-    t_float p = a[n / 2];
-    t_float *l = a;
-    t_float *r = a + n - 1;
-    while(l <= r){
-        while(*l < p)
-            l++;
-        while(*r > p)
-            r--;
-        if(l <= r){
-            t_float t = *l;
-            *l++ = *r;
-            *r-- = t;
-        }
+static void median_swap(t_median *x, int a, int b){
+    int t = x->x_heap[a];
+    x->x_heap[a] = x->x_heap[b];
+    x->x_heap[b] = t;
+    x->x_pos[x->x_heap[a]] = a;
+    x->x_pos[x->x_heap[b]] = b;
+}
+
+// 'i' is relative to each heap, 'sign' is 1 for the min heap and -1 for the max
+// heap so both share the same code
+#define MEDIAN_LESS(x, off, sign, a, b) \
+    ((sign) * x->x_data[x->x_heap[(off) + (a)]] < (sign) * x->x_data[x->x_heap[(off) + (b)]])
+
+static void median_siftup(t_median *x, int off, int sign, int i){
+    while(i > 0){
+        int p = (i - 1) >> 1;
+        if(!MEDIAN_LESS(x, off, sign, i, p))
+            break;
+        median_swap(x, off + i, off + p);
+        i = p;
+    }
+}
+
+static void median_siftdown(t_median *x, int off, int size, int sign, int i){
+    for(;;){
+        int c = 2*i + 1;
+        if(c >= size)
+            break;
+        if(c + 1 < size && MEDIAN_LESS(x, off, sign, c + 1, c))
+            c++;
+        if(!MEDIAN_LESS(x, off, sign, c, i))
+            break;
+        median_swap(x, off + i, off + c);
+        i = c;
+    }
+}
+
+static void median_insert(t_median *x, t_float f){
+    int slot = x->x_idx, lo = x->x_lo, hi = x->x_n - lo;
+    int p = x->x_pos[slot];
+    x->x_data[slot] = f;
+    if(++x->x_idx == x->x_n)
+        x->x_idx = 0;
+    if(p < lo){
+        median_siftup(x, 0, -1, p);
+        median_siftdown(x, 0, lo, -1, x->x_pos[slot]);
+    }
+    else{
+        median_siftup(x, lo, 1, p - lo);
+        median_siftdown(x, lo, hi, 1, x->x_pos[slot] - lo);
+    }
+    // if the new value crossed over, trade it with the other heap's top
+    if(lo > 0 && x->x_data[x->x_heap[0]] > x->x_data[x->x_heap[lo]]){
+        median_swap(x, 0, lo);
+        median_siftdown(x, 0, lo, -1, 0);
+        median_siftdown(x, lo, hi, 1, 0);
+    }
+}
+
+static t_float median_get(t_median *x){
+    t_float hi = x->x_data[x->x_heap[x->x_lo]];
+    if(x->x_frac > 0){ // interpolate between neighbouring ranks
+        t_float lo = x->x_data[x->x_heap[0]];
+        return(lo + (hi - lo) * x->x_frac);
     }
-    median_sort(a, r - a + 1);
-    median_sort(l, a + n - l);
+    return(hi);
 }
 
-t_float median_calculate(t_float * array, int begin, int end){
-    median_sort(array + begin, end - begin + 1);
-    int qtd = end - begin + 1;
-    t_float median = 0;
-    median = (qtd%2 == 1) ? array[begin + ((qtd - 1)/2)] :
-        (array[begin + qtd / 2 - 1] + array[begin + qtd / 2])/2.0f;
-    return(median);
+static t_median *median_sortx; // qsort has no context argument
+static int median_cmp(const void *a, const void *b){
+    t_float fa = median_sortx->x_data[*(int *)a];
+    t_float fb = median_sortx->x_data[*(int *)b];
+    return((fa > fb) - (fa < fb));
+}
+
+static void median_rebuild(t_median *x){ // on size or rank changes
+    int n = x->x_n, i;
+    double pos = x->x_rank * (n - 1);
+    int ipos = (int)pos;
+    x->x_frac = pos - ipos;
+    x->x_lo = x->x_frac > 0 ? ipos + 1 : ipos;
+    for(i = 0; i < n; i++)
+        x->x_heap[i] = i;
+    median_sortx = x;
+    qsort(x->x_heap, n, sizeof(int), median_cmp);
+    // ascending order is a min heap, reversing the lower part makes a max heap
+    for(i = 0; i < x->x_lo / 2; i++){
+        int t = x->x_heap[i];
+        x->x_heap[i] = x->x_heap[x->x_lo - 1 - i];
+        x->x_heap[x->x_lo - 1 - i] = t;
+    }
+    for(i = 0; i < n; i++)
+        x->x_pos[x->x_heap[i]] = i;
+    x->x_count = 0;
+}
+
+static void median_size(t_median *x, t_floatarg f){
+    int n = f < 1 ? 1 : (int)f;
+    if(n == x->x_n)
+        return;
+    x->x_data = (t_float *)resizebytes(x->x_data, x->x_n * sizeof(t_float), n * sizeof(t_float));
+    x->x_heap = (int *)resizebytes(x->x_heap, x->x_n * sizeof(int), n * sizeof(int));
+    x->x_pos = (int *)resizebytes(x->x_pos, x->x_n * sizeof(int), n * sizeof(int));
+    for(int i = 0; i < n; i++)
+        x->x_data[i] = 0;
+    x->x_n = n;
+    x->x_idx = 0;
+    median_rebuild(x);
+}
+
+static void median_rank(t_median *x, t_floatarg f){
+    x->x_rank = f < 0 ? 0 : f > 1 ? 1 : f;
+    median_rebuild(x);
+}
+
+static void median_hold(t_median *x, t_floatarg f){
+    x->x_hold = (int)(f != 0);
+    x->x_count = 0;
+}
+
+static void median_clear(t_median *x){
+    for(int i = 0; i < x->x_n; i++)
+        x->x_data[i] = 0;
+    x->x_idx = 0;
+    x->x_last = 0;
+    median_rebuild(x);
 }
 
 static t_int * median_perform(t_int *w){
@@ -49,53 +160,71 @@ static t_int * median_perform(t_int *w){
     t_int n = (int)(w[2]);
     t_float *in1 = (t_float *)(w[3]);
     t_float *out1 = (t_float *)(w[4]);
-    int i = 0;
-    for(i = 0 ; i < n ; i++)
-        x->x_temp[i] = in1[i];
-    if(x->x_samples > n)
-        x->x_samples = n;
-    if(x->x_samples < 1)
-        x->x_samples = 1;
-    int begin = 0;
-    int end = x->x_samples - 1;
-    t_float median = 0;
-    while(begin < n){
-        median = median_calculate(x->x_temp, begin, end);
-        i = 0;
-        for(i = begin; i < end + 1; i++)
-            out1[i] = median;
-        begin += x->x_samples;
-        end = (end + x->x_samples > n)? n - 1 : end + x->x_samples;
+    for(int i = 0; i < n; i++){
+        median_insert(x, in1[i]);
+        if(!x->x_hold)
+            out1[i] = median_get(x);
+        else{ // previous behaviour: one value per window
+            if(++x->x_count >= x->x_n){
+                x->x_last = median_get(x);
+                x->x_count = 0;
+            }
+            out1[i] = x->x_last;
+        }
     }
     return(w+5);
 }
 
 static void median_dsp(t_median *x, t_signal **sp){
-    t_int block = (t_int)sp[0]->s_n;
-    if(block != x->x_block_size){
-        x->x_block_size = block;
-        x->x_temp = realloc(x->x_temp, sizeof(t_float)*x->x_block_size);
-    }
     dsp_add(median_perform, 4, x, sp[0]->s_n, sp[0]->s_vec, sp[1]->s_vec);
 }
 
 void median_free(t_median *x){
-    free(x->x_temp);
+    freebytes(x->x_data, x->x_n * sizeof(t_float));
+    freebytes(x->x_heap, x->x_n * sizeof(int));
+    freebytes(x->x_pos, x->x_n * sizeof(int));
 }
 
-void * median_new(t_floatarg f) {
+void * median_new(t_symbol *s, int ac, t_atom *av){
+    s = NULL;
     t_median *x = (t_median *) pd_new(median_class);
-    x->x_samples = (f < 1) ? 1 : f;
-    x->x_block_size = 64;
-    x->x_temp = (t_float *)malloc(x->x_block_size * sizeof(t_float));
+    t_float n = 1;
+    x->x_rank = 0.5;
+    while(ac){
+        if(av->a_type == A_SYMBOL){
+            t_symbol *sym = atom_getsymbol(av);
+            if(sym == gensym("-hold"))
+                x->x_hold = 1, ac--, av++;
+            else if(sym == gensym("-rank") && ac >= 2){
+                t_float r = atom_getfloat(av+1);
+                x->x_rank = r < 0 ? 0 : r > 1 ? 1 : r;
+                ac -= 2, av += 2;
+            }
+            else
+                goto errstate;
+        }
+        else{
+            n = atom_getfloat(av);
+            ac--, av++;
+        }
+    }
+    x->x_n = 0;
+    median_size(x, n);
     x->x_outlet = outlet_new(&x->x_obj, &s_signal); // outlet
-    floatinlet_new(&x->x_obj, &x->x_samples);
+    inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_float, gensym("size"));
     return(void *)x;
+errstate:
+    pd_error(x, "[median~]: improper args");
+    return(NULL);
 }
 
 void median_tilde_setup(void) {
     median_class = class_new(gensym("median~"), (t_newmethod) median_new,
-        (t_method) median_free, sizeof (t_median), 0, A_DEFFLOAT, 0);
+        (t_method) median_free, sizeof (t_median), 0, A_GIMME, 0);
     class_addmethod(median_class, nullfn, gensym("signal"), 0);
     class_addmethod(median_class, (t_method) median_dsp, gensym("dsp"), A_CANT, 0);
+    class_addmethod(median_class, (t_method) median_size, gensym("size"), A_FLOAT, 0);
+    class_addmethod(median_class, (t_method) median_rank, gensym("rank"), A_FLOAT, 0);
+    class_addmethod(median_class, (t_method) median_hold, gensym("hold"), A_FLOAT, 0);
+    class_addmethod(median_class, (t_method) median_clear, gensym("clear"), 0);
 }
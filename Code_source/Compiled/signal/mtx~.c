@@ -15,12 +15,20 @@
 #define mtx_MINOUTLETS 1
 #define mtx_MAXOUTLETS 512
 
+typedef struct _mtx_cell{
+    int        c_ndx;   // index into the per cell arrays
+    int        c_in;
+    int        c_out;
+}t_mtx_cell;
+
 typedef struct _mtx{
     t_object     x_obj;
     int        x_numinlets;
     int        x_numoutlets;
     int        x_nblock;
     int        x_maxblock;
+    int        x_mc;       // single multichannel inlet/outlet
+    int        x_inchans;  // channels available at the mc inlet
     t_float  **x_ivecs;
     t_float  **x_ovecs;
     t_float  **x_osums;
@@ -38,9 +46,15 @@ typedef struct _mtx{
     float      x_ksr;
     float     *x_coefs;  /* current coefs */
     float     *x_incrs;
-    float     *x_bigincrs;
     int       *x_remains;
-
+    /* Only cells that are on or still fading are processed, these lists are
+       rebuilt in the perform routine whenever a cell changes or a fade ends */
+    int         x_dirty;
+    t_mtx_cell *x_active;  // cells on at a steady gain
+    int         x_nactive;
+    t_mtx_cell *x_fading;  // cells with a fade in progress
+    int         x_nfading;
+    char       *x_oused;   // outlets with at least one cell to sum
 } t_mtx;
 
 typedef void (*t_mtx_cellfn)(t_mtx *x, int indx, int ondx,
@@ -60,8 +74,8 @@ static void mtx_retarget(t_mtx *x, int cellndx){
         x->x_fades[cellndx] * x->x_ksr + 0.5;  /* LATER rethink */
         x->x_incrs[cellndx] =
             (target - x->x_coefs[cellndx]) / (float)x->x_remains[cellndx];
-        x->x_bigincrs[cellndx] = x->x_nblock * x->x_incrs[cellndx];
     }
+    x->x_dirty = 1;
 }
 
 /* called only in nonbinary mode;  LATER deal with changing nblock/ksr */
@@ -149,6 +163,34 @@ static void mtx_clear(t_mtx *x){
         if (x->x_gains)
             mtx_retarget(x, i);
     }
+    x->x_dirty = 1;
+}
+
+// collect the cells that need processing, all others are skipped
+static void mtx_rebuild(t_mtx *x){
+    int ndx = 0, nactive = 0, nfading = 0;
+    int numin = x->x_mc ? x->x_inchans : x->x_numinlets;
+    memset(x->x_oused, 0, x->x_numoutlets);
+    for(int i = 0; i < x->x_numinlets; i++){
+        for(int o = 0; o < x->x_numoutlets; o++, ndx++){
+            t_mtx_cell *cell;
+            if(i >= numin) // missing channel at the mc inlet
+                continue;
+            if(x->x_remains[ndx] > 0)
+                cell = &x->x_fading[nfading++];
+            else if(x->x_cells[ndx] && x->x_coefs[ndx] != 0)
+                cell = &x->x_active[nactive++];
+            else
+                continue;
+            cell->c_ndx = ndx;
+            cell->c_in = i;
+            cell->c_out = o;
+            x->x_oused[o] = 1;
+        }
+    }
+    x->x_nactive = nactive;
+    x->x_nfading = nfading;
+    x->x_dirty = 0;
 }
 
 static void mtx_fade(t_mtx *x, t_floatarg f){
@@ -160,79 +202,57 @@ static void mtx_fade(t_mtx *x, t_floatarg f){
     }
 }
 
+static void mtx_mix(t_float *restrict out, t_float *restrict in, float coef, int n){
+    for(int i = 0; i < n; i++)
+        out[i] += in[i] * coef;
+}
+
+static void mtx_ramp(t_float *restrict out, t_float *restrict in, float coef,
+float incr, int n){
+    for(int i = 0; i < n; i++)
+        out[i] += in[i] * (coef + incr * i);
+}
+
 static t_int *mtx_perform(t_int *w){
     t_mtx *x = (t_mtx *)(w[1]);
     int nblock = (int)(w[2]);
     t_float **ivecs = x->x_ivecs;
     t_float **ovecs = x->x_ovecs;
     t_float **osums = x->x_osums;
-    int *cellp = x->x_cells;
-    float *gainp = x->x_gains;
-    float *coefp = x->x_coefs;
-    float *incrp = x->x_incrs;
-    float *bigincrp = x->x_bigincrs;
-    int *nleftp = x->x_remains;
-    int indx;
-    for (indx = 0; indx < x->x_numinlets; indx++){
-    t_float *ivec = *ivecs++;
-    t_float **ovecp = osums;
-
-    int ondx = x->x_numoutlets;
-    while (ondx--){
-        t_float *in = ivec;
-        t_float *out = *ovecp;
-        float nleft = *nleftp;
-        int sndx = nblock;
-        if (nleft >= nblock){
-            float coef = *coefp;
-            float incr = *incrp;
-            if((*nleftp -= nblock) == 0)
-                *coefp = (*cellp ? *gainp : 0.);
-            else
-                *coefp += *bigincrp;
-            while (sndx--)
-                    *out++ += *in++ * coef, coef += incr;
+    if(x->x_dirty)
+        mtx_rebuild(x);
+    t_mtx_cell *cell = x->x_active;
+    for(int i = x->x_nactive; i--; cell++)
+        mtx_mix(osums[cell->c_out], ivecs[cell->c_in], x->x_coefs[cell->c_ndx], nblock);
+    cell = x->x_fading;
+    for(int i = x->x_nfading; i--; cell++){
+        int ndx = cell->c_ndx;
+        t_float *in = ivecs[cell->c_in];
+        t_float *out = osums[cell->c_out];
+        int nleft = x->x_remains[ndx];
+        float coef = x->x_coefs[ndx];
+        float incr = x->x_incrs[ndx];
+        if(nleft > nblock){
+            mtx_ramp(out, in, coef, incr, nblock);
+            x->x_coefs[ndx] += incr * nblock;
+            x->x_remains[ndx] -= nblock;
         }
-        else if (nleft > 0){
-            float coef = *coefp;
-            float incr = *incrp;
-            sndx -= nleft;
-            do{
-                *out++ += *in++ * coef, coef += incr;
-            }while (--nleft);
-            if (*cellp){
-                coef = *coefp = *gainp;
-                while (sndx--)
-                    *out++ += *in++ * coef;
-            }
-            else
-                *coefp = 0.;
-            *nleftp = 0;
+        else{ // fade ends in this block, cell moves to the active list or is dropped
+            mtx_ramp(out, in, coef, incr, nleft);
+            coef = x->x_coefs[ndx] = (x->x_cells[ndx] ? x->x_gains[ndx] : 0.);
+            if(coef != 0 && nleft < nblock)
+                mtx_mix(out + nleft, in + nleft, coef, nblock - nleft);
+            x->x_remains[ndx] = 0;
+            x->x_dirty = 1;
         }
-        else if (*cellp){
-            float coef = *coefp;
-            while (sndx--)
-                *out++ += *in++ * coef;
-        }
-        cellp++;
-        ovecp++;
-        gainp++;
-        coefp++;
-        incrp++;
-        bigincrp++;
-        nleftp++;
-    }
     }
-    osums = x->x_osums;
-    indx = x->x_numoutlets;
-    while (indx--){
-        t_float *in = *osums++;
-        t_float *out = *ovecs++;
-        int sndx = nblock;
-        while (sndx--){
-            *out++ = *in;
-            *in++ = 0.;
+    for(int o = 0; o < x->x_numoutlets; o++){
+        if(x->x_oused[o]){
+            memcpy(ovecs[o], osums[o], nblock * sizeof(t_float));
+            memset(osums[o], 0, nblock * sizeof(t_float));
         }
+        else
+            memset(ovecs[o], 0, nblock * sizeof(t_float));
     }
     return(w + 3);
 }
@@ -240,16 +260,29 @@ static t_int *mtx_perform(t_int *w){
 static void mtx_dsp(t_mtx *x, t_signal **sp){
     int i, nblock = sp[0]->s_n;
     t_float **vecp = x->x_ivecs;
-    t_signal **sigp = sp;
-    for(i = 0; i < x->x_numinlets; i++)
-        *vecp++ = (*sigp++)->s_vec;
-    vecp = x->x_ovecs;
-    for(i = 0; i < x->x_numoutlets; i++)
-        *vecp++ = (*sigp++)->s_vec;
+    if(x->x_mc){
+        x->x_inchans = sp[0]->s_nchans;
+        signal_setmultiout(&sp[1], x->x_numoutlets);
+        for(i = 0; i < x->x_numinlets; i++) // unused channels are skipped
+            *vecp++ = sp[0]->s_vec + (i < x->x_inchans ? i : 0) * nblock;
+        vecp = x->x_ovecs;
+        for(i = 0; i < x->x_numoutlets; i++)
+            *vecp++ = sp[1]->s_vec + i * nblock;
+    }
+    else{ // only the first channel of each inlet
+        t_signal **sigp = sp;
+        for(i = 0; i < x->x_numinlets; i++)
+            *vecp++ = (*sigp++)->s_vec;
+        vecp = x->x_ovecs;
+        for(i = 0; i < x->x_numoutlets; i++, sigp++){
+            signal_setmultiout(sigp, 1);
+            *vecp++ = (*sigp)->s_vec;
+        }
+    }
     if(nblock != x->x_nblock){
         if(nblock > x->x_maxblock){
-            size_t oldsize = x->x_maxblock * sizeof(*x->x_osums[i]),
-            newsize = nblock * sizeof(*x->x_osums[i]);
+            size_t oldsize = x->x_maxblock * sizeof(**x->x_osums),
+            newsize = nblock * sizeof(**x->x_osums);
             for(i = 0; i < x->x_numoutlets; i++)
                 x->x_osums[i] = resizebytes(x->x_osums[i], oldsize, newsize);
             x->x_maxblock = nblock;
@@ -257,6 +290,7 @@ static void mtx_dsp(t_mtx *x, t_signal **sp){
         x->x_nblock = nblock;
     }
     x->x_ksr = sp[0]->s_sr * .001;
+    x->x_dirty = 1;
     dsp_add(mtx_perform, 2, x, nblock);
 }
 
@@ -331,10 +365,14 @@ static void *mtx_free(t_mtx *x){
     freebytes(x->x_coefs, x->x_ncells * sizeof(*x->x_coefs));
     if (x->x_incrs)
     freebytes(x->x_incrs, x->x_ncells * sizeof(*x->x_incrs));
-    if (x->x_bigincrs)
-    freebytes(x->x_bigincrs, x->x_ncells * sizeof(*x->x_bigincrs));
     if (x->x_remains)
     freebytes(x->x_remains, x->x_ncells * sizeof(*x->x_remains));
+    if (x->x_active)
+    freebytes(x->x_active, x->x_ncells * sizeof(*x->x_active));
+    if (x->x_fading)
+    freebytes(x->x_fading, x->x_ncells * sizeof(*x->x_fading));
+    if (x->x_oused)
+    freebytes(x->x_oused, x->x_numoutlets * sizeof(*x->x_oused));
     return (void *)x;
 }
 
@@ -385,8 +423,11 @@ static void *mtx_new(t_symbol *s, int argc, t_atom *argv){
             argv++;
             argnum++;
         }
-        else if(argv -> a_type == A_SYMBOL){
-                goto errstate;
+        else if(argv -> a_type == A_SYMBOL && !argnum
+        && atom_getsymbolarg(0, argc, argv) == gensym("-mc")){
+            x->x_mc = 1;
+            argc--;
+            argv++;
         }
         else
             goto errstate;
@@ -410,17 +451,24 @@ static void *mtx_new(t_symbol *s, int argc, t_atom *argv){
             x->x_coefs[i] = 0.;
         x->x_ksr = sys_getsr() * .001;
         x->x_incrs = getbytes(x->x_ncells * sizeof(*x->x_incrs));
-        x->x_bigincrs = getbytes(x->x_ncells * sizeof(*x->x_bigincrs));
         x->x_remains = getbytes(x->x_ncells * sizeof(*x->x_remains));
         for (i = 0; i < x->x_ncells; i++){
             x->x_remains[i] = 0;
         };
-    for (i = 1; i < x->x_numinlets; i++){
-        inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_signal, &s_signal);
-    };
-    for (i = 0; i < x->x_numoutlets; i++){
-         outlet_new(&x->x_obj, gensym("signal"));
-    };
+    x->x_active = getbytes(x->x_ncells * sizeof(*x->x_active));
+    x->x_fading = getbytes(x->x_ncells * sizeof(*x->x_fading));
+    x->x_oused = getbytes(x->x_numoutlets * sizeof(*x->x_oused));
+    x->x_dirty = 1;
+    if(x->x_mc) // one multichannel inlet and outlet
+        outlet_new(&x->x_obj, gensym("signal"));
+    else{
+        for (i = 1; i < x->x_numinlets; i++){
+            inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_signal, &s_signal);
+        };
+        for (i = 0; i < x->x_numoutlets; i++){
+             outlet_new(&x->x_obj, gensym("signal"));
+        };
+    }
     x->x_dumpout = outlet_new((t_object *)x, &s_list);
     return (x);
     errstate:
@@ -430,7 +478,7 @@ static void *mtx_new(t_symbol *s, int argc, t_atom *argv){
 
 void mtx_tilde_setup(void){
     mtx_class = class_new(gensym("mtx~"), (t_newmethod)mtx_new,
-        (t_method)mtx_free, sizeof(t_mtx), 0, A_GIMME, 0);
+        (t_method)mtx_free, sizeof(t_mtx), CLASS_MULTICHANNEL, A_GIMME, 0);
     class_addmethod(mtx_class, nullfn, gensym("signal"), 0);
     class_addfloat(mtx_class, mtx_float);
     class_addlist(mtx_class, mtx_list);
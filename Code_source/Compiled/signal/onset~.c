@@ -0,0 +1,234 @@
+// a pd wrapper for aubio onset detection functions
+
+#include <m_pd.h>
+#include <aubio/src/aubio.h>
+
+// Each channel runs its own aubio onset detector. Their hops are staggered,
+// so with many channels the analysis frames fall on different blocks
+// instead of all landing on the same one every hop.
+
+#define MIN_BUFFER_SIZE 64
+#define MAX_BUFFER_SIZE 32768
+
+static t_class *onset_class;
+
+typedef struct _onset_ch{
+    aubio_onset_t  *c_o;
+    fvec_t         *c_in;
+    fvec_t         *c_out;
+    uint_t          c_pos;
+}t_onset_ch;
+
+typedef struct _onset{
+    t_object        x_obj;
+    t_float         x_f;
+    uint_t          x_sr;
+    int             x_wsize;
+    int             x_hopsize;
+    int             x_mode;
+    t_float         x_thresh;   // 0 for the method's default
+    t_float         x_silence;
+    t_float         x_minioi;   // ms, < 0 for the default
+    int             x_nchans;
+    t_onset_ch     *x_ch;
+}t_onset;
+
+static const char* modelLabels[9] ={
+    "hfc",
+    "energy",
+    "complex",
+    "phase",
+    "wphase",
+    "specdiff",
+    "specflux",
+    "kl",
+    "mkl",
+};
+
+static int onset_pow2(t_float f){ // aubio's own fft takes powers of 2 only
+    int size = MIN_BUFFER_SIZE;
+    while(size < f && size < MAX_BUFFER_SIZE)
+        size *= 2;
+    return(size);
+}
+
+static void onset_set(t_onset *x, t_onset_ch *c){
+    if(x->x_thresh > 0)
+        aubio_onset_set_threshold(c->c_o, x->x_thresh);
+    aubio_onset_set_silence(c->c_o, x->x_silence);
+    if(x->x_minioi >= 0)
+        aubio_onset_set_minioi_ms(c->c_o, x->x_minioi);
+}
+
+static void onset_delete(t_onset *x){
+    for(int i = 0; i < x->x_nchans; i++){
+        del_aubio_onset(x->x_ch[i].c_o);
+        del_fvec(x->x_ch[i].c_in);
+        del_fvec(x->x_ch[i].c_out);
+    }
+    freebytes(x->x_ch, x->x_nchans * sizeof(*x->x_ch));
+    x->x_ch = NULL;
+    x->x_nchans = 0;
+}
+
+// (re)make the detectors, channel i starts its hop i/n of the way into it
+static void onset_renew(t_onset *x, int nchans){
+    onset_delete(x);
+    x->x_ch = (t_onset_ch *)getbytes(nchans * sizeof(*x->x_ch));
+    for(int i = 0; i < nchans; i++){
+        t_onset_ch *c = &x->x_ch[i];
+        c->c_o = new_aubio_onset(modelLabels[x->x_mode],
+            x->x_wsize, x->x_hopsize, x->x_sr);
+        c->c_in = new_fvec(x->x_hopsize);
+        c->c_out = new_fvec(1);
+        c->c_pos = (uint_t)((long)x->x_hopsize * i / nchans);
+        onset_set(x, c);
+    }
+    x->x_nchans = nchans;
+}
+
+static void onset_mode(t_onset *x, t_floatarg f){
+    x->x_mode = f < 0 ? 0 : f > 8 ? 8 : (int)f;
+    onset_renew(x, x->x_nchans);
+}
+
+static void onset_window(t_onset *x, t_floatarg f){
+    x->x_wsize = onset_pow2(f);
+    if(x->x_hopsize > x->x_wsize)
+        x->x_hopsize = x->x_wsize;
+    onset_renew(x, x->x_nchans);
+}
+
+static void onset_hop(t_onset *x, t_floatarg f){
+    x->x_hopsize = f < MIN_BUFFER_SIZE ? MIN_BUFFER_SIZE :
+        f > x->x_wsize ? x->x_wsize : (int)f;
+    onset_renew(x, x->x_nchans);
+}
+
+static void onset_thresh(t_onset *x, t_floatarg f){
+    x->x_thresh = f < 0 ? 0 : f;
+    if(x->x_thresh == 0) // back to the method's default
+        onset_renew(x, x->x_nchans);
+    else for(int i = 0; i < x->x_nchans; i++)
+        aubio_onset_set_threshold(x->x_ch[i].c_o, x->x_thresh);
+}
+
+static void onset_silence(t_onset *x, t_floatarg f){
+    x->x_silence = f;
+    for(int i = 0; i < x->x_nchans; i++)
+        aubio_onset_set_silence(x->x_ch[i].c_o, f);
+}
+
+static void onset_minioi(t_onset *x, t_floatarg f){
+    x->x_minioi = f < 0 ? 0 : f;
+    for(int i = 0; i < x->x_nchans; i++)
+        aubio_onset_set_minioi_ms(x->x_ch[i].c_o, x->x_minioi);
+}
+
+static t_int *onset_perform(t_int *w){
+    t_onset *x = (t_onset *)(w[1]);
+    t_sample *in = (t_sample *)(w[2]);
+    t_sample *out = (t_sample *)(w[3]);
+    int n = (int)(w[4]);
+    uint_t hop = x->x_hopsize;
+    for(int j = 0; j < x->x_nchans; j++){
+        t_onset_ch *c = &x->x_ch[j];
+        smpl_t *vec = c->c_in->data;
+        for(int i = 0; i < n; i++){
+            vec[c->c_pos] = (smpl_t)in[j*n + i];
+            out[j*n + i] = 0;
+            if(++c->c_pos == hop){
+                aubio_onset_do(c->c_o, c->c_in, c->c_out);
+                if(c->c_out->data[0] > 0)
+                    out[j*n + i] = 1;
+                c->c_pos = 0;
+            }
+        }
+    }
+    return(w+5);
+}
+
+static void onset_dsp(t_onset *x, t_signal **sp){
+    uint_t sr = (uint_t)sp[0]->s_sr;
+    int chs = sp[0]->s_nchans;
+    if(sr != x->x_sr || chs != x->x_nchans){
+        x->x_sr = sr;
+        onset_renew(x, chs);
+    }
+    signal_setmultiout(&sp[1], chs);
+    dsp_add(onset_perform, 4, x, sp[0]->s_vec, sp[1]->s_vec, (t_int)sp[0]->s_n);
+}
+
+static void onset_free(t_onset *x){
+    onset_delete(x);
+}
+
+static void *onset_new(t_symbol *s, int ac, t_atom *av){
+    s = NULL;
+    t_onset *x = (t_onset *)pd_new(onset_class);
+    x->x_wsize = 1024;
+    x->x_hopsize = 512;
+    x->x_mode = 0; // hfc
+    x->x_thresh = 0;
+    x->x_silence = -70;
+    x->x_minioi = -1;
+    int floatarg = 0;
+    while(ac){
+        if((av)->a_type == A_SYMBOL){
+            if(floatarg)
+                goto errstate;
+            t_symbol *sym = atom_getsymbol(av);
+            ac--, av++;
+            if(!ac || (av)->a_type != A_FLOAT)
+                goto errstate;
+            t_float f = atom_getfloat(av);
+            ac--, av++;
+            if(sym == gensym("-mode"))
+                x->x_mode = f < 0 ? 0 : f > 8 ? 8 : (int)f;
+            else if(sym == gensym("-silence"))
+                x->x_silence = f;
+            else if(sym == gensym("-minioi"))
+                x->x_minioi = f < 0 ? 0 : f;
+            else
+                goto errstate;
+        }
+        else{
+            floatarg = 1;
+            t_float f = atom_getfloat(av);
+            x->x_thresh = f < 0 ? 0 : f;
+            ac--, av++;
+            if(ac && (av)->a_type == A_FLOAT){ // wsize
+                x->x_wsize = onset_pow2(atom_getfloat(av));
+                ac--, av++;
+                if(ac && (av)->a_type == A_FLOAT){ // hop
+                    x->x_hopsize = atom_getfloat(av);
+                    ac--, av++;
+                }
+            }
+        }
+    }
+    if(x->x_hopsize < MIN_BUFFER_SIZE)
+        x->x_hopsize = MIN_BUFFER_SIZE;
+    if(x->x_hopsize > x->x_wsize)
+        x->x_hopsize = x->x_wsize;
+    x->x_sr = (uint_t)sys_getsr();
+    onset_renew(x, 1);
+    outlet_new(&x->x_obj, &s_signal);
+    return(void *)x;
+errstate:
+    pd_error(x, "[onset~]: improper args");
+    return(NULL);
+}
+
+void onset_tilde_setup(void){
+    onset_class = class_new(gensym("onset~"), (t_newmethod)onset_new,
+        (t_method)onset_free, sizeof(t_onset), CLASS_MULTICHANNEL, A_GIMME, 0);
+    CLASS_MAINSIGNALIN(onset_class, t_onset, x_f);
+    class_addmethod(onset_class, (t_method)onset_dsp, gensym("dsp"), A_CANT, 0);
+    class_addmethod(onset_class, (t_method)onset_mode, gensym("mode"), A_DEFFLOAT, 0);
+    class_addmethod(onset_class, (t_method)onset_window, gensym("window"), A_DEFFLOAT, 0);
+    class_addmethod(onset_class, (t_method)onset_hop, gensym("hop"), A_DEFFLOAT, 0);
+    class_addmethod(onset_class, (t_method)onset_thresh, gensym("thresh"), A_DEFFLOAT, 0);
+    class_addmethod(onset_class, (t_method)onset_silence, gensym("silence"), A_DEFFLOAT, 0);
+    class_addmethod(onset_class, (t_method)onset_minioi, gensym("minioi"), A_DEFFLOAT, 0);
+}
@@ -16,7 +16,9 @@
 #define SCOPE_MINDELAY      0
 #define SCOPE_SELBDWIDTH    2
 #define HANDLE_SIZE         12
-#define SCOPE_GUICHUNK      128 // performance-related hacks, LATER investigate
+#define SCOPE_MAXCOORDS     (SCOPE_MAXBUFSIZE*4) // x/y pairs, 2 per point at most
+#define SCOPE_GUIBUFSIZE    (SCOPE_MAXCOORDS*12 + 256)
+#define SCOPE_DEFFPS        60
 
 typedef struct _edit_proxy{
     t_object        p_obj;
@@ -36,6 +38,11 @@ typedef struct _scope{
     float           x_ybuffer[SCOPE_MAXBUFSIZE*4];
     float           x_xbuflast[SCOPE_MAXBUFSIZE*4];
     float           x_ybuflast[SCOPE_MAXBUFSIZE*4];
+    int             x_coords[SCOPE_MAXCOORDS]; // last frame sent to the gui
+    int             x_ncoords;
+    float           x_fps; // max frame rate, 0 is unlimited
+    double          x_lastdraw;
+    int             x_waiting; // a frame is being held back by the frame rate
     float           x_min, x_max;
     float           x_trigx, x_triglevel;
     float           x_ksr;
@@ -99,60 +106,102 @@ static void scope_draw_handle(t_scope *x, int state){
     }
 }
 
-static void scope_drawfg(t_scope *x, t_canvas *cv, int x1, int y1, int x2, int y2){
-    float dx, dy, xx = 0, yy = 0, oldx, oldy, sc, xsc, ysc;
-    float *xbp = x->x_xbuflast, *ybp = x->x_ybuflast;
-    int bufsize = x->x_lastbufsize;
-    if(x->x_xymode == 1){
-        dx = (float)(x2 - x1) / (float)bufsize;
-        oldx = x1;
-        sc = ((float)x->x_height - 2.) / (float)(x->x_max - x->x_min);
-    }
-    else if(x->x_xymode == 2){
-        dy = (float)(y2 - y1) / (float)bufsize;
-        oldy = y1;
-        sc = ((float)x->x_width - 2.) / (float)(x->x_max - x->x_min);
-    }
-    else if(x->x_xymode == 3){
-        xsc = ((float)x->x_width - 2.) / (float)(x->x_max - x->x_min);
-        ysc = ((float)x->x_height - 2.) / (float)(x->x_max - x->x_min);
-    }
-    sys_vgui(".x%lx.c create line \\\n", cv);
-    for(int i = 0; i < bufsize; i++){
-        if(x->x_xymode == 1){
-            xx = oldx;
-            yy = (y2 - 1) - sc * (*xbp++ - x->x_min);
-            if(yy > y2)
-                yy = y2;
-            else if(yy < y1)
-                yy = y1;
-            oldx += dx;
-        }
-        else if(x->x_xymode == 2){
-            yy = oldy;
-            xx = (x2 - 1) - sc * (*ybp++ - x->x_min);
-            if(xx > x2)
-                xx = x2;
-            else if(xx < x1)
-                xx = x1;
-            oldy += dy;
+static void scope_push(int *c, int *n, int col, int v){
+    if(*n && c[*n-2] == col && c[*n-1] == v)
+        return;
+    c[(*n)++] = col, c[(*n)++] = v;
+}
+
+// Pixel coordinates of the last frame. There's no point in sending more than
+// one line segment per pixel, so when a time axis has more points than pixels
+// each column is reduced to its min and max (in the order they occurred)
+static int scope_coords(t_scope *x, int *c, int x1, int y1, int x2, int y2){
+    float *xbp = x->x_xbuflast, *ybp = x->x_ybuflast, min = x->x_min;
+    int bufsize = x->x_lastbufsize, xymode = x->x_xymode, n = 0;
+    if(xymode == 1 || xymode == 2){
+        float *bp = xymode == 1 ? xbp : ybp;
+        float pos = xymode == 1 ? x1 : y1;
+        float step = (float)(xymode == 1 ? x2 - x1 : y2 - y1) / (float)bufsize;
+        float sc = ((float)(xymode == 1 ? x->x_height : x->x_width) - 2.) / (float)(x->x_max - min);
+        int lo = xymode == 1 ? y1 : x1, hi = xymode == 1 ? y2 : x2;
+        int col = 0, first = 0, last = 0, vmin = 0, vmax = 0, minfirst = 0;
+        for(int i = 0; i <= bufsize; i++){
+            int p = 0, v = 0;
+            if(i < bufsize){
+                p = (int)pos, v = (int)((hi - 1) - sc * (bp[i] - min));
+                v = v > hi ? hi : v < lo ? lo : v;
+                pos += step;
+                if(i && p == col){
+                    if(v < vmin)
+                        vmin = v, minfirst = 0; // max came first
+                    else if(v > vmax)
+                        vmax = v, minfirst = 1;
+                    last = v;
+                    continue;
+                }
+            }
+            if(i){ // flush previous column
+                scope_push(c, &n, col, first);
+                scope_push(c, &n, col, minfirst ? vmin : vmax);
+                scope_push(c, &n, col, minfirst ? vmax : vmin);
+                scope_push(c, &n, col, last);
+            }
+            col = p, first = last = vmin = vmax = v;
         }
-        else if(x->x_xymode == 3){
-            xx = x1 + xsc * (*xbp++ - x->x_min);
-            yy = y2 - ysc * (*ybp++ - x->x_min);
-            if(xx > x2)
-                xx = x2;
-            else if(xx < x1)
-                xx = x1;
-            if(yy > y2)
-                yy = y2;
-            else if(yy < y1)
-                yy = y1;
+        if(xymode == 2) // coords are (y, x) pairs so far
+            for(int i = 0; i < n; i += 2){
+                int t = c[i];
+                c[i] = c[i+1], c[i+1] = t;
+            }
+    }
+    else if(xymode == 3){ // drop points that land on the same pixel as the previous one
+        float xsc = ((float)x->x_width - 2.) / (float)(x->x_max - min);
+        float ysc = ((float)x->x_height - 2.) / (float)(x->x_max - min);
+        for(int i = 0; i < bufsize; i++){
+            int xx = (int)(x1 + xsc * (xbp[i] - min));
+            int yy = (int)(y2 - ysc * (ybp[i] - min));
+            xx = xx > x2 ? x2 : xx < x1 ? x1 : xx;
+            yy = yy > y2 ? y2 : yy < y1 ? y1 : yy;
+            if(n && xx == c[n-2] && yy == c[n-1])
+                continue;
+            c[n++] = xx, c[n++] = yy;
         }
-        sys_vgui("%d %d \\\n", (int)xx, (int)yy);
     }
-    sys_vgui("-fill #%2.2x%2.2x%2.2x -width %d -tags {fg%lx all%lx}\n",
-        x->x_fg[0], x->x_fg[1], x->x_fg[2], x->x_zoom, x, x);
+    if(n == 2) // tk wants at least 2 points for a line
+        c[2] = c[0], c[3] = c[1], n = 4;
+    return(n);
+}
+
+static char *scope_itoa(char *p, int v){ // way cheaper than sprintf()
+    char tmp[12];
+    int n = 0;
+    unsigned int u = v < 0 ? -(unsigned int)v : (unsigned int)v;
+    if(v < 0)
+        *p++ = '-';
+    do{
+        tmp[n++] = '0' + u % 10;
+        u /= 10;
+    }while(u);
+    while(n)
+        *p++ = tmp[--n];
+    *p++ = ' ';
+    return(p);
+}
+
+static char *scope_format(t_scope *x, char *p){
+    for(int i = 0; i < x->x_ncoords; i++)
+        p = scope_itoa(p, x->x_coords[i]);
+    return(p);
+}
+
+static void scope_drawfg(t_scope *x, t_canvas *cv, int x1, int y1, int x2, int y2){
+    char buf[SCOPE_GUIBUFSIZE], *p = buf;
+    x->x_ncoords = scope_coords(x, x->x_coords, x1, y1, x2, y2);
+    p += sprintf(p, ".x%lx.c create line ", (unsigned long)cv);
+    p = scope_format(x, p);
+    sprintf(p, "-fill #%2.2x%2.2x%2.2x -width %d -tags {fg%lx all%lx}\n",
+        x->x_fg[0], x->x_fg[1], x->x_fg[2], x->x_zoom, (unsigned long)x, (unsigned long)x);
+    sys_gui(buf);
 }
 
 static void scope_draw_grid(t_scope *x, t_canvas *cv, int x1, int y1, int x2, int y2){
@@ -193,104 +242,18 @@ static void scope_draw(t_scope *x, t_canvas *cv){
 }
 
 static void scope_redraw(t_scope *x, t_canvas *cv){
-    char chunk[32 * SCOPE_GUICHUNK];  // LATER estimate
-    char *chunkp = chunk;
-    int bufsize, nleft = bufsize = x->x_lastbufsize, x1, y1, x2, y2, xymode = x->x_xymode;
+    int c[SCOPE_MAXCOORDS], x1, y1, x2, y2;
     scope_getrect((t_gobj *)x, x->x_glist, &x1, &y1, &x2, &y2);
-    float dx, dy, xx, yy, oldx, oldy, sc, xsc, ysc;
-    float *xbp = x->x_xbuflast, *ybp = x->x_ybuflast;
-    if(xymode == 1){
-        dx = (float)(x2 - x1) / (float)bufsize;
-        oldx = x1;
-        sc = ((float)x->x_height - 2.) / (float)(x->x_max - x->x_min);
-    }
-    else if(xymode == 2){
-        dy = (float)(y2 - y1) / (float)bufsize;
-        oldy = y1;
-        sc = ((float)x->x_width - 2.) / (float)(x->x_max - x->x_min);
-    }
-    else if(xymode == 3){
-        xsc = ((float)x->x_width - 2.) / (float)(x->x_max - x->x_min);
-        ysc = ((float)x->x_height - 2.) / (float)(x->x_max - x->x_min);
-    }
-    sys_vgui(".x%lx.c coords fg%lx\\\n", cv, x);
-    while(nleft > SCOPE_GUICHUNK){
-        int i = SCOPE_GUICHUNK;
-        while(i--){
-            if(xymode == 1){
-                xx = oldx;
-                yy = (y2 - 1) - sc * (*xbp++ - x->x_min);
-                if(yy > y2)
-                    yy = y2;
-                else if(yy < y1)
-                    yy = y1;
-                oldx += dx;
-            }
-            else if(xymode == 2){
-                yy = oldy;
-                xx = (x2 - 1) - sc * (*ybp++ - x->x_min);
-                if(xx > x2)
-                    xx = x2;
-                else if(xx < x1)
-                    xx = x1;
-                oldy += dy;
-            }
-            else if(xymode == 3){
-                xx = x1 + xsc * (*xbp++ - x->x_min);
-                yy = y2 - ysc * (*ybp++ - x->x_min);
-                if(xx > x2)
-                    xx = x2;
-                else if(xx < x1)
-                    xx = x1;
-                if(yy > y2)
-                    yy = y2;
-                else if(yy < y1)
-                    yy = y1;
-            }
-            sprintf(chunkp, "%d %d ", (int)xx, (int)yy);
-            chunkp += strlen(chunkp);
-        }
-        strcpy(chunkp, "\\\n");
-        sys_gui(chunk);
-        chunkp = chunk;
-        nleft -= SCOPE_GUICHUNK;
-    }
-    while(nleft--){
-        if(xymode == 1){
-            xx = oldx;
-            yy = (y2 - 1) - sc * (*xbp++ - x->x_min);
-            if(yy > y2)
-                yy = y2;
-            else if(yy < y1)
-                yy = y1;
-            oldx += dx;
-        }
-        else if(xymode == 2){
-            yy = oldy;
-            xx = (x2 - 1) - sc * (*ybp++ - x->x_min);
-            if(xx > x2)
-                xx = x2;
-            else if(xx < x1)
-                xx = x1;
-            oldy += dy;
-        }
-        else if(xymode == 3){
-            xx = x1 + xsc * (*xbp++ - x->x_min);
-            yy = y2 - ysc * (*ybp++ - x->x_min);
-            if(xx > x2)
-                xx = x2;
-            else if(xx < x1)
-                xx = x1;
-            if(yy > y2)
-                yy = y2;
-            else if(yy < y1)
-                yy = y1;
-        }
-        sprintf(chunkp, "%d %d ", (int)xx, (int)yy);
-        chunkp += strlen(chunkp);
-    }
-    strcpy(chunkp, "\n");
-    sys_gui(chunk);
+    int n = scope_coords(x, c, x1, y1, x2, y2);
+    if(n == x->x_ncoords && !memcmp(c, x->x_coords, n * sizeof(*c)))
+        return; // nothing changed on screen
+    memcpy(x->x_coords, c, n * sizeof(*c));
+    x->x_ncoords = n;
+    char buf[SCOPE_GUIBUFSIZE], *p = buf; // the whole frame goes in one message
+    p += sprintf(p, ".x%lx.c coords fg%lx ", (unsigned long)cv, (unsigned long)x);
+    p = scope_format(x, p);
+    *p++ = '\n', *p = 0;
+    sys_gui(buf);
 }
 
 //------------------ WIDGET -----------------------------------------------------------------
@@ -544,6 +507,10 @@ static void edit_proxy_any(t_edit_proxy *p, t_symbol *s, int ac, t_atom *av){
     }
 }
 
+static void scope_fps(t_scope *x, t_floatarg f){
+    x->x_fps = f < 0 ? 0 : f;
+}
+
 static void scope_zoom(t_scope *x, t_floatarg zoom){
     float mul = (zoom == 1. ? 0.5 : 2.);
     x->x_width*=mul, x->x_height*=mul;
@@ -738,7 +705,8 @@ static t_int *scope_perform(t_int *w){
                         memcpy(x->x_ybuflast, x->x_ybuffer, bufsize * sizeof(*x->x_ybuffer));
                         x->x_retrigger = (x->x_trigmode != 0);
                         x->x_trigx = x->x_triglevel;
-                        clock_delay(x->x_clock, 0);
+                        if(!x->x_waiting)
+                            clock_delay(x->x_clock, 0);
                     }
                     else{
                         *bp1 = currx;
@@ -776,9 +744,19 @@ static void scope_dsp(t_scope *x, t_signal **sp){
 }
 
 static void scope_tick(t_scope *x){
+    x->x_precount = (int)(x->x_delay * x->x_ksr);
+    if(x->x_fps > 0){ // hold the frame back, newer ones replace it meanwhile
+        double wait = 1000. / x->x_fps - clock_gettimesince(x->x_lastdraw);
+        if(wait > 0){
+            x->x_waiting = 1;
+            clock_delay(x->x_clock, wait);
+            return;
+        }
+    }
+    x->x_waiting = 0;
+    x->x_lastdraw = clock_getlogicaltime();
     if(glist_isvisible(x->x_glist)  && gobj_shouldvis((t_gobj *)x, x->x_glist) && x->x_xymode)
         scope_redraw(x, glist_getcanvas(x->x_glist));
-    x->x_precount = (int)(x->x_delay * x->x_ksr);
 }
 
 static void scope_get_rcv(t_scope* x){
@@ -817,11 +795,11 @@ static void scope_save(t_gobj *z, t_binbuf *b){
     t_scope *x = (t_scope *)z;
     t_text *t = (t_text *)x;
     scope_get_rcv(x);
-    binbuf_addv(b, "ssiisiiiiiffiiifiiiiiiiiiis;", gensym("#X"), gensym("obj"), (int)t->te_xpix,
+    binbuf_addv(b, "ssiisiiiiiffiiifiiiiiiiiiisf;", gensym("#X"), gensym("obj"), (int)t->te_xpix,
         (int)t->te_ypix, atom_getsymbol(binbuf_getvec(t->te_binbuf)), x->x_width/x->x_zoom,
         x->x_height/x->x_zoom, x->x_period, 3, x->x_bufsize, x->x_min, x->x_max, x->x_delay,
         0, x->x_trigmode, x->x_triglevel, x->x_fg[0], x->x_fg[1], x->x_fg[2], x->x_bg[0],
-        x->x_bg[1], x->x_bg[2], x->x_gg[0], x->x_gg[1], x->x_gg[2], 0, x->x_rcv_raw);
+        x->x_bg[1], x->x_bg[2], x->x_gg[0], x->x_gg[1], x->x_gg[2], 0, x->x_rcv_raw, x->x_fps);
 }
 
 static void scope_properties(t_gobj *z, t_glist *owner){
@@ -974,7 +952,7 @@ static void *scope_new(t_symbol *s, int ac, t_atom *av){
     x->x_flag = x->x_r_flag = x->x_rcv_set = x->x_select = 0;
     x->x_phase = x->x_bufphase = x->x_precount = 0;
     float width = 200, height = 100, period = 256, bufsize = x->x_lastbufsize = 128; // def values
-    float minval = -1, maxval = 1, delay = 0, trigger = 0, triglevel = 0; // def
+    float minval = -1, maxval = 1, delay = 0, trigger = 0, triglevel = 0, fps = SCOPE_DEFFPS; // def
     unsigned char bgred = 190, bggreen = 190, bgblue = 190;    // default bg color
     unsigned char fgred = 30, fggreen = 30, fgblue = 30; // default fg color
     unsigned char grred = 160, grgreen = 160, grblue = 160;   // default grid color
@@ -1084,6 +1062,10 @@ static void *scope_new(t_symbol *s, int ac, t_atom *av){
                                                                                                     rcv = av->a_w.w_symbol;
                                                                                                     ac--, av++;
                                                                                                 }
+                                                                                                if(ac && av->a_type == A_FLOAT){ // 23rd fps
+                                                                                                    fps = av->a_w.w_float;
+                                                                                                    ac--, av++;
+                                                                                                }
                                                                                             }
                                                                                         }
                                                                                     }
@@ -1175,6 +1157,11 @@ static void *scope_new(t_symbol *s, int ac, t_atom *av){
                 grblue = grblue < 0 ? 0 : grblue > 255 ? 255 : grblue;
                 ac-=4, av+=4;
             }
+            else if(sym == gensym("-fps") && ac >= 2){
+                x->x_flag = 1;
+                fps = atom_getfloatarg(1, ac, av);
+                ac-=2, av+=2;
+            }
             else if(sym == gensym("-receive") && ac >= 2){
                 x->x_flag = x->x_r_flag = 1;
                 rcv = atom_getsymbolarg(1, ac, av);
@@ -1204,6 +1191,9 @@ static void *scope_new(t_symbol *s, int ac, t_atom *av){
     else
         x->x_min = minval, x->x_max = maxval;
     x->x_delay = delay < 0 ? 0 : delay;
+    x->x_fps = fps < 0 ? 0 : fps;
+    x->x_ncoords = x->x_waiting = 0;
+    x->x_lastdraw = clock_getlogicaltime();
     x->x_triglevel = triglevel;
     x->x_trigmode = trigger < 0 ? 0 : trigger > 2 ? 2 : (int)trigger;
     if(x->x_trigmode == 0) // no trigger
@@ -1239,6 +1229,7 @@ void oscope_tilde_setup(void){
     class_addmethod(scope_class, (t_method)scope_dim, gensym("dim"), A_GIMME, 0);
     class_addmethod(scope_class, (t_method)scope_range, gensym("range"), A_FLOAT, A_FLOAT, 0);
     class_addmethod(scope_class, (t_method)scope_delay, gensym("delay"), A_FLOAT, 0);
+    class_addmethod(scope_class, (t_method)scope_fps, gensym("fps"), A_FLOAT, 0);
     class_addmethod(scope_class, (t_method)scope_trigger, gensym("trigger"), A_FLOAT, 0);
     class_addmethod(scope_class, (t_method)scope_triglevel, gensym("triglevel"), A_FLOAT, 0);
     class_addmethod(scope_class, (t_method)scope_fgcolor, gensym("fgcolor"),
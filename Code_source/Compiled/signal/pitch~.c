@@ -0,0 +1,241 @@
+// a pd wrapper for aubio pitch detection functions
+
+#include <m_pd.h>
+#include <aubio/src/aubio.h>
+
+// Each channel runs its own aubio pitch detector. Their hops are staggered,
+// so with many channels the analysis frames fall on different blocks
+// instead of all landing on the same one every hop.
+
+#define MIN_BUFFER_SIZE 64
+#define MAX_BUFFER_SIZE 32768
+
+static t_class *pitch_class;
+
+typedef struct _pitch_ch{
+    aubio_pitch_t  *c_p;
+    fvec_t         *c_in;
+    fvec_t         *c_out;
+    uint_t          c_pos;
+    t_sample        c_freq;
+    t_sample        c_conf;
+}t_pitch_ch;
+
+typedef struct _pitch{
+    t_object        x_obj;
+    t_float         x_f;
+    uint_t          x_sr;
+    int             x_wsize;
+    int             x_hopsize;
+    int             x_mode;
+    int             x_midi;
+    t_float         x_tolerance;    // 0 for the method's default
+    t_float         x_silence;
+    int             x_nchans;
+    t_pitch_ch     *x_ch;
+}t_pitch;
+
+static const char* modelLabels[7] ={
+    "yinfast",
+    "yin",
+    "yinfft",
+    "mcomb",
+    "fcomb",
+    "schmitt",
+    "specacf",
+};
+
+static int pitch_pow2(t_float f){ // aubio's own fft takes powers of 2 only
+    int size = MIN_BUFFER_SIZE;
+    while(size < f && size < MAX_BUFFER_SIZE)
+        size *= 2;
+    return(size);
+}
+
+static void pitch_set(t_pitch *x, t_pitch_ch *c){
+    if(x->x_tolerance > 0)
+        aubio_pitch_set_tolerance(c->c_p, x->x_tolerance);
+    aubio_pitch_set_silence(c->c_p, x->x_silence);
+    aubio_pitch_set_unit(c->c_p, x->x_midi ? "midi" : "Hz");
+}
+
+static void pitch_delete(t_pitch *x){
+    for(int i = 0; i < x->x_nchans; i++){
+        del_aubio_pitch(x->x_ch[i].c_p);
+        del_fvec(x->x_ch[i].c_in);
+        del_fvec(x->x_ch[i].c_out);
+    }
+    freebytes(x->x_ch, x->x_nchans * sizeof(*x->x_ch));
+    x->x_ch = NULL;
+    x->x_nchans = 0;
+}
+
+// (re)make the detectors, channel i starts its hop i/n of the way into it
+static void pitch_renew(t_pitch *x, int nchans){
+    pitch_delete(x);
+    x->x_ch = (t_pitch_ch *)getbytes(nchans * sizeof(*x->x_ch));
+    for(int i = 0; i < nchans; i++){
+        t_pitch_ch *c = &x->x_ch[i];
+        c->c_p = new_aubio_pitch(modelLabels[x->x_mode],
+            x->x_wsize, x->x_hopsize, x->x_sr);
+        c->c_in = new_fvec(x->x_hopsize);
+        c->c_out = new_fvec(1);
+        c->c_pos = (uint_t)((long)x->x_hopsize * i / nchans);
+        c->c_freq = c->c_conf = 0;
+        pitch_set(x, c);
+    }
+    x->x_nchans = nchans;
+}
+
+static void pitch_mode(t_pitch *x, t_floatarg f){
+    x->x_mode = f < 0 ? 0 : f > 6 ? 6 : (int)f;
+    pitch_renew(x, x->x_nchans);
+}
+
+static void pitch_window(t_pitch *x, t_floatarg f){
+    x->x_wsize = pitch_pow2(f);
+    if(x->x_hopsize > x->x_wsize)
+        x->x_hopsize = x->x_wsize;
+    pitch_renew(x, x->x_nchans);
+}
+
+static void pitch_hop(t_pitch *x, t_floatarg f){
+    x->x_hopsize = f < MIN_BUFFER_SIZE ? MIN_BUFFER_SIZE :
+        f > x->x_wsize ? x->x_wsize : (int)f;
+    pitch_renew(x, x->x_nchans);
+}
+
+static void pitch_tolerance(t_pitch *x, t_floatarg f){
+    x->x_tolerance = f < 0 ? 0 : f;
+    if(x->x_tolerance == 0) // back to the method's default
+        pitch_renew(x, x->x_nchans);
+    else for(int i = 0; i < x->x_nchans; i++)
+        aubio_pitch_set_tolerance(x->x_ch[i].c_p, x->x_tolerance);
+}
+
+static void pitch_silence(t_pitch *x, t_floatarg f){
+    x->x_silence = f;
+    for(int i = 0; i < x->x_nchans; i++)
+        aubio_pitch_set_silence(x->x_ch[i].c_p, f);
+}
+
+static void pitch_midi(t_pitch *x, t_floatarg f){
+    x->x_midi = (f != 0);
+    for(int i = 0; i < x->x_nchans; i++)
+        aubio_pitch_set_unit(x->x_ch[i].c_p, x->x_midi ? "midi" : "Hz");
+}
+
+static t_int *pitch_perform(t_int *w){
+    t_pitch *x = (t_pitch *)(w[1]);
+    t_sample *in = (t_sample *)(w[2]);
+    t_sample *out1 = (t_sample *)(w[3]);
+    t_sample *out2 = (t_sample *)(w[4]);
+    int n = (int)(w[5]);
+    uint_t hop = x->x_hopsize;
+    for(int j = 0; j < x->x_nchans; j++){
+        t_pitch_ch *c = &x->x_ch[j];
+        smpl_t *vec = c->c_in->data;
+        for(int i = 0; i < n; i++){
+            vec[c->c_pos] = (smpl_t)in[j*n + i];
+            if(++c->c_pos == hop){
+                aubio_pitch_do(c->c_p, c->c_in, c->c_out);
+                c->c_freq = c->c_out->data[0];
+                c->c_conf = aubio_pitch_get_confidence(c->c_p);
+                c->c_pos = 0;
+            }
+            out1[j*n + i] = c->c_freq;
+            out2[j*n + i] = c->c_conf;
+        }
+    }
+    return(w+6);
+}
+
+static void pitch_dsp(t_pitch *x, t_signal **sp){
+    uint_t sr = (uint_t)sp[0]->s_sr;
+    int chs = sp[0]->s_nchans;
+    if(sr != x->x_sr || chs != x->x_nchans){
+        x->x_sr = sr;
+        pitch_renew(x, chs);
+    }
+    signal_setmultiout(&sp[1], chs);
+    signal_setmultiout(&sp[2], chs);
+    dsp_add(pitch_perform, 5, x, sp[0]->s_vec, sp[1]->s_vec,
+        sp[2]->s_vec, (t_int)sp[0]->s_n);
+}
+
+static void pitch_free(t_pitch *x){
+    pitch_delete(x);
+}
+
+static void *pitch_new(t_symbol *s, int ac, t_atom *av){
+    s = NULL;
+    t_pitch *x = (t_pitch *)pd_new(pitch_class);
+    x->x_wsize = 2048;
+    x->x_hopsize = 512;
+    x->x_mode = 0; // yinfast
+    x->x_midi = 0;
+    x->x_tolerance = 0;
+    x->x_silence = -70;
+    int floatarg = 0;
+    while(ac){
+        if((av)->a_type == A_SYMBOL){
+            if(floatarg)
+                goto errstate;
+            t_symbol *sym = atom_getsymbol(av);
+            ac--, av++;
+            if(sym == gensym("-midi"))
+                x->x_midi = 1;
+            else if(!ac || (av)->a_type != A_FLOAT)
+                goto errstate;
+            else{
+                t_float f = atom_getfloat(av);
+                ac--, av++;
+                if(sym == gensym("-mode"))
+                    x->x_mode = f < 0 ? 0 : f > 6 ? 6 : (int)f;
+                else if(sym == gensym("-silence"))
+                    x->x_silence = f;
+                else
+                    goto errstate;
+            }
+        }
+        else{
+            floatarg = 1;
+            t_float f = atom_getfloat(av);
+            x->x_tolerance = f < 0 ? 0 : f;
+            ac--, av++;
+            if(ac && (av)->a_type == A_FLOAT){ // wsize
+                x->x_wsize = pitch_pow2(atom_getfloat(av));
+                ac--, av++;
+                if(ac && (av)->a_type == A_FLOAT){ // hop
+                    x->x_hopsize = atom_getfloat(av);
+                    ac--, av++;
+                }
+            }
+        }
+    }
+    if(x->x_hopsize < MIN_BUFFER_SIZE)
+        x->x_hopsize = MIN_BUFFER_SIZE;
+    if(x->x_hopsize > x->x_wsize)
+        x->x_hopsize = x->x_wsize;
+    x->x_sr = (uint_t)sys_getsr();
+    pitch_renew(x, 1);
+    outlet_new(&x->x_obj, &s_signal);
+    outlet_new(&x->x_obj, &s_signal);
+    return(void *)x;
+errstate:
+    pd_error(x, "[pitch~]: improper args");
+    return(NULL);
+}
+
+void pitch_tilde_setup(void){
+    pitch_class = class_new(gensym("pitch~"), (t_newmethod)pitch_new,
+        (t_method)pitch_free, sizeof(t_pitch), CLASS_MULTICHANNEL, A_GIMME, 0);
+    CLASS_MAINSIGNALIN(pitch_class, t_pitch, x_f);
+    class_addmethod(pitch_class, (t_method)pitch_dsp, gensym("dsp"), A_CANT, 0);
+    class_addmethod(pitch_class, (t_method)pitch_mode, gensym("mode"), A_DEFFLOAT, 0);
+    class_addmethod(pitch_class, (t_method)pitch_window, gensym("window"), A_DEFFLOAT, 0);
+    class_addmethod(pitch_class, (t_method)pitch_hop, gensym("hop"), A_DEFFLOAT, 0);
+    class_addmethod(pitch_class, (t_method)pitch_tolerance, gensym("tolerance"), A_DEFFLOAT, 0);
+    class_addmethod(pitch_class, (t_method)pitch_silence, gensym("silence"), A_DEFFLOAT, 0);
+    class_addmethod(pitch_class, (t_method)pitch_midi, gensym("midi"), A_DEFFLOAT, 0);
+}
@@ -4,12 +4,33 @@
 #include "m_pd.h"
 #include "g_canvas.h"
 #include <stdint.h>
+#include <string.h>
+#include <math.h>
 #include "plaits/dsp/dsp.h"
 #include "plaits/dsp/engine/engine.h"
 #include "plaits/dsp/voice.h"
 
+#define MAXVOICES 64
+
+// Resampler from plaits' native 48kHz to Pd's rate: a windowed sinc table of
+// RS_PHASES polyphase filters with RS_TAPS taps, interpolated between phases
+#define RS_SR       48000.
+#define RS_TAPS     16
+#define RS_HALF     (RS_TAPS/2) // latency in 48kHz samples
+#define RS_PHASES   128
+
 static t_class *plts_class;
 
+typedef struct _plts_voice{
+    plaits::Voice voice;
+    plaits::Modulations modulations;
+    char shared_buffer[16384];
+    float *rs_out;      // 48kHz outputs waiting to be resampled
+    float *rs_aux;
+    int rs_fill;
+    double rs_pos;      // position of the next output in the 48kHz buffers
+}t_plts_voice;
+
 typedef struct _plts{
     t_object x_obj;
     t_glist  *x_glist;
@@ -35,14 +56,21 @@ typedef struct _plts{
     bool level_active;
     t_int block_size;
     t_int block_count;
-    t_int last_n;
     t_float last_tigger;
     t_int last_engine;
     t_int last_engine_perform;
-    plaits::Voice voice;
     plaits::Patch patch;
-    plaits::Modulations modulations;
-    char shared_buffer[16384];
+    t_plts_voice *x_voices;
+    t_int x_nvoices;
+    t_int x_ch[3];      // pitch, trigger and level channels: 1 or one per voice
+    t_float *x_notes;   // note of each render call in the block
+    t_int x_nnotes;
+    plaits::Voice::Frame x_frames[plaits::kMaxBlockSize];
+    bool x_native;      // render at 48kHz and resample
+    double x_rsstep;    // 48kHz samples per output sample, 0 if not resampling
+    t_float x_rssr;     // rate the table was made for
+    t_float *x_rstable; // (RS_PHASES + 1) * RS_TAPS
+    t_int x_rssize;     // size of each voice's buffers
     t_inlet *x_trig_in;
     t_inlet *x_level_in;
     t_outlet *x_out1;
@@ -70,6 +98,7 @@ extern "C"  { // Pure data methods, needed because we are using C++
     void plts_dump(t_plts *x);
     void plts_print(t_plts *x);
     void plts_trigger_mode(t_plts *x, t_floatarg f);
+    void plts_native(t_plts *x, t_floatarg f);
 }
 
 static const char* modelLabels[16] = {
@@ -171,43 +200,44 @@ void plts_trigger_mode(t_plts *x, t_floatarg f){
     x->trigger_mode = (int)(f != 0);
 }
 
-static float plts_get_pitch(t_plts *x, t_floatarg f){
-    if(x->pitch_mode == 0){
-        f = log2f((f < 0 ? f * -1 : f)/440) + 0.75;
-        return(f);
+void plts_native(t_plts *x, t_floatarg f){
+    if(x->x_native != (f != 0)){
+        x->x_native = (f != 0);
+        canvas_update_dsp();
     }
-    else if(x->pitch_mode == 1)
-        return((f - 60) / 12);
-    else if(x->pitch_mode == 2)
-        return(f*5);
-    else
-        return(f);
 }
 
-t_int *plts_perform(t_int *w){
-    t_plts *x = (t_plts *) (w[1]);
-    t_sample *pitch_inlet = (t_sample *) (w[2]);
-    t_sample *trig = (t_sample *) (w[3]);
-    t_sample *level = (t_sample *) (w[4]);
-    t_sample *out = (t_sample *) (w[5]);
-    t_sample *aux = (t_sample *) (w[6]);
-    int n = (int)(w[7]); // Determine block size
-    if(n != x->last_n){
-        if(n > 24){ // Plaits uses a block size of 24 max
-            int block_size = 24;
-            while(n > 24 && n % block_size > 0)
-                block_size--;
-            x->block_size = block_size;
-            x->block_count = n / block_size;
-        }
-        else{
-            x->block_size = n;
-            x->block_count = 1;
+// Converts every 'step' samples of the pitch input to notes, all at once
+static void plts_get_notes(t_plts *x, t_sample *in, int step, int count, t_float *notes){
+    int bs = step;
+    float correction = x->pitch_correction;
+    switch(x->pitch_mode){
+    case 0: // hz
+        for(int j = 0; j < count; j++){
+            float f = in[bs * j];
+            notes[j] = log2f((f < 0 ? f * -1 : f)/440) + 0.75;
         }
-        x->last_n = n;
+        break;
+    case 1: // midi
+        for(int j = 0; j < count; j++)
+            notes[j] = (in[bs * j] - 60) / 12;
+        break;
+    case 2: // cv
+        for(int j = 0; j < count; j++)
+            notes[j] = in[bs * j] * 5;
+        break;
+    default: // v/oct
+        for(int j = 0; j < count; j++)
+            notes[j] = in[bs * j];
     }
+    for(int j = 0; j < count; j++)
+        notes[j] = 60.f + (notes[j] + correction) * 12.f;
+}
+
+// Sets what's common to all voices, returns the message trigger
+static bool plts_begin_block(t_plts *x){
     x->patch.engine = x->model; // Model
-    int active_engine = x->voice.active_engine(); // Send current engine
+    int active_engine = x->x_voices[0].voice.active_engine(); // Send current engine
     if(x->last_engine_perform > 128 && x->last_engine != active_engine){
         x->last_engine = active_engine;
         x->last_engine_perform = 0;
@@ -219,39 +249,192 @@ t_int *plts_perform(t_int *w){
     x->patch.morph = x->morph;
     x->patch.lpg_colour = x->lpg_cutoff;
     x->patch.decay = x->decay;
-    x->modulations.trigger_patched = (x->trigger_mode || x->tr_conntected);
     x->patch.frequency_modulation_amount = x->mod_fm;
     x->patch.timbre_modulation_amount = x->mod_timbre;
     x->patch.morph_modulation_amount = x->mod_morph;
-    x->modulations.frequency_patched = x->frequency_active;
-    x->modulations.timbre_patched = x->timbre_active;
-    x->modulations.morph_patched = x->morph_active;
-    x->modulations.level_patched = x->level_active;
-    for(int j = 0; j < x->block_count; j++){ // Render frames
-        float pitch = plts_get_pitch(x, pitch_inlet[x->block_size * j]); // get pitch
-        pitch += x->pitch_correction;
-        x->patch.note = 60.f + pitch * 12.f;
-        x->modulations.level = level[x->block_size * j];
-        if(!x->tr_conntected){ // no signal connected
-            if(x->trigger){ // Message trigger (bang)
-                x->modulations.trigger = 1.0f;
-                x->trigger = false;
+    for(int v = 0; v < x->x_nvoices; v++){
+        plaits::Modulations *mod = &x->x_voices[v].modulations;
+        mod->trigger_patched = (x->trigger_mode || x->tr_conntected);
+        mod->frequency_patched = x->frequency_active;
+        mod->timbre_patched = x->timbre_active;
+        mod->morph_patched = x->morph_active;
+        mod->level_patched = x->level_active;
+    }
+    bool bang = x->trigger; // Message trigger, for all voices
+    x->trigger = false;
+    return(bang);
+}
+
+t_int *plts_perform(t_int *w){
+    t_plts *x = (t_plts *) (w[1]);
+    t_sample *pitch_inlet = (t_sample *) (w[2]);
+    t_sample *trig = (t_sample *) (w[3]);
+    t_sample *level = (t_sample *) (w[4]);
+    t_sample *out = (t_sample *) (w[5]);
+    t_sample *aux = (t_sample *) (w[6]);
+    int n = (int)(w[7]);
+    int bs = x->block_size;
+    bool bang = plts_begin_block(x);
+    if(x->x_ch[0] == 1) // same pitch for all voices
+        plts_get_notes(x, pitch_inlet, bs, x->block_count, x->x_notes);
+    for(int v = 0; v < x->x_nvoices; v++){
+        t_plts_voice *voice = &x->x_voices[v];
+        plaits::Modulations *mod = &voice->modulations;
+        if(x->x_ch[0] > 1)
+            plts_get_notes(x, pitch_inlet + v*n, bs, x->block_count, x->x_notes);
+        t_sample *tr = trig + (x->x_ch[1] > 1 ? v*n : 0);
+        t_sample *lvl = level + (x->x_ch[2] > 1 ? v*n : 0);
+        t_sample *o = out + v*n, *a = aux + v*n;
+        for(int j = 0; j < x->block_count; j++){ // Render frames
+            x->patch.note = x->x_notes[j];
+            mod->level = lvl[bs * j];
+            if(!x->tr_conntected) // no signal connected
+                mod->trigger = (j == 0 && bang) ? 1.0f : 0.0f;
+            else
+                mod->trigger = (tr[bs * j] != 0);
+            voice->voice.Render(x->patch, *mod, x->x_frames, bs);
+            for(int i = 0; i < bs; i++){
+                o[i + bs * j] = x->x_frames[i].out / 32768.0f;
+                a[i + bs * j] = x->x_frames[i].aux / 32768.0f;
+            }
+        }
+    }
+    return(w+8);
+}
+
+// Renders at 48kHz as far as this block needs and resamples. An output index
+// maps to the 48kHz sample heard there, minus the resampler's latency, so the
+// inputs are read where they'll be heard and a render call ends where the
+// trigger input changes.
+t_int *plts_perform_native(t_int *w){
+    t_plts *x = (t_plts *) (w[1]);
+    t_sample *pitch_inlet = (t_sample *) (w[2]);
+    t_sample *trig = (t_sample *) (w[3]);
+    t_sample *level = (t_sample *) (w[4]);
+    t_sample *out = (t_sample *) (w[5]);
+    t_sample *aux = (t_sample *) (w[6]);
+    int n = (int)(w[7]);
+    double step = x->x_rsstep;
+    bool bang = plts_begin_block(x);
+    for(int v = 0; v < x->x_nvoices; v++){
+        t_plts_voice *voice = &x->x_voices[v];
+        plaits::Modulations *mod = &voice->modulations;
+        t_sample *pitch = pitch_inlet + (x->x_ch[0] > 1 ? v*n : 0);
+        t_sample *tr = trig + (x->x_ch[1] > 1 ? v*n : 0);
+        t_sample *lvl = level + (x->x_ch[2] > 1 ? v*n : 0);
+        double pos = voice->rs_pos, origin = pos + RS_HALF - 1;
+        int fill = voice->rs_fill;
+        int need = (int)(pos + (n-1) * step) + RS_HALF + 1;
+        bool first = true;
+        while(fill < need){
+            int len = need - fill;
+            if(len > (int)plaits::kMaxBlockSize)
+                len = plaits::kMaxBlockSize;
+            int j = (int)((fill - origin) / step);
+            j = j < 0 ? 0 : j > n-1 ? n-1 : j;
+            if(x->tr_conntected){
+                bool t = (tr[j] != 0);
+                int jend = (int)((fill + len - 1 - origin) / step);
+                jend = jend > n-1 ? n-1 : jend;
+                for(int k = j + 1; k <= jend; k++){
+                    if((tr[k] != 0) != t){ // cut at the first sample heard at k
+                        int cut = (int)ceil(origin + k * step) - fill;
+                        if(cut > 0 && cut < len)
+                            len = cut;
+                        break;
+                    }
+                }
+                mod->trigger = t;
             }
             else
-                x->modulations.trigger = 0.0f;
+                mod->trigger = (first && bang) ? 1.0f : 0.0f;
+            plts_get_notes(x, pitch + j, 1, 1, &x->patch.note);
+            mod->level = lvl[j];
+            voice->voice.Render(x->patch, *mod, x->x_frames, len);
+            for(int i = 0; i < len; i++){
+                voice->rs_out[fill + i] = x->x_frames[i].out / 32768.0f;
+                voice->rs_aux[fill + i] = x->x_frames[i].aux / 32768.0f;
+            }
+            fill += len;
+            first = false;
+        }
+        t_sample *o = out + v*n, *a = aux + v*n;
+        for(int i = 0; i < n; i++){
+            double p = pos + i * step;
+            int base = (int)p;
+            double ph = (p - base) * RS_PHASES;
+            int row = (int)ph;
+            float frac = ph - row;
+            t_float *h0 = x->x_rstable + row * RS_TAPS, *h1 = h0 + RS_TAPS;
+            float *in1 = voice->rs_out + base - RS_HALF + 1;
+            float *in2 = voice->rs_aux + base - RS_HALF + 1;
+            float sum1 = 0, sum2 = 0;
+            for(int k = 0; k < RS_TAPS; k++){
+                float h = h0[k] + frac * (h1[k] - h0[k]);
+                sum1 += in1[k] * h;
+                sum2 += in2[k] * h;
+            }
+            o[i] = sum1;
+            a[i] = sum2;
         }
-        else
-            x->modulations.trigger = (trig[x->block_size * j] != 0);
-        plaits::Voice::Frame output[x->block_size];
-        x->voice.Render(x->patch, x->modulations, output, x->block_size);
-        for(int i = 0; i < x->block_size; i++){
-            out[i + (x->block_size * j)] = output[i].out / 32768.0f;
-            aux[i + (x->block_size * j)] = output[i].aux / 32768.0f;
+        pos += n * step;
+        int drop = (int)pos - RS_HALF + 1; // keep the next output's taps
+        if(drop > 0){
+            memmove(voice->rs_out, voice->rs_out + drop, (fill - drop) * sizeof(float));
+            memmove(voice->rs_aux, voice->rs_aux + drop, (fill - drop) * sizeof(float));
+            fill -= drop;
+            pos -= drop;
         }
+        voice->rs_fill = fill;
+        voice->rs_pos = pos;
     }
     return(w+8);
 }
 
+// Blackman windowed sinc, cut below the lower of both Nyquists
+static void plts_rs_table(t_plts *x, t_float sr){
+    if(!x->x_rstable)
+        x->x_rstable = (t_float *)getbytes((RS_PHASES + 1) * RS_TAPS * sizeof(t_float));
+    double cutoff = 0.9 * (sr < RS_SR ? sr / RS_SR : 1);
+    for(int p = 0; p <= RS_PHASES; p++){
+        t_float *h = x->x_rstable + p * RS_TAPS;
+        double sum = 0;
+        for(int k = 0; k < RS_TAPS; k++){
+            double d = k - RS_HALF + 1 - (double)p / RS_PHASES; // distance in samples
+            double s = d == 0 ? 1 : sin(M_PI * cutoff * d) / (M_PI * cutoff * d);
+            double wpos = (d + RS_HALF) / RS_TAPS; // 0 to 1 over the taps
+            double win = wpos <= 0 || wpos >= 1 ? 0 :
+                0.42 - 0.5 * cos(2 * M_PI * wpos) + 0.08 * cos(4 * M_PI * wpos);
+            h[k] = s * win;
+            sum += h[k];
+        }
+        for(int k = 0; k < RS_TAPS; k++) // unity gain at DC for every phase
+            h[k] /= sum;
+    }
+    x->x_rssr = sr;
+}
+
+static void plts_rs_init(t_plts *x, int n, t_float sr){
+    if(sr != x->x_rssr)
+        plts_rs_table(x, sr);
+    x->x_rsstep = RS_SR / sr;
+    int size = RS_TAPS + 2 + (int)ceil(n * x->x_rsstep);
+    for(int v = 0; v < x->x_nvoices; v++){
+        t_plts_voice *voice = &x->x_voices[v];
+        if(size != x->x_rssize){
+            voice->rs_out = (float *)resizebytes(voice->rs_out,
+                x->x_rssize * sizeof(float), size * sizeof(float));
+            voice->rs_aux = (float *)resizebytes(voice->rs_aux,
+                x->x_rssize * sizeof(float), size * sizeof(float));
+        }
+        memset(voice->rs_out, 0, size * sizeof(float));
+        memset(voice->rs_aux, 0, size * sizeof(float));
+        voice->rs_fill = RS_HALF; // silent history
+        voice->rs_pos = RS_HALF - 1;
+    }
+    x->x_rssize = size;
+}
+
 int connected_inlet(t_object *x, t_glist *glist, int inno, t_symbol *outsym){
     t_linetraverser t;
     linetraverser_start(&t, glist);
@@ -263,15 +446,64 @@ int connected_inlet(t_object *x, t_glist *glist, int inno, t_symbol *outsym){
 }
 
 void plts_dsp(t_plts *x, t_signal **sp){
-    x->pitch_correction = log2f(48000.f / sys_getsr());
+    int n = sp[0]->s_n, nv = x->x_nvoices;
+    bool native = x->x_native && sp[0]->s_sr != RS_SR;
+    if(native)
+        plts_rs_init(x, n, sp[0]->s_sr);
+    else
+        x->x_rsstep = 0;
+    x->pitch_correction = native ? 0 : log2f(48000.f / sys_getsr());
     x->tr_conntected = connected_inlet((t_object *)x, x->x_glist, 1, &s_signal);
     x->level_active = connected_inlet((t_object *)x, x->x_glist, 2, &s_signal);
-    dsp_add(plts_perform, 7, x, sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec,
-        sp[3]->s_vec, sp[4]->s_vec, sp[0]->s_n);
+    if(n > 24){ // Plaits uses a block size of 24 max
+        int block_size = 24;
+        while(n % block_size > 0)
+            block_size--;
+        x->block_size = block_size;
+        x->block_count = n / block_size;
+    }
+    else{
+        x->block_size = n;
+        x->block_count = 1;
+    }
+    if(x->block_count > x->x_nnotes){
+        x->x_notes = (t_float *)resizebytes(x->x_notes,
+            x->x_nnotes * sizeof(t_float), x->block_count * sizeof(t_float));
+        x->x_nnotes = x->block_count;
+    }
+    signal_setmultiout(&sp[3], nv);
+    signal_setmultiout(&sp[4], nv);
+    int mismatch = 0;
+    for(int i = 0; i < 3; i++){
+        int chs = sp[i]->s_nchans;
+        x->x_ch[i] = chs;
+        if(chs > 1 && chs != nv)
+            mismatch = 1;
+    }
+    if(mismatch){
+        dsp_add_zero(sp[3]->s_vec, nv*n);
+        dsp_add_zero(sp[4]->s_vec, nv*n);
+        pd_error(x, "[plaits~]: channel sizes mismatch");
+    }
+    else
+        dsp_add(native ? plts_perform_native : plts_perform, 7, x, sp[0]->s_vec,
+            sp[1]->s_vec, sp[2]->s_vec, sp[3]->s_vec, sp[4]->s_vec, n);
 }
 
 void plts_free(t_plts *x){
-    x->voice.FreeEngines();
+    for(int v = 0; v < x->x_nvoices; v++){
+        t_plts_voice *voice = &x->x_voices[v];
+        voice->voice.FreeEngines();
+        if(voice->rs_out){
+            freebytes(voice->rs_out, x->x_rssize * sizeof(float));
+            freebytes(voice->rs_aux, x->x_rssize * sizeof(float));
+        }
+    }
+    if(x->x_rstable)
+        freebytes(x->x_rstable, (RS_PHASES + 1) * RS_TAPS * sizeof(t_float));
+    freebytes(x->x_voices, x->x_nvoices * sizeof(t_plts_voice));
+    if(x->x_notes)
+        freebytes(x->x_notes, x->x_nnotes * sizeof(t_float));
     inlet_free(x->x_trig_in);
     inlet_free(x->x_level_in);
     outlet_free(x->x_out1);
@@ -282,8 +514,7 @@ void plts_free(t_plts *x){
 void *plts_new(t_symbol *s, int ac, t_atom *av){
     s = NULL;
     t_plts *x = (t_plts *)pd_new(plts_class);
-    stmlib::BufferAllocator allocator(x->shared_buffer, sizeof(x->shared_buffer));
-    x->voice.Init(&allocator);
+    x->x_nvoices = 1;
     x->x_glist = (t_glist *)canvas_getcurrent();
     int floatarg = 0;
     x->patch.engine = 0;
@@ -331,6 +562,17 @@ void *plts_new(t_symbol *s, int ac, t_atom *av){
             }
             else if(sym == gensym("-trigger"))
                 x->trigger_mode = 1;
+            else if(sym == gensym("-native"))
+                x->x_native = 1;
+            else if(sym == gensym("-voices")){
+                if(ac && (av)->a_type == A_FLOAT){
+                    int v = (int)atom_getfloat(av);
+                    x->x_nvoices = v < 1 ? 1 : v > MAXVOICES ? MAXVOICES : v;
+                    ac--, av++;
+                }
+                else
+                    goto errstate;
+            }
             else
                 goto errstate;
         }
@@ -360,6 +602,13 @@ void *plts_new(t_symbol *s, int ac, t_atom *av){
             }
         }
     }
+    // Voices share plaits' tables, each has its own engines and buffer
+    x->x_voices = (t_plts_voice *)getbytes(x->x_nvoices * sizeof(t_plts_voice));
+    for(int v = 0; v < x->x_nvoices; v++){
+        t_plts_voice *voice = &x->x_voices[v];
+        stmlib::BufferAllocator allocator(voice->shared_buffer, sizeof(voice->shared_buffer));
+        voice->voice.Init(&allocator);
+    }
     x->x_trig_in = inlet_new(&x->x_obj, &x->x_obj.ob_pd, gensym("signal"), gensym ("signal"));
     x->x_level_in = inlet_new(&x->x_obj, &x->x_obj.ob_pd, gensym("signal"), gensym ("signal"));
     x->x_out1 = outlet_new(&x->x_obj, &s_signal);
@@ -373,7 +622,7 @@ errstate:
 
 void plaits_tilde_setup(void){
     plts_class = class_new(gensym("plaits~"), (t_newmethod)plts_new,
-        (t_method)plts_free, sizeof(t_plts), 0, A_GIMME, 0);
+        (t_method)plts_free, sizeof(t_plts), CLASS_MULTICHANNEL, A_GIMME, 0);
     class_addmethod(plts_class, (t_method)plts_dsp, gensym("dsp"), A_NULL);
     CLASS_MAINSIGNALIN(plts_class, t_plts, pitch_in);
     class_addbang(plts_class, plts_bang);
@@ -382,6 +631,7 @@ void plaits_tilde_setup(void){
     class_addmethod(plts_class, (t_method)plts_timbre, gensym("timbre"), A_DEFFLOAT, A_NULL);
     class_addmethod(plts_class, (t_method)plts_morph, gensym("morph"), A_DEFFLOAT, A_NULL);
     class_addmethod(plts_class, (t_method)plts_trigger_mode, gensym("trigger"), A_DEFFLOAT, A_NULL);
+    class_addmethod(plts_class, (t_method)plts_native, gensym("native"), A_DEFFLOAT, A_NULL);
     class_addmethod(plts_class, (t_method)plts_lpg_cutoff, gensym("cutoff"), A_DEFFLOAT, A_NULL);
     class_addmethod(plts_class, (t_method)plts_decay, gensym("decay"), A_DEFFLOAT, A_NULL);
     class_addmethod(plts_class, (t_method)plts_cv, gensym("cv"), A_NULL);
@@ -34,6 +34,7 @@ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 #endif
 
 #define MAXSYSEXSIZE 1024 // Size of sysex data list (excluding the F0 [240] and F7 [247] bytes)
+#define MAXGROUPS    128  // fluidsynth's limit for audio groups
 
 static t_class *sfont_class;
  
@@ -62,6 +63,9 @@ typedef struct _sfont{
     int                 x_id;
     int                 x_bank;
     int                 x_pgm;
+    int                 x_mc;
+    int                 x_groups;   // stereo outputs in -mc mode, one per MIDI channel
+    float             **x_out;      // left/right pointers for each group
     t_atom              x_at[MAXSYSEXSIZE];
     unsigned char       x_type;
     unsigned char       x_data;
@@ -78,6 +82,30 @@ static void sfont_verbose(t_sfont *x, t_floatarg f){
     x->x_verbosity = f != 0;
 }
 
+static void sfont_polyphony(t_sfont *x, t_floatarg f){
+    int n = f < 1 ? 1 : f > 65535 ? 65535 : (int)f;
+    if(fluid_synth_set_polyphony(x->x_synth, n) == FLUID_FAILED)
+        pd_error(x, "[sfont~]: couldn't set polyphony to %d", n);
+}
+
+static void sfont_interp(t_sfont *x, t_floatarg f){
+    int m = (int)f; // 0 (none), 1 (linear), 4 (4th order, default) or 7 (7th order)
+    if(m != FLUID_INTERP_NONE && m != FLUID_INTERP_LINEAR && m != FLUID_INTERP_4THORDER
+    && m != FLUID_INTERP_7THORDER){
+        pd_error(x, "[sfont~]: interpolation should be 0, 1, 4 or 7");
+        return;
+    }
+    fluid_synth_set_interp_method(x->x_synth, -1, m);
+}
+
+static void sfont_reverb(t_sfont *x, t_floatarg f){
+    fluid_synth_reverb_on(x->x_synth, -1, f != 0);
+}
+
+static void sfont_chorus(t_sfont *x, t_floatarg f){
+    fluid_synth_chorus_on(x->x_synth, -1, f != 0);
+}
+
 static void sfont_panic(t_sfont *x){
     if(x->x_synth)
         fluid_synth_system_reset(x->x_synth);
@@ -548,8 +576,36 @@ t_int *sfont_perform(t_int *w){
     return(w+5);
 }
 
+// fluidsynth routes MIDI channel 'ch' to audio group 'ch % groups', and mixes
+// all effects into the first buffer pair it's given
+t_int *sfont_perform_mc(t_int *w){
+    t_sfont *x = (t_sfont *)(w[1]);
+    t_sample *left = (t_sample *)(w[2]);
+    t_sample *right = (t_sample *)(w[3]);
+    int n = (int)(w[4]);
+    int groups = x->x_groups;
+    memset(left, 0, groups * n * sizeof(t_sample)); // fluidsynth adds to the buffers
+    memset(right, 0, groups * n * sizeof(t_sample));
+    fluid_synth_process(x->x_synth, n, 2, x->x_out, 2*groups, x->x_out);
+    return(w+5);
+}
+
 static void sfont_dsp(t_sfont *x, t_signal **sp){
-    dsp_add(sfont_perform, 4, x, sp[0]->s_vec, sp[1]->s_vec, (t_int)sp[0]->s_n);
+    int n = sp[0]->s_n;
+    if(x->x_mc){
+        signal_setmultiout(&sp[0], x->x_groups);
+        signal_setmultiout(&sp[1], x->x_groups);
+        for(int i = 0; i < x->x_groups; i++){
+            x->x_out[2*i] = sp[0]->s_vec + i*n;
+            x->x_out[2*i+1] = sp[1]->s_vec + i*n;
+        }
+        dsp_add(sfont_perform_mc, 4, x, sp[0]->s_vec, sp[1]->s_vec, (t_int)n);
+    }
+    else{
+        signal_setmultiout(&sp[0], 1);
+        signal_setmultiout(&sp[1], 1);
+        dsp_add(sfont_perform, 4, x, sp[0]->s_vec, sp[1]->s_vec, (t_int)n);
+    }
 }
 
 static void sfont_free(t_sfont *x){
@@ -559,6 +615,8 @@ static void sfont_free(t_sfont *x){
         delete_fluid_settings(x->x_settings);
     if(x->x_elsefilehandle)
         elsefile_free(x->x_elsefilehandle);
+    if(x->x_out)
+        freebytes(x->x_out, 2 * x->x_groups * sizeof(*x->x_out));
 }
 
 static void *sfont_new(t_symbol *s, int ac, t_atom *av){
@@ -584,7 +642,10 @@ static void *sfont_new(t_symbol *s, int ac, t_atom *av){
         return(NULL);
     }
     x->x_ch = 16;
-    int arg = 0;
+    x->x_mc = 0;
+    x->x_out = NULL;
+    int arg = 0, polyphony = 256, cores = 1, interp = FLUID_INTERP_DEFAULT;
+    int reverb = 1, chorus = 1;
     double g = 0.4;
     t_symbol *filename = NULL;
     while(ac){
@@ -621,6 +682,41 @@ static void *sfont_new(t_symbol *s, int ac, t_atom *av){
                 else
                     goto errstate;
             }
+            else if(sym == gensym("-polyphony") && !arg){
+                ac--, av++;
+                if(ac && av->a_type == A_FLOAT){
+                    polyphony = atom_getintarg(0, ac, av);
+                    polyphony = polyphony < 1 ? 1 : polyphony > 65535 ? 65535 : polyphony;
+                    ac--, av++;
+                }
+                else
+                    goto errstate;
+            }
+            else if(sym == gensym("-cores") && !arg){
+                ac--, av++;
+                if(ac && av->a_type == A_FLOAT){
+                    cores = atom_getintarg(0, ac, av);
+                    cores = cores < 1 ? 1 : cores > 256 ? 256 : cores;
+                    ac--, av++;
+                }
+                else
+                    goto errstate;
+            }
+            else if(sym == gensym("-interp") && !arg){
+                ac--, av++;
+                if(ac && av->a_type == A_FLOAT){
+                    interp = atom_getintarg(0, ac, av);
+                    ac--, av++;
+                }
+                else
+                    goto errstate;
+            }
+            else if(sym == gensym("-noreverb") && !arg)
+                reverb = 0, ac--, av++;
+            else if(sym == gensym("-nochorus") && !arg)
+                chorus = 0, ac--, av++;
+            else if(sym == gensym("-mc") && !arg)
+                x->x_mc = 1, ac--, av++;
             else if(!arg){
                 arg = 1;
                 filename = sym;
@@ -636,14 +732,24 @@ static void *sfont_new(t_symbol *s, int ac, t_atom *av){
     fluid_settings_setint(x->x_settings, "synth.midi-channels", x->x_ch);
     fluid_settings_setnum(x->x_settings, "synth.gain", g);
     fluid_settings_setnum(x->x_settings, "synth.sample-rate", sys_getsr());
-    fluid_settings_setnum(x->x_settings, "synth.sample-rate", sys_getsr());
-//  fluid_settings_setint(x->x_settings, "synth.polyphony", 256);
+    fluid_settings_setint(x->x_settings, "synth.polyphony", polyphony);
+    fluid_settings_setint(x->x_settings, "synth.cpu-cores", cores);
+    fluid_settings_setint(x->x_settings, "synth.reverb.active", reverb);
+    fluid_settings_setint(x->x_settings, "synth.chorus.active", chorus);
+    if(x->x_mc){
+        x->x_groups = x->x_ch > MAXGROUPS ? MAXGROUPS : x->x_ch;
+        fluid_settings_setint(x->x_settings, "synth.audio-groups", x->x_groups);
+        fluid_settings_setint(x->x_settings, "synth.audio-channels", x->x_groups);
+        x->x_out = (float **)getbytes(2 * x->x_groups * sizeof(*x->x_out));
+    }
 //    fluid_settings_setstr(x->x_settings, "synth.midi-bank-select", "gs");
     x->x_synth = new_fluid_synth(x->x_settings); // Create fluidsynth instance:
     if(x->x_synth == NULL){
         pd_error(x, "[sfont~]: bug couldn't create fluidsynth instance");
         return(NULL);
     }
+    if(interp != FLUID_INTERP_DEFAULT)
+        sfont_interp(x, interp);
     if(filename)
         fluid_do_load(x, filename);
     return(x);
@@ -654,7 +760,7 @@ errstate:
  
 void sfont_tilde_setup(void){
     sfont_class = class_new(gensym("sfont~"), (t_newmethod)sfont_new,
-        (t_method)sfont_free, sizeof(t_sfont), CLASS_DEFAULT, A_GIMME, 0);
+        (t_method)sfont_free, sizeof(t_sfont), CLASS_MULTICHANNEL, A_GIMME, 0);
     class_addmethod(sfont_class, (t_method)sfont_dsp, gensym("dsp"), A_CANT, 0);
     //    class_addmethod(sfont_class, (t_method)fluid_gen, gensym("gen"), A_GIMME, 0);
     class_addfloat(sfont_class, (t_method)sfont_float); // raw midi input
@@ -669,6 +775,10 @@ void sfont_tilde_setup(void){
     class_addmethod(sfont_class, (t_method)sfont_pitch_bend, gensym("bend"), A_GIMME, 0);
     class_addmethod(sfont_class, (t_method)sfont_sysex, gensym("sysex"), A_GIMME, 0);
     class_addmethod(sfont_class, (t_method)sfont_panic, gensym("panic"), 0);
+    class_addmethod(sfont_class, (t_method)sfont_polyphony, gensym("polyphony"), A_FLOAT, 0);
+    class_addmethod(sfont_class, (t_method)sfont_interp, gensym("interp"), A_FLOAT, 0);
+    class_addmethod(sfont_class, (t_method)sfont_reverb, gensym("reverb"), A_FLOAT, 0);
+    class_addmethod(sfont_class, (t_method)sfont_chorus, gensym("chorus"), A_FLOAT, 0);
     class_addmethod(sfont_class, (t_method)sfont_transp, gensym("transp"), A_GIMME, 0);
     class_addmethod(sfont_class, (t_method)sfont_pan, gensym("pan"), A_GIMME, 0);
     class_addmethod(sfont_class, (t_method)sfont_scale, gensym("scale"), A_GIMME, 0);
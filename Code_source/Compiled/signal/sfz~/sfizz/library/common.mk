@@ -123,6 +123,7 @@ SFIZZ_SOURCES = \
 	src/sfizz/utility/spin_mutex/SpinMutex.cpp \
 	src/sfizz/Voice.cpp \
 	src/sfizz/VoiceManager.cpp \
+	src/sfizz/VoiceRenderPool.cpp \
 	src/sfizz/VoiceStealing.cpp \
 	src/sfizz/Wavetables.cpp \
 	src/sfizz/WindowedSinc.cpp
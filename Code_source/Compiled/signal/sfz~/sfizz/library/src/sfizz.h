@@ -32,6 +32,7 @@
 #include "sfizz_message.h"
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #if defined SFIZZ_EXPORT_SYMBOLS
   #if defined _WIN32
@@ -288,6 +289,17 @@ SFIZZ_EXPORTED_API char* sfizz_export_midnam(sfizz_synth_t* synth, const char* m
  */
 SFIZZ_EXPORTED_API size_t sfizz_get_num_preloaded_samples(sfizz_synth_t* synth);
 
+/**
+ * @brief Return the number of stereo outputs used by the regions of the
+ * current SFZ file, set with the `output` opcode.
+ *
+ * Render with twice as many channels in sfizz_render_block() to get each
+ * output separately.
+ *
+ * @param synth  The synth.
+ */
+SFIZZ_EXPORTED_API int sfizz_get_num_outputs(sfizz_synth_t* synth);
+
 /**
  * @brief Return the number of active voices.
  *
@@ -754,6 +766,74 @@ SFIZZ_EXPORTED_API unsigned int sfizz_get_preload_size(sfizz_synth_t* synth);
  */
 SFIZZ_EXPORTED_API void sfizz_set_preload_size(sfizz_synth_t* synth, unsigned int preload_size);
 
+/**
+ * @brief Check whether samples are loaded entirely in memory.
+ *
+ * @param synth  The synth.
+ */
+SFIZZ_EXPORTED_API bool sfizz_get_ram_loading(sfizz_synth_t* synth);
+
+/**
+ * @brief Load samples entirely in memory instead of streaming them from disk.
+ *
+ * This applies to the files loaded next, unless they use the hint_ram_based
+ * opcode, and reloads the samples of the current one so it can take a long
+ * time to return.
+ *
+ * @param      synth         The synth.
+ * @param[in]  load_in_ram   Whether to load the samples in memory.
+ *
+ * @par Thread-safety constraints
+ * - @b CT: the function must be invoked from the Control thread
+ * - @b OFF: the function cannot be invoked while a thread is calling @b RT functions
+ */
+SFIZZ_EXPORTED_API void sfizz_set_ram_loading(sfizz_synth_t* synth, bool load_in_ram);
+
+/**
+ * @brief Get the number of threads streaming files for the synth.
+ *
+ * @param synth  The synth.
+ */
+SFIZZ_EXPORTED_API unsigned int sfizz_get_num_background_threads(sfizz_synth_t* synth);
+
+/**
+ * @brief Set the number of threads streaming files for the synth.
+ *
+ * 0, the default, uses a pool shared by all the synths in the process and
+ * sized after the number of cores. Other values give the synth its own
+ * threads. This waits for the files being loaded.
+ *
+ * @param      synth         The synth.
+ * @param[in]  num_threads   The number of threads, or 0 for the shared pool.
+ *
+ * @par Thread-safety constraints
+ * - @b CT: the function must be invoked from the Control thread
+ */
+SFIZZ_EXPORTED_API void sfizz_set_num_background_threads(sfizz_synth_t* synth, unsigned int num_threads);
+
+/**
+ * @brief Get the number of threads rendering the voices.
+ *
+ * @param synth  The synth.
+ */
+SFIZZ_EXPORTED_API unsigned int sfizz_get_num_render_threads(sfizz_synth_t* synth);
+
+/**
+ * @brief Set the number of threads rendering the voices.
+ *
+ * This counts the thread calling the render functions, so 1, the default,
+ * renders everything there. With more, the voices of different regions render
+ * in parallel and are mixed in the same order as with a single thread.
+ *
+ * @param      synth         The synth.
+ * @param[in]  num_threads   The number of threads.
+ *
+ * @par Thread-safety constraints
+ * - @b CT: the function must be invoked from the Control thread
+ * - @b OFF: the function cannot be invoked while a thread is calling @b RT functions
+ */
+SFIZZ_EXPORTED_API void sfizz_set_num_render_threads(sfizz_synth_t* synth, unsigned int num_threads);
+
 /**
  * @brief Get the internal oversampling rate.
  *
@@ -1056,6 +1136,30 @@ typedef struct
  */
 SFIZZ_EXPORTED_API void sfizz_get_callback_breakdown(sfizz_synth_t* synth, sfizz_callback_breakdown_t* breakdown);
 
+/**
+ * @brief The disk streaming statistics structure.
+ * @note Counts other than num_streaming_files are totals since the synth was created.
+ */
+typedef struct
+{
+    size_t num_streaming_files;
+    uint64_t num_streamed_files;
+    uint64_t num_streamed_frames;
+    uint64_t num_underruns;
+} sfizz_streaming_stats_t;
+
+/**
+ * @brief Get the disk streaming statistics.
+ *
+ * These are the files being streamed right now, then the files and frames
+ * streamed and the voices which ran out of data while their file was still
+ * streaming.
+ *
+ * @param synth
+ * @param stats
+ */
+SFIZZ_EXPORTED_API void sfizz_get_streaming_stats(sfizz_synth_t* synth, sfizz_streaming_stats_t* stats);
+
 /**
  * @brief Shuts down the current processing, clear buffers and reset the voices.
  * @since 0.3.2
@@ -12,6 +12,7 @@
 #pragma once
 #include "sfizz_message.h"
 #include <string>
+#include <cstdint>
 #include <utility>
 #include <vector>
 #include <memory>
@@ -263,6 +264,12 @@ public:
      */
     size_t getNumPreloadedSamples() const noexcept;
 
+    /**
+     * @brief Return the number of stereo outputs used by the regions of the
+     * current file, set with the `output` opcode.
+     */
+    int getNumOutputs() const noexcept;
+
     /**
      * @brief Set the maximum size of the blocks for the callback.
      *
@@ -843,6 +850,63 @@ public:
      */
     uint32_t getPreloadSize() const noexcept;
 
+    /**
+     * @brief Load samples entirely in memory instead of streaming them from disk.
+     *
+     * This applies to the files loaded next, unless they use the hint_ram_based
+     * opcode, and reloads the samples of the current one.
+     *
+     * @param loadInRam  Whether to load the samples in memory.
+     *
+     * @par Thread-safety constraints
+     * - @b CT: the function must be invoked from the Control thread
+     * - @b OFF: the function cannot be invoked while a thread is calling @b RT functions
+     */
+    void setRamLoading(bool loadInRam) noexcept;
+
+    /**
+     * @brief Return whether samples are loaded entirely in memory.
+     */
+    bool getRamLoading() const noexcept;
+
+    /**
+     * @brief Set the number of threads streaming files for this synth.
+     *
+     * 0 uses a pool shared by all the synths in the process, sized after the
+     * number of cores. This waits for the files being loaded.
+     *
+     * @param numThreads  The number of threads, or 0 for the shared pool.
+     *
+     * @par Thread-safety constraints
+     * - @b CT: the function must be invoked from the Control thread
+     */
+    void setNumBackgroundThreads(unsigned numThreads) noexcept;
+
+    /**
+     * @brief Return the number of background loading threads, 0 being the shared pool.
+     */
+    unsigned getNumBackgroundThreads() const noexcept;
+
+    /**
+     * @brief Set the number of threads rendering the voices.
+     *
+     * This counts the thread calling renderBlock(), so 1, the default, renders
+     * everything there. With more, the voices of different regions render in
+     * parallel and are mixed in the same order as with a single thread.
+     *
+     * @param numThreads  The number of threads.
+     *
+     * @par Thread-safety constraints
+     * - @b CT: the function must be invoked from the Control thread
+     * - @b OFF: the function cannot be invoked while a thread is calling @b RT functions
+     */
+    void setNumRenderThreads(unsigned numThreads) noexcept;
+
+    /**
+     * @brief Return the number of threads rendering the voices.
+     */
+    unsigned getNumRenderThreads() const noexcept;
+
     /**
      * @brief Return the number of allocated buffers.
      * @since 0.2.0
@@ -986,6 +1050,25 @@ public:
      */
     CallbackBreakdown getCallbackBreakdown() noexcept;
 
+    struct StreamingStats
+    {
+        size_t numStreamingFiles;
+        uint64_t numStreamedFiles;
+        uint64_t numStreamedFrames;
+        uint64_t numUnderruns;
+    };
+
+    /**
+     * @brief Get the disk streaming statistics.
+     *
+     * The number of files being streamed right now, then the number of files
+     * and frames streamed and of voices which ran out of data while their
+     * file was streaming, since the synth was created.
+     *
+     * @return StreamingStats
+     */
+    StreamingStats getStreamingStats() const noexcept;
+
     /**
      * @brief Shuts down the current processing, clear buffers and reset the voices.
      *
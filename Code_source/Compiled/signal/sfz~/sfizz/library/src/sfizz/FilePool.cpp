@@ -504,7 +504,11 @@ void sfz::FilePool::loadingJob(const QueuedFileData& data) noexcept
     if (!data.data->status.compare_exchange_strong(currentStatus, FileData::Status::Streaming))
         return;
 
+    numStreamingFiles++;
     streamFromFile(*reader, data.data->fileData, &data.data->availableFrames);
+    numStreamedFrames += static_cast<uint64_t>(reader->frames());
+    numStreamedFiles++;
+    numStreamingFiles--;
 
     data.data->status = FileData::Status::Done;
 
@@ -626,6 +630,24 @@ void sfz::FilePool::setRamLoading(bool loadInRam) noexcept
     }
 }
 
+void sfz::FilePool::setNumBackgroundThreads(unsigned numThreads) noexcept
+{
+    if (numThreads == numBackgroundThreads)
+        return;
+
+    std::lock_guard<std::mutex> guard { loadingJobsMutex };
+
+    for (auto& job : loadingJobs)
+        job.wait();
+
+    loadingJobs.clear();
+    numBackgroundThreads = numThreads;
+    if (numThreads > 0)
+        threadPool.reset(new ThreadPool(numThreads));
+    else
+        threadPool = globalThreadPool();
+}
+
 void sfz::FilePool::triggerGarbageCollection() noexcept
 {
     const std::unique_lock<SpinMutex> guard { garbageAndLastUsedMutex, std::try_to_lock };
@@ -191,8 +191,8 @@ public:
     /**
      * @brief Construct a new File Pool object.
      *
-     * This creates the background threads based on config::numBackgroundThreads
-     * as well as the garbage collection thread.
+     * This attaches to the shared background loading threads and creates
+     * the garbage collection thread.
      */
     FilePool();
 
@@ -209,6 +209,28 @@ public:
      * @return size_t
      */
     size_t getNumPreloadedSamples() const noexcept { return preloadedFiles.size() + loadedFiles.size(); }
+    /**
+     * @brief Get the number of files being streamed from disk right now
+     */
+    size_t getNumStreamingFiles() const noexcept { return numStreamingFiles; }
+    /**
+     * @brief Get the number of files streamed entirely since the pool was created
+     */
+    uint64_t getNumStreamedFiles() const noexcept { return numStreamedFiles; }
+    /**
+     * @brief Get the number of frames streamed since the pool was created
+     */
+    uint64_t getNumStreamedFrames() const noexcept { return numStreamedFrames; }
+    /**
+     * @brief Get the number of voices which ran out of data while their file
+     * was still streaming, since the pool was created
+     */
+    uint64_t getNumUnderruns() const noexcept { return numUnderruns; }
+    /**
+     * @brief Count a voice running out of data while its file is streaming.
+     * This can be called from any rendering thread.
+     */
+    void countUnderrun() noexcept { numUnderruns.fetch_add(1, std::memory_order_relaxed); }
 
     /**
      * @brief Get metadata information about a file.
@@ -330,6 +352,22 @@ public:
      * @param loadInRam
      */
     void setRamLoading(bool loadInRam) noexcept;
+    /**
+     * @brief Whether all samples are loaded in ram.
+     */
+    bool getRamLoading() const noexcept { return loadInRam; }
+    /**
+     * @brief Set the number of threads loading files in the background.
+     * 0 shares a process-wide pool sized after the machine, any other value
+     * gives this file pool its own threads. Waits for pending loads.
+     *
+     * @param numThreads
+     */
+    void setNumBackgroundThreads(unsigned numThreads) noexcept;
+    /**
+     * @brief Get the number of background loading threads, 0 being the shared pool.
+     */
+    unsigned getNumBackgroundThreads() const noexcept { return numBackgroundThreads; }
     /**
      * @brief Prepares unused data to be freed on a background thread.
      * This should be called regularly by the Synth, otherwise memory
@@ -376,6 +414,13 @@ private:
     std::vector<FileAudioBuffer> garbageToCollect;
 
     std::shared_ptr<ThreadPool> threadPool;
+    unsigned numBackgroundThreads { 0 };
+
+    // Streaming statistics
+    std::atomic<size_t> numStreamingFiles { 0 };
+    std::atomic<uint64_t> numStreamedFiles { 0 };
+    std::atomic<uint64_t> numStreamedFrames { 0 };
+    std::atomic<uint64_t> numUnderruns { 0 };
 
     // Preloaded data
     absl::flat_hash_map<FileId, FileData> preloadedFiles;
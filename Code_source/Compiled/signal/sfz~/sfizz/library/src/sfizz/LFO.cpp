@@ -46,6 +46,7 @@ struct LFO::Impl {
     std::array<float, config::maxLFOSubs> subPhases_ {{}};
     std::array<float, config::maxLFOSubs> sampleHoldMem_ {{}};
     std::array<int, config::maxLFOSubs> sampleHoldState_ {{}};
+    fast_rand sampleHoldGenerator_;
 };
 
 LFO::LFO(Resources& resources)
@@ -82,6 +83,8 @@ void LFO::start(unsigned triggerDelay)
     impl.subPhases_.fill(0.0f);
     impl.sampleHoldMem_.fill(0.0f);
     impl.sampleHoldState_.fill(0);
+    // the voice may render on a helper thread, so seed our own generator here
+    impl.sampleHoldGenerator_.seed(Random::randomGenerator());
 
     float delay = desc.delay;
     for (const auto& mod: desc.delayCC)
@@ -197,7 +200,7 @@ void LFO::processSH(unsigned nth, absl::Span<float> out, const float* phaseIn)
         // value updates twice every period
         if (sampleHoldState != oldState) {
             std::uniform_real_distribution<float> dist(-1.0f, +1.0f);
-            sampleHoldValue = dist(Random::randomGenerator);
+            sampleHoldValue = dist(impl.sampleHoldGenerator_);
         }
     }
 
@@ -716,9 +716,11 @@ private:
  *
  * TODO: could be moved into a singleton class holder
  *
+ * Voices render with generators of their own, seeded from this one when they
+ * start, so the render threads never move its sequence.
  */
 namespace Random {
-static fast_rand randomGenerator;
+static thread_local fast_rand randomGenerator;
 } // namespace Random
 
 /**
@@ -32,6 +32,8 @@ struct Resources::Impl {
     Metronome metronome;
 };
 
+static thread_local BufferPool* threadBufferPool { nullptr };
+
 Resources::Resources()
     : impl_(new Impl)
 {
@@ -84,7 +86,12 @@ const SynthConfig& Resources::getSynthConfig() const noexcept
 
 const BufferPool& Resources::getBufferPool() const noexcept
 {
-    return impl_->bufferPool;
+    return threadBufferPool ? *threadBufferPool : impl_->bufferPool;
+}
+
+void Resources::setThreadBufferPool(BufferPool* pool) noexcept
+{
+    threadBufferPool = pool;
 }
 
 const MidiState& Resources::getMidiState() const noexcept
@@ -60,6 +60,13 @@ public:
 
     #undef ACCESSOR_RW
 
+    /**
+     * @brief Make getBufferPool() return another pool on the calling thread,
+     * or the pool of the resources again if null. Threads rendering voices
+     * in parallel use this to get scratch buffers of their own.
+     */
+    static void setThreadBufferPool(BufferPool* pool) noexcept;
+
 private:
     struct Impl;
     std::unique_ptr<Impl> impl_;
@@ -293,7 +293,7 @@ void Synth::Impl::clear()
     image_ = "";
     midiState.resetNoteStates();
     midiState.flushEvents();
-    filePool.setRamLoading(config::loadInRam);
+    filePool.setRamLoading(loadInRam_);
     clearCCLabels();
     currentUsedCCs_.clear();
     sustainOrSostenuto_.clear();
@@ -1062,6 +1062,11 @@ void Synth::setSamplesPerBlock(int samplesPerBlock) noexcept
 
     impl.resources_.setSamplesPerBlock(samplesPerBlock);
 
+    if (impl.renderPool_) {
+        impl.renderPool_->setSamplesPerBlock(samplesPerBlock);
+        impl.resizeVoiceOutputs();
+    }
+
     for (int i = 0; i < impl.numOutputs_; ++i) {
         for (auto& bus : impl.getEffectBusesForOutput(i)) {
             if (bus)
@@ -1166,21 +1171,33 @@ void Synth::renderBlock(AudioSpan<float> buffer) noexcept
         ScopedTiming logger { callbackBreakdown.renderMethod, ScopedTiming::Operation::addToDuration };
         tempMixSpan->fill(0.0f);
 
+        // with a render pool the voices are rendered first, then mixed
+        // here in the same order as a serial render for identical results
+        const bool parallel = impl.renderPool_ && impl.renderVoicesInParallel(numFrames);
+
+        size_t voiceIndex = 0;
         for (auto& voice : impl.voiceManager_) {
+            const size_t index = voiceIndex++;
             if (voice.isFree())
                 continue;
 
-            mm.beginVoice(voice.getId(), voice.getRegion()->getId(), voice.getTriggerEvent().value);
-
             const Region* region = voice.getRegion();
             ASSERT(region != nullptr);
             const auto& effectBuses = impl.getEffectBusesForOutput(region->output);
 
-            voice.renderBlock(*tempSpan);
+            AudioSpan<float> voiceSpan = *tempSpan;
+            if (parallel)
+                voiceSpan = impl.getVoiceOutput(index, numFrames);
+            else {
+                mm.beginVoice(voice.getId(), region->getId(), voice.getTriggerEvent().value);
+                voice.renderBlock(voiceSpan);
+                mm.endVoice();
+            }
+
             for (size_t i = 0, n = effectBuses.size(); i < n; ++i) {
                 if (auto& bus = effectBuses[i]) {
                     float addGain = region->getGainToEffectBus(i);
-                    bus->addToInputs(*tempSpan, addGain, numFrames);
+                    bus->addToInputs(voiceSpan, addGain, numFrames);
                 }
             }
             callbackBreakdown.data += voice.getLastDataDuration();
@@ -1188,8 +1205,6 @@ void Synth::renderBlock(AudioSpan<float> buffer) noexcept
             callbackBreakdown.filters += voice.getLastFilterDuration();
             callbackBreakdown.panning += voice.getLastPanningDuration();
 
-            mm.endVoice();
-
             if (voice.toBeCleanedUp())
                 voice.reset();
         }
@@ -1853,6 +1868,12 @@ size_t Synth::getNumPreloadedSamples() const noexcept
     return impl.resources_.getFilePool().getNumPreloadedSamples();
 }
 
+int Synth::getNumOutputs() const noexcept
+{
+    Impl& impl = *impl_;
+    return impl.numOutputs_;
+}
+
 int Synth::getSampleQuality(ProcessMode mode)
 {
     Impl& impl = *impl_;
@@ -1974,6 +1995,87 @@ void Synth::Impl::resetVoices(int numVoices)
     }
 
     applySettingsPerVoice();
+    resizeVoiceOutputs();
+}
+
+void Synth::Impl::resizeVoiceOutputs()
+{
+    if (!renderPool_) {
+        voiceOutputs_.clear();
+        voiceOutputStride_ = 0;
+        return;
+    }
+
+    const auto numVoices = static_cast<size_t>(std::distance(voiceManager_.begin(), voiceManager_.end()));
+    voiceOutputStride_ = (static_cast<size_t>(samplesPerBlock_) + 15) & ~size_t(15); // keep channels aligned
+    voiceOutputs_.resize(2 * numVoices * voiceOutputStride_);
+    renderOrder_.reserve(numVoices);
+    renderJobs_.reserve(numVoices + 1);
+}
+
+AudioSpan<float> Synth::Impl::getVoiceOutput(size_t index, size_t numFrames) noexcept
+{
+    float* left = voiceOutputs_.data() + 2 * index * voiceOutputStride_;
+    return AudioSpan<float>({ left, left + voiceOutputStride_ }, numFrames);
+}
+
+bool Synth::Impl::renderVoicesInParallel(size_t numFrames) noexcept
+{
+    ModMatrix& mm = resources_.getModMatrix();
+
+    renderOrder_.clear();
+    renderJobs_.clear();
+
+    uint32_t index = 0;
+    for (auto& voice : voiceManager_) {
+        if (!voice.isFree())
+            renderOrder_.push_back(index);
+        ++index;
+    }
+
+    if (renderOrder_.size() < 2)
+        return false;
+
+    // the voices then only read the per-cycle sources
+    for (uint32_t i : renderOrder_) {
+        const Voice& voice = voiceManager_[i];
+        mm.generateGlobalSources(voice.getId(), voice.getRegion()->getId());
+    }
+
+    auto regionOf = [this](uint32_t i) { return voiceManager_[i].getRegion()->getId().number(); };
+    std::sort(renderOrder_.begin(), renderOrder_.end(), [&regionOf](uint32_t a, uint32_t b) {
+        const auto ra = regionOf(a);
+        const auto rb = regionOf(b);
+        return ra < rb || (ra == rb && a < b);
+    });
+
+    for (size_t i = 0, n = renderOrder_.size(); i < n; ++i) {
+        if (i == 0 || regionOf(renderOrder_[i]) != regionOf(renderOrder_[i - 1]))
+            renderJobs_.push_back(static_cast<uint32_t>(i));
+    }
+
+    const size_t numJobs = renderJobs_.size();
+    if (numJobs < 2)
+        return false;
+
+    renderJobs_.push_back(static_cast<uint32_t>(renderOrder_.size()));
+    renderFrames_ = numFrames;
+    renderPool_->run(numJobs, &renderVoiceJob, this);
+    return true;
+}
+
+void Synth::Impl::renderVoiceJob(void* data, size_t job) noexcept
+{
+    Impl& impl = *static_cast<Impl*>(data);
+    ModMatrix& mm = impl.resources_.getModMatrix();
+
+    for (uint32_t i = impl.renderJobs_[job], end = impl.renderJobs_[job + 1]; i < end; ++i) {
+        const uint32_t index = impl.renderOrder_[i];
+        Voice& voice = impl.voiceManager_[index];
+        mm.beginVoice(voice.getId(), voice.getRegion()->getId(), voice.getTriggerEvent().value);
+        voice.renderBlock(impl.getVoiceOutput(index, impl.renderFrames_));
+        mm.endVoice();
+    }
 }
 
 void Synth::Impl::resetCallbackBreakdown()
@@ -2094,6 +2196,51 @@ uint32_t Synth::getPreloadSize() const noexcept
     return impl.resources_.getFilePool().getPreloadSize();
 }
 
+void Synth::setRamLoading(bool loadInRam) noexcept
+{
+    Impl& impl = *impl_;
+    impl.loadInRam_ = loadInRam;
+    impl.resources_.getFilePool().setRamLoading(loadInRam);
+}
+
+bool Synth::getRamLoading() const noexcept
+{
+    Impl& impl = *impl_;
+    return impl.resources_.getFilePool().getRamLoading();
+}
+
+void Synth::setNumBackgroundThreads(unsigned numThreads) noexcept
+{
+    Impl& impl = *impl_;
+    impl.resources_.getFilePool().setNumBackgroundThreads(numThreads);
+}
+
+unsigned Synth::getNumBackgroundThreads() const noexcept
+{
+    Impl& impl = *impl_;
+    return impl.resources_.getFilePool().getNumBackgroundThreads();
+}
+
+void Synth::setNumRenderThreads(unsigned numThreads) noexcept
+{
+    Impl& impl = *impl_;
+
+    if (numThreads == getNumRenderThreads())
+        return;
+
+    impl.renderPool_.reset();
+    if (numThreads > 1)
+        impl.renderPool_.reset(new VoiceRenderPool(numThreads, impl.samplesPerBlock_));
+
+    impl.resizeVoiceOutputs();
+}
+
+unsigned Synth::getNumRenderThreads() const noexcept
+{
+    Impl& impl = *impl_;
+    return impl.renderPool_ ? impl.renderPool_->getNumThreads() : 1;
+}
+
 void Synth::enableFreeWheeling() noexcept
 {
     Impl& impl = *impl_;
@@ -2174,6 +2321,18 @@ const Synth::CallbackBreakdown& Synth::getCallbackBreakdown() const noexcept
     return impl.callbackBreakdown_;
 }
 
+Synth::StreamingStats Synth::getStreamingStats() const noexcept
+{
+    Impl& impl = *impl_;
+    const FilePool& filePool = impl.resources_.getFilePool();
+    StreamingStats stats;
+    stats.numStreamingFiles = filePool.getNumStreamingFiles();
+    stats.numStreamedFiles = filePool.getNumStreamedFiles();
+    stats.numStreamedFrames = filePool.getNumStreamedFrames();
+    stats.numUnderruns = filePool.getNumUnderruns();
+    return stats;
+}
+
 
 void Synth::allSoundOff() noexcept
 {
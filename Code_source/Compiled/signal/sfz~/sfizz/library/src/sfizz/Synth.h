@@ -282,6 +282,13 @@ public:
      * @return size_t
      */
     size_t getNumPreloadedSamples() const noexcept;
+    /**
+     * @brief Get the number of stereo outputs used by the regions, set with
+     * the `output` opcode
+     *
+     * @return int
+     */
+    int getNumOutputs() const noexcept;
 
     /**
      * @brief Set the maximum size of the blocks for the callback. The actual
@@ -598,6 +605,55 @@ public:
      */
     uint32_t getPreloadSize() const noexcept;
 
+    /**
+     * @brief Set whether samples are loaded entirely in memory instead of
+     * being streamed from disk. This applies to the next files loaded,
+     * unless they set the hint_ram_based opcode, and reloads the current
+     * ones. It can take a long time to return.
+     *
+     * @param loadInRam
+     */
+    void setRamLoading(bool loadInRam) noexcept;
+
+    /**
+     * @brief Get whether samples are loaded entirely in memory
+     *
+     * @return bool
+     */
+    bool getRamLoading() const noexcept;
+
+    /**
+     * @brief Set the number of threads streaming files from disk for this
+     * synth. 0 uses a pool shared by all the synths of the process.
+     *
+     * @param numThreads
+     */
+    void setNumBackgroundThreads(unsigned numThreads) noexcept;
+
+    /**
+     * @brief Get the number of background loading threads
+     *
+     * @return unsigned
+     */
+    unsigned getNumBackgroundThreads() const noexcept;
+
+    /**
+     * @brief Set the number of threads rendering the voices, including the
+     * one calling renderBlock(). With more than 1, the voices of different
+     * regions render in parallel and are mixed in the same order as with a
+     * single thread. This must not be called while rendering.
+     *
+     * @param numThreads
+     */
+    void setNumRenderThreads(unsigned numThreads) noexcept;
+
+    /**
+     * @brief Get the number of threads rendering the voices
+     *
+     * @return unsigned
+     */
+    unsigned getNumRenderThreads() const noexcept;
+
     /**
      * @brief Gets the number of allocated buffers.
      *
@@ -668,6 +724,22 @@ public:
      */
     const CallbackBreakdown& getCallbackBreakdown() const noexcept;
 
+    struct StreamingStats
+    {
+        size_t numStreamingFiles { 0 };
+        uint64_t numStreamedFiles { 0 };
+        uint64_t numStreamedFrames { 0 };
+        uint64_t numUnderruns { 0 };
+    };
+    /**
+     * @brief Get the disk streaming statistics: the files being streamed
+     * right now, then the files and frames streamed and the voices which ran
+     * out of data while streaming since the synth was created.
+     *
+     * @return StreamingStats
+     */
+    StreamingStats getStreamingStats() const noexcept;
+
     /**
      * @brief Shuts down the current processing, clear buffers and reset the voices.
      *
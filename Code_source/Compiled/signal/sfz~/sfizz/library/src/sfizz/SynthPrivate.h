@@ -5,6 +5,7 @@
 #include "SisterVoiceRing.h"
 #include "TriggerEvent.h"
 #include "VoiceManager.h"
+#include "VoiceRenderPool.h"
 #include "Layer.h"
 #include "BitArray.h"
 #include "modulations/sources/ADSREnvelope.h"
@@ -321,6 +322,36 @@ struct Synth::Impl final: public Parser::Listener {
     float sampleRate_ { config::defaultSampleRate };
     float volume_ { Default::globalVolume };
     int numVoices_ { config::numVoices };
+    bool loadInRam_ { config::loadInRam };
+
+    // Parallel voice rendering, null when the voices render on the audio thread only
+    std::unique_ptr<VoiceRenderPool> renderPool_;
+    std::vector<uint32_t> renderOrder_; // indices of the active voices, grouped by region
+    std::vector<uint32_t> renderJobs_; // start of each region in renderOrder_, then its end
+    Buffer<float> voiceOutputs_; // a stereo block for each voice, mixed in voice order
+    size_t voiceOutputStride_ { 0 };
+    size_t renderFrames_ { 0 };
+
+    /**
+     * @brief Allocate the voice outputs for parallel rendering, or release
+     * them without a render pool.
+     */
+    void resizeVoiceOutputs();
+
+    /**
+     * @brief Get the output of a voice when rendering in parallel
+     */
+    AudioSpan<float> getVoiceOutput(size_t index, size_t numFrames) noexcept;
+
+    /**
+     * @brief Render the active voices into their outputs with the render
+     * pool. The voices of a region share modulation buffers so they are one
+     * job, rendered in order by a single thread.
+     *
+     * @return false if there was not enough to split, and nothing was rendered
+     */
+    bool renderVoicesInParallel(size_t numFrames) noexcept;
+    static void renderVoiceJob(void* data, size_t job) noexcept;
 
     // Distribution used to generate random value for the *rand opcodes
     std::uniform_real_distribution<float> randNoteDistribution_ { 0, 1 };
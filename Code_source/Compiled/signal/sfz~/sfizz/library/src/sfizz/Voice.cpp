@@ -291,6 +291,7 @@ struct Voice::Impl
     double panningDuration_;
     double filterDuration_;
 
+    fast_rand noiseGenerator_;
     fast_real_distribution<float> uniformNoiseDist_ { -config::uniformNoiseBounds, config::uniformNoiseBounds };
     fast_gaussian_generator<float> gaussianNoiseDist_ { 0.0f, config::noiseVariance };
 
@@ -433,6 +434,11 @@ bool Voice::startVoice(Layer* layer, int delay, const TriggerEvent& event) noexc
 
     impl.updateExtendedCCValues();
 
+    // Voices can render on helper threads, so noise is drawn from a generator
+    // of their own, seeded here on the thread that starts them
+    if (region.isGenerator())
+        impl.noiseGenerator_.seed(Random::randomGenerator());
+
     ASSERT(delay >= 0);
     if (delay < 0)
         delay = 0;
@@ -1152,6 +1158,8 @@ void Voice::Impl::fillWithData(AudioSpan<float> buffer) noexcept
     }
 
     const auto sampleEnd = min( int(sampleEnd_), int(currentPromise_->information.end), int(source.getNumFrames())) - 1;
+    // the file is still streaming if less than the whole sample is available
+    const bool streaming = int(source.getNumFrames()) < min(int(sampleEnd_), int(currentPromise_->information.end));
 
     int blockRestarts { 0 };
     int oldIndex {};
@@ -1215,6 +1223,8 @@ void Voice::Impl::fillWithData(AudioSpan<float> buffer) noexcept
                     continue;
                 }
 
+                if (streaming)
+                    resources_.getFilePool().countUnderrun();
                 off(int(i), true);
                 fill<int>(indices->subspan(i), sampleEnd);
                 fill<float>(coeffs->subspan(i), 0x1.fffffep-1);
@@ -1490,7 +1500,7 @@ void Voice::Impl::fillWithGenerator(AudioSpan<float> buffer) noexcept
 
     if (region_->sampleId->filename() == "*noise") {
         auto gen = [&]() {
-            return uniformNoiseDist_(Random::randomGenerator);
+            return uniformNoiseDist_(noiseGenerator_);
         };
         absl::c_generate(leftSpan, gen);
         absl::c_generate(rightSpan, gen);
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+// This code is part of the sfizz library and is licensed under a BSD 2-clause
+// license. You should have receive a LICENSE.md file along with the code.
+// If not, contact the sfizz maintainers at https://github.com/sfztools/sfizz
+
+#include "VoiceRenderPool.h"
+#include "Resources.h"
+#include "ScopedFTZ.h"
+#include <algorithm>
+
+namespace sfz {
+
+VoiceRenderPool::VoiceRenderPool(unsigned numThreads, unsigned samplesPerBlock)
+{
+    const unsigned numHelpers = numThreads > 1 ? numThreads - 1 : 0;
+    helpers_.reserve(numHelpers);
+
+    for (unsigned i = 0; i < numHelpers; ++i) {
+        helpers_.emplace_back(new Helper);
+        Helper& helper = *helpers_.back();
+        helper.bufferPool.setBufferSize(samplesPerBlock);
+        helper.thread = std::thread([this, &helper]() { helperLoop(helper); });
+    }
+}
+
+VoiceRenderPool::~VoiceRenderPool()
+{
+    quit_.store(true);
+
+    std::error_code ec;
+    for (auto& helper : helpers_)
+        helper->start.post(ec);
+
+    for (auto& helper : helpers_)
+        helper->thread.join();
+}
+
+void VoiceRenderPool::setSamplesPerBlock(unsigned samplesPerBlock)
+{
+    for (auto& helper : helpers_)
+        helper->bufferPool.setBufferSize(samplesPerBlock);
+}
+
+void VoiceRenderPool::run(size_t numJobs, JobFunction function, void* data) noexcept
+{
+    numJobs_ = numJobs;
+    function_ = function;
+    data_ = data;
+    nextJob_.store(0, std::memory_order_relaxed);
+
+    // no need to wake more helpers than there are jobs left for them
+    const size_t numWoken = std::min(helpers_.size(), numJobs > 0 ? numJobs - 1 : 0);
+    pending_.store(numWoken, std::memory_order_relaxed);
+
+    std::error_code ec;
+    for (size_t i = 0; i < numWoken; ++i)
+        helpers_[i]->start.post(ec);
+
+    doJobs();
+
+    if (numWoken > 0)
+        done_.wait(ec);
+}
+
+void VoiceRenderPool::doJobs() noexcept
+{
+    size_t job;
+    while ((job = nextJob_.fetch_add(1, std::memory_order_relaxed)) < numJobs_)
+        function_(data_, job);
+}
+
+void VoiceRenderPool::helperLoop(Helper& helper) noexcept
+{
+    Resources::setThreadBufferPool(&helper.bufferPool);
+    ScopedFTZ ftz;
+
+    std::error_code ec;
+    for (;;) {
+        helper.start.wait(ec);
+        if (quit_.load())
+            break;
+
+        doJobs();
+
+        if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            done_.post(ec);
+    }
+}
+
+} // namespace sfz
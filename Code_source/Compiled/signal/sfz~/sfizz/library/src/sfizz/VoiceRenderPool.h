@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+// This code is part of the sfizz library and is licensed under a BSD 2-clause
+// license. You should have receive a LICENSE.md file along with the code.
+// If not, contact the sfizz maintainers at https://github.com/sfztools/sfizz
+
+#pragma once
+#include "BufferPool.h"
+#include "RTSemaphore.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace sfz {
+
+/**
+ * @brief Threads helping the audio thread to render voices.
+ *
+ * The thread calling run() takes part in the work and keeps using the buffer
+ * pool of the synth. Each helper thread has its own buffer pool, which the
+ * resources hand out to the code running on it, so voices can take their
+ * scratch buffers without locking.
+ */
+class VoiceRenderPool {
+public:
+    using JobFunction = void (*)(void* data, size_t job);
+
+    /**
+     * @brief Start the helper threads
+     *
+     * @param numThreads the number of threads rendering, including the caller of run()
+     * @param samplesPerBlock the size of the scratch buffers
+     */
+    VoiceRenderPool(unsigned numThreads, unsigned samplesPerBlock);
+    ~VoiceRenderPool();
+
+    VoiceRenderPool(const VoiceRenderPool&) = delete;
+    VoiceRenderPool& operator=(const VoiceRenderPool&) = delete;
+
+    /**
+     * @brief Get the number of threads rendering, including the caller of run()
+     */
+    unsigned getNumThreads() const noexcept { return static_cast<unsigned>(helpers_.size()) + 1; }
+
+    /**
+     * @brief Resize the scratch buffers of the helpers. This must not be
+     * called while running.
+     */
+    void setSamplesPerBlock(unsigned samplesPerBlock);
+
+    /**
+     * @brief Call function(data, job) for every job in [0, numJobs) and
+     * return when all of them are done. Jobs are taken in order by the first
+     * thread available, so they must not depend on each other.
+     */
+    void run(size_t numJobs, JobFunction function, void* data) noexcept;
+
+private:
+    struct Helper {
+        std::thread thread;
+        RTSemaphore start;
+        BufferPool bufferPool;
+    };
+
+    void helperLoop(Helper& helper) noexcept;
+    void doJobs() noexcept;
+
+    std::vector<std::unique_ptr<Helper>> helpers_;
+    RTSemaphore done_;
+    std::atomic<size_t> nextJob_ { 0 };
+    std::atomic<size_t> pending_ { 0 };
+    std::atomic<bool> quit_ { false };
+    size_t numJobs_ { 0 };
+    JobFunction function_ { nullptr };
+    void* data_ { nullptr };
+};
+
+} // namespace sfz
@@ -19,15 +19,23 @@
 
 namespace sfz {
 
+namespace {
+// The voice being processed is kept per thread, so that voices of different
+// regions can be rendered in parallel
+struct VoiceContext {
+    NumericId<Voice> voiceId {};
+    NumericId<Region> regionId {};
+    float triggerValue {};
+};
+
+thread_local VoiceContext currentVoice;
+} // namespace
+
 struct ModMatrix::Impl {
     double sampleRate_ {};
     uint32_t samplesPerBlock_ {};
 
     uint32_t numFrames_ {};
-    NumericId<Voice> currentVoiceId_ {};
-    NumericId<Region> currentRegionId_ {};
-
-    float currentVoiceTriggerValue_ {};
 
     struct Source {
         ModKey key;
@@ -330,10 +338,9 @@ void ModMatrix::beginVoice(NumericId<Voice> voiceId, NumericId<Region> regionId,
 {
     Impl& impl = *impl_;
 
-    impl.currentVoiceId_ = voiceId;
-    impl.currentRegionId_ = regionId;
-
-    impl.currentVoiceTriggerValue_ = triggerValue;
+    currentVoice.voiceId = voiceId;
+    currentVoice.regionId = regionId;
+    currentVoice.triggerValue = triggerValue;
 
     ASSERT(regionId);
 
@@ -353,8 +360,8 @@ void ModMatrix::endVoice()
 {
     Impl& impl = *impl_;
     const uint32_t numFrames = impl.numFrames_;
-    const NumericId<Voice> voiceId = impl.currentVoiceId_;
-    const NumericId<Region> regionId = impl.currentRegionId_;
+    const NumericId<Voice> voiceId = currentVoice.voiceId;
+    const NumericId<Region> regionId = currentVoice.regionId;
 
     ASSERT(regionId);
     ASSERT(static_cast<size_t>(regionId.number()) < impl.sourceIndicesForRegion_.size());
@@ -369,10 +376,29 @@ void ModMatrix::endVoice()
         }
     }
 
-    impl.currentVoiceId_ = {};
-    impl.currentRegionId_ = {};
+    currentVoice = VoiceContext();
+}
+
+void ModMatrix::generateGlobalSources(NumericId<Voice> voiceId, NumericId<Region> regionId)
+{
+    Impl& impl = *impl_;
+    const uint32_t numFrames = impl.numFrames_;
+
+    ASSERT(regionId);
+    ASSERT(static_cast<size_t>(regionId.number()) < impl.targetIndicesForRegion_.size());
 
-    impl.currentVoiceTriggerValue_ = 0.0f;
+    const auto idNumber = static_cast<size_t>(regionId.number());
+    for (auto idx: impl.targetIndicesForRegion_[idNumber]) {
+        const Impl::Target& target = impl.targets_[idx];
+        for (const auto& connection : target.connectedSources) {
+            Impl::Source& source = impl.sources_[connection.first];
+            if ((source.key.flags() & kModIsPerCycle) && !source.bufferReady) {
+                absl::Span<float> buffer(source.buffer.data(), numFrames);
+                source.gen->generate(source.key, voiceId, buffer);
+                source.bufferReady = true;
+            }
+        }
+    }
 }
 
 float* ModMatrix::getModulation(TargetId targetId)
@@ -381,8 +407,8 @@ float* ModMatrix::getModulation(TargetId targetId)
         return nullptr;
 
     Impl& impl = *impl_;
-    const NumericId<Region> regionId = impl.currentRegionId_;
-    const float triggerValue = impl.currentVoiceTriggerValue_;
+    const NumericId<Region> regionId = currentVoice.regionId;
+    const float triggerValue = currentVoice.triggerValue;
     const uint32_t targetIndex = targetId.number();
     Impl::Target &target = impl.targets_[targetIndex];
     const int targetFlags = target.key.flags();
@@ -422,7 +448,7 @@ float* ModMatrix::getModulation(TargetId targetId)
 
             // unless source is already done, process it
             if (!source.bufferReady) {
-                source.gen->generate(source.key, impl.currentVoiceId_, sourceBuffer);
+                source.gen->generate(source.key, currentVoice.voiceId, sourceBuffer);
                 source.bufferReady = true;
             }
 
@@ -151,6 +151,17 @@ public:
      */
     void endVoice();
 
+    /**
+     * @brief Generate the per-cycle sources connected to the targets of a
+     * region, as the first voice of this region would do it. Once this ran
+     * for all the voices, they only read the shared buffers and the voices
+     * of different regions can be processed in parallel.
+     *
+     * @param voiceId the identifier of the voice
+     * @param regionId the identifier of the region of the voice
+     */
+    void generateGlobalSources(NumericId<Voice> voiceId, NumericId<Region> regionId);
+
     /**
      * @brief Get the modulation buffer for the given target.
      * If the target does not exist, the result is null.
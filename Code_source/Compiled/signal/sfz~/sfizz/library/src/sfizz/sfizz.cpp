@@ -120,6 +120,11 @@ size_t sfz::Sfizz::getNumPreloadedSamples() const noexcept
     return synth->synth.getNumPreloadedSamples();
 }
 
+int sfz::Sfizz::getNumOutputs() const noexcept
+{
+    return synth->synth.getNumOutputs();
+}
+
 void sfz::Sfizz::setSamplesPerBlock(int samplesPerBlock) noexcept
 {
     synth->synth.setSamplesPerBlock(samplesPerBlock);
@@ -307,6 +312,36 @@ uint32_t sfz::Sfizz::getPreloadSize() const noexcept
     return synth->synth.getPreloadSize();
 }
 
+void sfz::Sfizz::setRamLoading(bool loadInRam) noexcept
+{
+    synth->synth.setRamLoading(loadInRam);
+}
+
+bool sfz::Sfizz::getRamLoading() const noexcept
+{
+    return synth->synth.getRamLoading();
+}
+
+void sfz::Sfizz::setNumBackgroundThreads(unsigned numThreads) noexcept
+{
+    synth->synth.setNumBackgroundThreads(numThreads);
+}
+
+unsigned sfz::Sfizz::getNumBackgroundThreads() const noexcept
+{
+    return synth->synth.getNumBackgroundThreads();
+}
+
+void sfz::Sfizz::setNumRenderThreads(unsigned numThreads) noexcept
+{
+    synth->synth.setNumRenderThreads(numThreads);
+}
+
+unsigned sfz::Sfizz::getNumRenderThreads() const noexcept
+{
+    return synth->synth.getNumRenderThreads();
+}
+
 int sfz::Sfizz::getAllocatedBuffers() const noexcept
 {
     return synth->synth.getAllocatedBuffers();
@@ -369,6 +404,17 @@ sfz::Sfizz::CallbackBreakdown sfz::Sfizz::getCallbackBreakdown() noexcept
     return breakdown;
 }
 
+sfz::Sfizz::StreamingStats sfz::Sfizz::getStreamingStats() const noexcept
+{
+    StreamingStats stats;
+    const auto st = synth->synth.getStreamingStats();
+    stats.numStreamingFiles = st.numStreamingFiles;
+    stats.numStreamedFiles = st.numStreamedFiles;
+    stats.numStreamedFrames = st.numStreamedFrames;
+    stats.numUnderruns = st.numUnderruns;
+    return stats;
+}
+
 void sfz::Sfizz::allSoundOff() noexcept
 {
     synth->synth.allSoundOff();
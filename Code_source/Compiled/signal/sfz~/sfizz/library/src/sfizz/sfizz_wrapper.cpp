@@ -100,6 +100,10 @@ size_t sfizz_get_num_preloaded_samples(sfizz_synth_t* synth)
 {
     return synth->synth.getNumPreloadedSamples();
 }
+int sfizz_get_num_outputs(sfizz_synth_t* synth)
+{
+    return synth->synth.getNumOutputs();
+}
 int sfizz_get_num_active_voices(sfizz_synth_t* synth)
 {
     return synth->synth.getNumActiveVoices();
@@ -210,6 +214,33 @@ void sfizz_set_preload_size(sfizz_synth_t* synth, unsigned int preload_size)
     synth->synth.setPreloadSize(preload_size);
 }
 
+bool sfizz_get_ram_loading(sfizz_synth_t* synth)
+{
+    return synth->synth.getRamLoading();
+}
+void sfizz_set_ram_loading(sfizz_synth_t* synth, bool load_in_ram)
+{
+    synth->synth.setRamLoading(load_in_ram);
+}
+
+unsigned int sfizz_get_num_background_threads(sfizz_synth_t* synth)
+{
+    return synth->synth.getNumBackgroundThreads();
+}
+void sfizz_set_num_background_threads(sfizz_synth_t* synth, unsigned int num_threads)
+{
+    synth->synth.setNumBackgroundThreads(num_threads);
+}
+
+unsigned int sfizz_get_num_render_threads(sfizz_synth_t* synth)
+{
+    return synth->synth.getNumRenderThreads();
+}
+void sfizz_set_num_render_threads(sfizz_synth_t* synth, unsigned int num_threads)
+{
+    synth->synth.setNumRenderThreads(num_threads);
+}
+
 sfizz_oversampling_factor_t sfizz_get_oversampling_factor(sfizz_synth_t*)
 {
     return SFIZZ_OVERSAMPLING_X1;
@@ -345,6 +376,15 @@ void sfizz_get_callback_breakdown(sfizz_synth_t* synth, sfizz_callback_breakdown
     breakdown->effects = bd.effects;
 }
 
+void sfizz_get_streaming_stats(sfizz_synth_t* synth, sfizz_streaming_stats_t* stats)
+{
+    const auto st = synth->synth.getStreamingStats();
+    stats->num_streaming_files = st.numStreamingFiles;
+    stats->num_streamed_files = st.numStreamedFiles;
+    stats->num_streamed_frames = st.numStreamedFrames;
+    stats->num_underruns = st.numUnderruns;
+}
+
 void sfizz_all_sound_off(sfizz_synth_t* synth)
 {
     return synth->synth.allSoundOff();
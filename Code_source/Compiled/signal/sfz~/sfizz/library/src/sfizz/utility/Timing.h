@@ -48,10 +48,10 @@ struct ScopedTiming
         switch(operation)
         {
         case(Operation::replaceDuration):
-            targetDuration = (highResNow() - creationTime).count();
+            targetDuration = Duration(highResNow() - creationTime).count();
             break;
         case(Operation::addToDuration):
-            targetDuration += (highResNow() - creationTime).count();
+            targetDuration += Duration(highResNow() - creationTime).count();
             break;
         }
     }
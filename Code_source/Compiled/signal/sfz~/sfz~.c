@@ -12,26 +12,246 @@ __attribute__((visibility("default")))
 //#include "../shared/elsefile.h"
 #include <sfizz.h>
 #include <sfizz/import/sfizz_import.h>
-#include <unistd.h>
+#include <pthread.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <math.h>
 
+// Files are loaded on a background thread into a second synth, which replaces
+// the playing one once it's ready. The swap happens in a clock, so between DSP
+// ticks, and the old synth is freed in the background as well. The thread only
+// sees a copy of the settings made when the load started (t_sfz_load), and
+// whatever changed since is applied to the new synth before the swap.
+
+#define SFZ_IDLE        0
+#define SFZ_LOADING     1
+#define SFZ_READY       2 // new synth loaded, waiting to be swapped in
+#define SFZ_POLL        10 // ms
+#define SFZ_MAXOUTS     16 // sfizz's limit for stereo outputs
+
+// Render timings, in ms: sfizz's callback breakdown plus the whole block
+#define SFZ_NTIMES      8
+#define SFZ_TOTAL       7
+
+#define sfz_getstate(x)     __atomic_load_n(&(x)->x_state, __ATOMIC_ACQUIRE)
+#define sfz_setstate(x, s)  __atomic_store_n(&(x)->x_state, (s), __ATOMIC_RELEASE)
+
 static t_class* sfz_class;
 
+typedef struct _sfz_load{
+    sfizz_synth_t  *l_synth;    // being loaded
+    int             l_ok;       // load result
+    char            l_path[MAXPDSTRING];
+    float           l_sr;
+    int             l_blksize;
+    int             l_voices;
+    int             l_preload;
+    int             l_ram;
+    int             l_loaders;
+    int             l_threads;
+    int             l_oversampling;
+    int             l_freewheel;
+    int             l_tuneid;   // tuning the new synth was loaded with
+    t_symbol       *l_scala;
+    char           *l_scale;    // our own copy
+}t_sfz_load;
+
 typedef struct _sfz{
     t_object        x_obj;
-    sfizz_synth_t  *x_synth;
+    sfizz_synth_t  *x_synth;    // the one playing
+    t_sfz_load     *x_load;     // owned by the loading thread until SFZ_READY
     t_canvas       *x_canvas;
+    t_outlet       *x_status;
+    t_clock        *x_clock;
+    pthread_t       x_thread;
+    int             x_state;
     int             x_midinum;
     float           x_a4;
     int             x_base;
     float           x_ratio;
     float           x_bratio;
+    float           x_sr;
+    int             x_blksize;
+    int             x_voices;
+    float           x_volume;
+    int             x_preload;  // frames, 0 is sfizz's default
+    int             x_ram;      // load whole samples in memory
+    int             x_loaders;  // disk streaming threads, 0 is the shared pool
+    int             x_threads;  // voice rendering threads, including Pd's
+    int             x_oversampling;
+    int             x_freewheel;
+    int             x_mc;
+    int             x_outs;     // stereo outputs in -mc mode, from the 'output' opcodes
+    float          *x_out[2*SFZ_MAXOUTS]; // left/right pointers for each output
+    int             x_tuneid;   // bumped on every scala/scale message
+    t_symbol       *x_scala;
+    char           *x_scale;
+    t_symbol       *x_file;     // file being loaded
+    t_symbol       *x_loaded;   // file playing
+    t_symbol       *x_pending;  // next file asked for while loading
+    double          x_start;
+    double          x_last[SFZ_NTIMES]; // last block
+    double          x_avg[SFZ_NTIMES];  // rolling average
+    double          x_peak;     // longest block since the last report
+    double          x_coef;     // averaging coefficient, 1 second time constant
+    double          x_blockms;  // block duration
 //    t_elsefile     *x_elsefilehandle;
 }t_sfz;
 
+static void sfz_load_tuning(sfizz_synth_t *synth, t_symbol *scala, const char *scale){
+    if(scala)
+        sfizz_load_scala_file(synth, scala->s_name);
+    else if(scale)
+        sfizz_load_scala_string(synth, scale);
+}
+
+// snapshot of the settings for a load, taken on Pd's thread
+static t_sfz_load *sfz_load_new(t_sfz *x, const char *path){
+    t_sfz_load *l = (t_sfz_load *)getbytes(sizeof(t_sfz_load));
+    l->l_synth = NULL;
+    l->l_ok = 0;
+    snprintf(l->l_path, MAXPDSTRING, "%s", path);
+    l->l_sr = x->x_sr;
+    l->l_blksize = x->x_blksize;
+    l->l_voices = x->x_voices;
+    l->l_preload = x->x_preload;
+    l->l_ram = x->x_ram;
+    l->l_loaders = x->x_loaders;
+    l->l_threads = x->x_threads;
+    l->l_oversampling = x->x_oversampling;
+    l->l_freewheel = x->x_freewheel;
+    l->l_tuneid = x->x_tuneid;
+    l->l_scala = x->x_scala;
+    l->l_scale = NULL;
+    if(x->x_scale){
+        l->l_scale = (char *)getbytes(strlen(x->x_scale) + 1);
+        strcpy(l->l_scale, x->x_scale);
+    }
+    return(l);
+}
+
+static void sfz_load_free(t_sfz_load *l){
+    if(l->l_scale)
+        freebytes(l->l_scale, strlen(l->l_scale) + 1);
+    freebytes(l, sizeof(t_sfz_load));
+}
+
+static void sfz_configure(sfizz_synth_t *synth, t_sfz_load *l){
+    sfizz_set_sample_rate(synth, l->l_sr);
+    sfizz_set_samples_per_block(synth, l->l_blksize);
+    sfizz_set_num_voices(synth, l->l_voices);
+    if(l->l_preload)
+        sfizz_set_preload_size(synth, l->l_preload);
+    sfizz_set_ram_loading(synth, l->l_ram);
+    sfizz_set_num_background_threads(synth, l->l_loaders);
+    sfizz_set_num_render_threads(synth, l->l_threads);
+    sfizz_set_oversampling_factor(synth, (sfizz_oversampling_factor_t)l->l_oversampling);
+    if(l->l_freewheel)
+        sfizz_enable_freewheeling(synth);
+}
+
+static void *sfz_load_thread(void *arg){
+    t_sfz *x = (t_sfz *)arg;
+    t_sfz_load *l = x->x_load;
+    sfizz_synth_t *synth = sfizz_create_synth();
+    sfz_configure(synth, l);
+    sfz_load_tuning(synth, l->l_scala, l->l_scale);
+    l->l_ok = sfizz_load_or_import_file(synth, l->l_path, NULL);
+    l->l_synth = synth;
+    sfz_setstate(x, SFZ_READY);
+    return(NULL);
+}
+
+static void *sfz_free_thread(void *arg){
+    sfizz_free((sfizz_synth_t *)arg);
+    return(NULL);
+}
+
+static void sfz_dispose(sfizz_synth_t *synth){ // free without blocking
+    pthread_t thread;
+    if(pthread_create(&thread, NULL, sfz_free_thread, synth) == 0)
+        pthread_detach(thread);
+    else
+        sfizz_free(synth);
+}
+
+static void sfz_do_open(t_sfz *x, t_symbol *name);
+
+static void sfz_tick(t_sfz *x){
+    if(sfz_getstate(x) != SFZ_READY){
+        clock_delay(x->x_clock, SFZ_POLL);
+        return;
+    }
+    pthread_join(x->x_thread, NULL);
+    t_sfz_load *l = x->x_load;
+    sfizz_synth_t *synth = l->l_synth;
+    int ok = l->l_ok;
+    x->x_load = NULL;
+    t_atom at[4];
+    SETSYMBOL(at, x->x_file);
+    if(ok){
+        // catch up with what changed during the load (a DSP restart, block~,
+        // messages), then swap
+        if(l->l_sr != x->x_sr)
+            sfizz_set_sample_rate(synth, x->x_sr);
+        if(l->l_blksize != x->x_blksize)
+            sfizz_set_samples_per_block(synth, x->x_blksize);
+        if(l->l_tuneid != x->x_tuneid)
+            sfz_load_tuning(synth, x->x_scala, x->x_scale);
+        if(sfizz_get_num_voices(synth) != x->x_voices)
+            sfizz_set_num_voices(synth, x->x_voices);
+        if(l->l_loaders != x->x_loaders)
+            sfizz_set_num_background_threads(synth, x->x_loaders);
+        if(l->l_threads != x->x_threads)
+            sfizz_set_num_render_threads(synth, x->x_threads);
+        if(l->l_oversampling != x->x_oversampling)
+            sfizz_set_oversampling_factor(synth, (sfizz_oversampling_factor_t)x->x_oversampling);
+        sfizz_set_volume(synth, x->x_volume);
+        sfizz_set_tuning_frequency(synth, x->x_a4 * x->x_ratio * x->x_bratio);
+        if(x->x_freewheel)
+            sfizz_enable_freewheeling(synth);
+        else
+            sfizz_disable_freewheeling(synth);
+        sfizz_synth_t *old = x->x_synth;
+        x->x_synth = synth;
+        x->x_loaded = x->x_file;
+        sfz_dispose(old);
+        SETFLOAT(at+1, sfizz_get_num_regions(synth));
+        SETFLOAT(at+2, sfizz_get_num_preloaded_samples(synth));
+        SETFLOAT(at+3, clock_gettimesince(x->x_start));
+        sfz_setstate(x, SFZ_IDLE);
+        outlet_anything(x->x_status, gensym("loaded"), 4, at);
+        if(x->x_mc){
+            int outs = sfizz_get_num_outputs(synth);
+            outs = outs < 1 ? 1 : outs > SFZ_MAXOUTS ? SFZ_MAXOUTS : outs;
+            if(outs != x->x_outs){ // until then, sfizz wraps the extra outputs
+                x->x_outs = outs;
+                canvas_update_dsp();
+            }
+            SETFLOAT(at, outs);
+            outlet_anything(x->x_status, gensym("outputs"), 1, at);
+        }
+    }
+    else{
+        sfz_dispose(synth);
+        sfz_setstate(x, SFZ_IDLE);
+        pd_error(x, "[sfz~]: couldn't load %s", x->x_file->s_name);
+        outlet_anything(x->x_status, gensym("failed"), 1, at);
+    }
+    sfz_load_free(l);
+    if(x->x_pending){
+        t_symbol *name = x->x_pending;
+        x->x_pending = NULL;
+        sfz_do_open(x, name);
+    }
+}
+
 static void sfz_do_open(t_sfz *x, t_symbol *name){
+    if(sfz_getstate(x) != SFZ_IDLE){ // only the last one asked for gets loaded
+        x->x_pending = name;
+        return;
+    }
     const char *filename = name->s_name;
     const char *ext = strrchr(filename, '.');
     char realdir[MAXPDSTRING], *realname = NULL;
@@ -53,8 +273,24 @@ static void sfz_do_open(t_sfz *x, t_symbol *name){
         }
     }
     sys_close(fd);
-    chdir(realdir);
-    sfizz_load_or_import_file(x->x_synth, realname, NULL);
+    // full path, sfizz finds the samples relative to the file's directory
+    char path[MAXPDSTRING];
+    snprintf(path, MAXPDSTRING, "%s/%s", realdir, realname);
+    x->x_file = name;
+    x->x_load = sfz_load_new(x, path);
+    x->x_start = clock_getlogicaltime();
+    sfz_setstate(x, SFZ_LOADING);
+    if(pthread_create(&x->x_thread, NULL, sfz_load_thread, x) != 0){
+        sfz_setstate(x, SFZ_IDLE);
+        sfz_load_free(x->x_load);
+        x->x_load = NULL;
+        pd_error(x, "[sfz~]: couldn't start loading thread");
+        return;
+    }
+    t_atom at[1];
+    SETSYMBOL(at, name);
+    outlet_anything(x->x_status, gensym("loading"), 1, at);
+    clock_delay(x->x_clock, SFZ_POLL);
 }
 
 /*static void sfz_readhook(t_pd *z, t_symbol *fn, int ac, t_atom *av){
@@ -68,8 +304,12 @@ static void sfz_click(t_sfz *x){
 }*/
 
 static void sfz_scala(t_sfz* x, t_symbol *s){
-    if(!sfizz_load_scala_file(x->x_synth, s->s_name))
+    if(!sfizz_load_scala_file(x->x_synth, s->s_name)){
         post("[sfz~] could not load scala file");
+        return;
+    }
+    x->x_scala = s;
+    x->x_tuneid++;
 }
 
 static void sfz_scale(t_sfz* x, t_symbol *s, int ac, t_atom* av){
@@ -79,8 +319,16 @@ static void sfz_scale(t_sfz* x, t_symbol *s, int ac, t_atom* av){
     pscale += sprintf(pscale, "%d\n", ac-1);
     for(int i = 1; i < ac; i++)
         pscale += sprintf(pscale, "%f\n", atom_getfloat(av+i));
-    if(!sfizz_load_scala_string(x->x_synth, scale))
+    if(!sfizz_load_scala_string(x->x_synth, scale)){
         post("[sfz~] could not load scale");
+        return;
+    }
+    if(x->x_scale)
+        freebytes(x->x_scale, strlen(x->x_scale) + 1);
+    x->x_scale = (char *)getbytes(strlen(scale) + 1);
+    strcpy(x->x_scale, scale);
+    x->x_scala = NULL;
+    x->x_tuneid++;
 }
 
 static void sfz_setfreq(t_sfz* x, t_float f){
@@ -197,13 +445,95 @@ static void sfz_polytouch(t_sfz* x, t_float f1, t_float key){
 }
 
 static void sfz_volume(t_sfz* x, t_float f){
-    sfizz_set_volume(x->x_synth, f);
+    sfizz_set_volume(x->x_synth, x->x_volume = f);
 }
 
 static void sfz_voices(t_sfz* x, t_float f){
     int numvoices = (int)f;
     numvoices = (numvoices < 1) ? 1 : numvoices;
-    sfizz_set_num_voices(x->x_synth, numvoices);
+    sfizz_set_num_voices(x->x_synth, x->x_voices = numvoices);
+}
+
+// These reread the samples, so a loaded file is loaded again in the background
+static void sfz_reload(t_sfz *x){
+    if(sfz_getstate(x) != SFZ_IDLE){
+        if(!x->x_pending)
+            x->x_pending = x->x_file;
+    }
+    else if(x->x_loaded)
+        sfz_do_open(x, x->x_loaded);
+}
+
+static void sfz_preload(t_sfz* x, t_float f){
+    int preload = f < 0 ? 0 : (int)f;
+    if(preload == x->x_preload)
+        return;
+    x->x_preload = preload;
+    if(x->x_loaded || sfz_getstate(x) != SFZ_IDLE)
+        sfz_reload(x);
+    else if(preload)
+        sfizz_set_preload_size(x->x_synth, preload);
+}
+
+static void sfz_ram(t_sfz* x, t_float f){
+    int ram = f != 0;
+    if(ram == x->x_ram)
+        return;
+    x->x_ram = ram;
+    if(x->x_loaded || sfz_getstate(x) != SFZ_IDLE)
+        sfz_reload(x);
+    else
+        sfizz_set_ram_loading(x->x_synth, ram);
+}
+
+static void sfz_loaders(t_sfz* x, t_float f){
+    x->x_loaders = f < 0 ? 0 : (int)f;
+    sfizz_set_num_background_threads(x->x_synth, x->x_loaders);
+}
+
+static void sfz_threads(t_sfz* x, t_float f){
+    x->x_threads = f < 1 ? 1 : f > 64 ? 64 : (int)f;
+    sfizz_set_num_render_threads(x->x_synth, x->x_threads);
+}
+
+static void sfz_oversampling(t_sfz* x, t_float f){
+    int factor = (int)f;
+    if(factor != 1 && factor != 2 && factor != 4 && factor != 8){
+        pd_error(x, "[sfz~]: oversampling factor must be 1, 2, 4 or 8");
+        return;
+    }
+    sfizz_set_oversampling_factor(x->x_synth, (sfizz_oversampling_factor_t)(x->x_oversampling = factor));
+}
+
+static void sfz_freewheel(t_sfz* x, t_float f){
+    if((x->x_freewheel = f != 0))
+        sfizz_enable_freewheeling(x->x_synth);
+    else
+        sfizz_disable_freewheeling(x->x_synth);
+}
+
+static void sfz_profile(t_sfz* x){
+    static const char *names[2] = {"block", "average"};
+    t_atom at[SFZ_NTIMES];
+    for(int i = 0; i < 2; i++){
+        double *times = i ? x->x_avg : x->x_last;
+        for(int j = 0; j < SFZ_NTIMES; j++)
+            SETFLOAT(at+j, times[j]);
+        outlet_anything(x->x_status, gensym(names[i]), SFZ_NTIMES, at);
+    }
+    SETFLOAT(at, x->x_blockms > 0 ? 100 * x->x_avg[SFZ_TOTAL] / x->x_blockms : 0);
+    SETFLOAT(at+1, x->x_blockms > 0 ? 100 * x->x_peak / x->x_blockms : 0);
+    outlet_anything(x->x_status, gensym("load"), 2, at);
+    x->x_peak = 0;
+    SETFLOAT(at, sfizz_get_num_active_voices(x->x_synth));
+    outlet_anything(x->x_status, gensym("voices"), 1, at);
+    sfizz_streaming_stats_t stats;
+    sfizz_get_streaming_stats(x->x_synth, &stats);
+    SETFLOAT(at, sfizz_get_num_preloaded_samples(x->x_synth));
+    SETFLOAT(at+1, stats.num_streaming_files);
+    SETFLOAT(at+2, stats.num_streamed_files);
+    SETFLOAT(at+3, stats.num_underruns);
+    outlet_anything(x->x_status, gensym("files"), 4, at);
 }
 
 static void sfz_panic(t_sfz* x){
@@ -220,23 +550,80 @@ static void sfz_version(t_sfz *x){
     post("[sfz~] uses sfizz version '%s'", SFIZZ_VERSION);
 }
 
+static void sfz_render(t_sfz *x, float **outputs, int nch, int n){
+    double start = sys_getrealtime();
+    sfizz_render_block(x->x_synth, outputs, nch, n);
+    double elapsed = (sys_getrealtime() - start) * 1000.;
+    sfizz_callback_breakdown_t bd;
+    sfizz_get_callback_breakdown(x->x_synth, &bd);
+    double *last = x->x_last;
+    last[0] = bd.dispatch * 1000.;
+    last[1] = bd.renderMethod * 1000.;
+    last[2] = bd.data * 1000.;
+    last[3] = bd.amplitude * 1000.;
+    last[4] = bd.filters * 1000.;
+    last[5] = bd.panning * 1000.;
+    last[6] = bd.effects * 1000.;
+    last[SFZ_TOTAL] = last[0] + elapsed; // messages are dispatched between blocks
+    for(int i = 0; i < SFZ_NTIMES; i++)
+        x->x_avg[i] += x->x_coef * (last[i] - x->x_avg[i]);
+    if(last[SFZ_TOTAL] > x->x_peak)
+        x->x_peak = last[SFZ_TOTAL];
+}
+
 static t_int* sfz_perform(t_int* w){
     t_sfz *x = (t_sfz *)(w[1]);
     t_sample* outputs[2];
     outputs[0] = (t_sample *)(w[2]);
     outputs[1] = (t_sample *)(w[3]);
     t_int n = (t_int)(w[4]);
-    sfizz_render_block(x->x_synth, outputs, 2, n);
+    sfz_render(x, outputs, 2, n);
     return(w+5);
 }
 
+static t_int* sfz_perform_mc(t_int* w){
+    t_sfz *x = (t_sfz *)(w[1]);
+    int outs = (int)(w[2]);
+    t_int n = (t_int)(w[3]);
+    sfz_render(x, x->x_out, 2*outs, n);
+    return(w+4);
+}
+
 static void sfz_dsp(t_sfz* x, t_signal** sp){
-    dsp_add(&sfz_perform, 4, x, sp[0]->s_vec, sp[1]->s_vec, sp[0]->s_n);
+    if(sp[0]->s_sr != x->x_sr)
+        sfizz_set_sample_rate(x->x_synth, x->x_sr = sp[0]->s_sr);
+    if(sp[0]->s_n > x->x_blksize)
+        sfizz_set_samples_per_block(x->x_synth, x->x_blksize = sp[0]->s_n);
+    x->x_blockms = sp[0]->s_n * 1000. / sp[0]->s_sr;
+    x->x_coef = 1. - exp(-sp[0]->s_n / sp[0]->s_sr);
+    int n = sp[0]->s_n;
+    if(x->x_mc){
+        signal_setmultiout(&sp[0], x->x_outs);
+        signal_setmultiout(&sp[1], x->x_outs);
+        for(int i = 0; i < x->x_outs; i++){
+            x->x_out[2*i] = sp[0]->s_vec + i*n;
+            x->x_out[2*i+1] = sp[1]->s_vec + i*n;
+        }
+        dsp_add(&sfz_perform_mc, 3, x, (t_int)x->x_outs, (t_int)n);
+    }
+    else{
+        signal_setmultiout(&sp[0], 1);
+        signal_setmultiout(&sp[1], 1);
+        dsp_add(&sfz_perform, 4, x, sp[0]->s_vec, sp[1]->s_vec, (t_int)n);
+    }
 }
 
 static void sfz_free(t_sfz* x){
+    if(sfz_getstate(x) != SFZ_IDLE){ // can't interrupt sfizz, wait for it
+        pthread_join(x->x_thread, NULL);
+        sfz_dispose(x->x_load->l_synth);
+        sfz_load_free(x->x_load);
+    }
+    clock_free(x->x_clock);
     if(x->x_synth)
         sfizz_free(x->x_synth);
+    if(x->x_scale)
+        freebytes(x->x_scale, strlen(x->x_scale) + 1);
 //    if(x->x_elsefilehandle)
 //        elsefile_free(x->x_elsefilehandle);
 }
@@ -244,24 +631,73 @@ static void sfz_free(t_sfz* x){
 static void* sfz_new(t_symbol *s, int ac, t_atom *av){
     (void)s;
     t_sfz* x = (t_sfz*)pd_new(sfz_class);
+    x->x_voices = 64;
+    x->x_threads = 1;
+    x->x_oversampling = 1;
+    x->x_outs = 1;
+    while(ac && av->a_type == A_SYMBOL && av->a_w.w_symbol->s_name[0] == '-'){
+        t_symbol *sym = av->a_w.w_symbol;
+        if(sym == gensym("-ram"))
+            x->x_ram = 1, ac--, av++;
+        else if(sym == gensym("-freewheel"))
+            x->x_freewheel = 1, ac--, av++;
+        else if(sym == gensym("-mc"))
+            x->x_mc = 1, ac--, av++;
+        else if(sym == gensym("-preload") && ac >= 2){
+            t_float f = atom_getfloat(av+1);
+            x->x_preload = f < 0 ? 0 : (int)f;
+            ac -= 2, av += 2;
+        }
+        else if(sym == gensym("-loaders") && ac >= 2){
+            t_float f = atom_getfloat(av+1);
+            x->x_loaders = f < 0 ? 0 : (int)f;
+            ac -= 2, av += 2;
+        }
+        else if(sym == gensym("-threads") && ac >= 2){
+            t_float f = atom_getfloat(av+1);
+            x->x_threads = f < 1 ? 1 : f > 64 ? 64 : (int)f;
+            ac -= 2, av += 2;
+        }
+        else if(sym == gensym("-voices") && ac >= 2){
+            t_float f = atom_getfloat(av+1);
+            x->x_voices = f < 1 ? 1 : (int)f;
+            ac -= 2, av += 2;
+        }
+        else if(sym == gensym("-oversampling") && ac >= 2){
+            int f = (int)atom_getfloat(av+1);
+            x->x_oversampling = (f == 2 || f == 4 || f == 8) ? f : 1;
+            ac -= 2, av += 2;
+        }
+        else
+            goto errstate;
+    }
 //    x->x_elsefilehandle = elsefile_new((t_pd *)x, sfz_readhook, 0);
     x->x_canvas = canvas_getcurrent();
     outlet_new(&x->x_obj, &s_signal);
     outlet_new(&x->x_obj, &s_signal);
+    x->x_status = outlet_new(&x->x_obj, &s_anything);
+    x->x_clock = clock_new(x, (t_method)sfz_tick);
+    x->x_sr = sys_getsr();
+    x->x_blksize = sys_getblksize();
     x->x_synth = sfizz_create_synth();
-    sfizz_set_sample_rate(x->x_synth , sys_getsr());
-    sfizz_set_samples_per_block(x->x_synth , sys_getblksize());
+    t_sfz_load *l = sfz_load_new(x, "");
+    sfz_configure(x->x_synth, l);
+    sfz_load_free(l);
+    x->x_volume = sfizz_get_volume(x->x_synth);
     x->x_a4 = 440;
     x->x_base = 0;
     x->x_ratio = x->x_bratio = 1.;
     if(ac == 1 && av[0].a_type == A_SYMBOL)
         sfz_open(x, av[0].a_w.w_symbol);
     return(x);
+errstate:
+    pd_error(x, "[sfz~]: improper args");
+    return(NULL);
 }
 
 void sfz_tilde_setup(){
     sfz_class = class_new(gensym("sfz~"), (t_newmethod)&sfz_new,
-        (t_method)sfz_free, sizeof(t_sfz), CLASS_DEFAULT, A_GIMME, 0);
+        (t_method)sfz_free, sizeof(t_sfz), CLASS_MULTICHANNEL, A_GIMME, 0);
     class_addmethod(sfz_class, (t_method)sfz_dsp, gensym("dsp"), A_CANT, 0);
     class_addfloat(sfz_class, (t_method)sfz_midiin);
     class_addlist(sfz_class, (t_method)sfz_note);
@@ -282,6 +718,13 @@ void sfz_tilde_setup(){
     class_addmethod(sfz_class, (t_method)sfz_transp, gensym("transp"), A_FLOAT, 0);
     class_addmethod(sfz_class, (t_method)sfz_volume, gensym("volume"), A_FLOAT, 0);
     class_addmethod(sfz_class, (t_method)sfz_voices, gensym("voices"), A_FLOAT, 0);
+    class_addmethod(sfz_class, (t_method)sfz_preload, gensym("preload"), A_FLOAT, 0);
+    class_addmethod(sfz_class, (t_method)sfz_ram, gensym("ram"), A_FLOAT, 0);
+    class_addmethod(sfz_class, (t_method)sfz_loaders, gensym("loaders"), A_FLOAT, 0);
+    class_addmethod(sfz_class, (t_method)sfz_threads, gensym("threads"), A_FLOAT, 0);
+    class_addmethod(sfz_class, (t_method)sfz_oversampling, gensym("oversampling"), A_FLOAT, 0);
+    class_addmethod(sfz_class, (t_method)sfz_freewheel, gensym("freewheel"), A_FLOAT, 0);
+    class_addmethod(sfz_class, (t_method)sfz_profile, gensym("profile"), 0);
     class_addmethod(sfz_class, (t_method)sfz_version, gensym("version"), 0);
 //    class_addmethod(sfz_class, (t_method)sfz_click, gensym("click"), A_FLOAT, A_FLOAT, A_FLOAT, A_FLOAT, A_FLOAT, 0);
 //    elsefile_setup();
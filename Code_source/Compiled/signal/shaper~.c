@@ -95,6 +95,7 @@ static t_int *shaper_perform(t_int *w){
     double ynm1 = x->x_ynm1;
     int n = (int)(w[4]);
     t_word *buf = (t_word *)x->x_buffer->c_vectors[0];
+    float *fbuf = x->x_buffer->c_fvectors[0];
     double maxidx = (double)(x->x_buffer->c_npts - 1);
     while(n--){
         double yn, xn;
@@ -115,10 +116,10 @@ static t_int *shaper_perform(t_int *w){
                 ndx1 -= maxidx;
             if(ndx2 >= maxidx)
                 ndx2 -= maxidx;
-            double a = buf[ndxm1].w_float;
-            double b = buf[ndx].w_float;
-            double c = buf[ndx1].w_float;
-            double d = buf[ndx2].w_float;
+            double a = buffer_sample(buf, fbuf, ndxm1);
+            double b = buffer_sample(buf, fbuf, ndx);
+            double c = buffer_sample(buf, fbuf, ndx1);
+            double d = buffer_sample(buf, fbuf, ndx2);
             output = interp_spline(frac, a, b, c, d);
         }
         else{
@@ -22,69 +22,127 @@
 #define SVFILTER_DEFFREQ   0.
 #define SVFILTER_DEFQ      .01  /* CHECKME */
 
+#define SVFILTER_LANES     4    // channels processed together
+
 typedef struct _svfilter{
     t_object x_obj;
     t_inlet *svfilter;
     t_inlet  *x_freq_inlet;
     t_inlet  *x_q_inlet;
     int    x_mode;
+    int    x_nchans;
     float  x_srcoef;
-    float  x_band;
-    float  x_low;
+    float *x_band;
+    float *x_low;
+    float *x_c1;    // coefficients of each channel for the block
+    float *x_c2;
 }t_svfilter;
 
 static t_class *svfilter_class;
 
 static void svfilter_clear(t_svfilter *x){
-    x->x_band = x->x_low = 0.;
+    for(int j = 0; j < x->x_nchans; j++)
+        x->x_band[j] = x->x_low[j] = 0.;
+}
+
+static void svfilter_coefs(t_svfilter *x, t_float fin0, t_float rin0, float *c1, float *c2){
+    float r = (1. - rin0) * SVFILTER_QSTRETCH;  /* CHECKED */
+    if (r < SVFILTER_MINR)
+        r = SVFILTER_MINR;
+    else if (r > SVFILTER_MAXR)
+        r = SVFILTER_MAXR;
+    *c2 = r * r;
+    float omega = fin0 * x->x_srcoef;
+    if (omega < SVFILTER_MINOMEGA)
+        omega = SVFILTER_MINOMEGA;
+    else if (omega > SVFILTER_MAXOMEGA)
+        omega = SVFILTER_MAXOMEGA;
+    *c1 = sinf(omega);
+}
+
+// freq and q are taken once per block, so coefficients are fixed per channel
+// and SVFILTER_LANES channels run side by side in the same loop
+static void svfilter_lanes(float *band, float *low, float *c1, float *c2, int nl,
+t_float *xin, t_float *lout, t_float *hout, t_float *bout, t_float *nout, int n){
+    float b[SVFILTER_LANES], l[SVFILTER_LANES];
+    int k;
+    for(k = 0; k < nl; k++)
+        b[k] = band[k], l[k] = low[k];
+    for(int i = 0; i < n; i++){
+        for(k = 0; k < nl; k++){
+            float high, xn = xin[k*n + i];
+            lout[k*n + i] = l[k] = l[k] + c1[k] * b[k];
+            hout[k*n + i] = high = xn - l[k] - c2[k] * b[k];
+            bout[k*n + i] = b[k] = c1[k] * high + b[k];
+            nout[k*n + i] = l[k] + high;
+            b[k] -= b[k] * b[k] * b[k] * SVFILTER_DRIVE;
+        }
+    }
+    for(k = 0; k < nl; k++){
+        band[k] = (PD_BIGORSMALL(b[k]) ? 0. : b[k]);
+        low[k] = (PD_BIGORSMALL(l[k]) ? 0. : l[k]);
+    }
 }
 
 static t_int *svfilter_perform(t_int *w){
     t_svfilter *x = (t_svfilter *)(w[1]);
     int n = (int)(w[2]);
-    t_float *xin = (t_float *)(w[3]);
-    t_float fin0 = *(t_float *)(w[4]);
-    t_float rin0 = *(t_float *)(w[5]);
-    t_float *lout = (t_float *)(w[6]);
-    t_float *hout = (t_float *)(w[7]);
-    t_float *bout = (t_float *)(w[8]);
-    t_float *nout = (t_float *)(w[9]);
-    float band = x->x_band;
-    float low = x->x_low;
-    while(n--){
-        float c1, c2;
-        float r = (1. - rin0) * SVFILTER_QSTRETCH;  /* CHECKED */
-        if (r < SVFILTER_MINR)
-            r = SVFILTER_MINR;
-        else if (r > SVFILTER_MAXR)
-            r = SVFILTER_MAXR;
-        c2 = r * r;
-        
-        float omega = fin0 * x->x_srcoef;
-        if (omega < SVFILTER_MINOMEGA)
-            omega = SVFILTER_MINOMEGA;
-        else if (omega > SVFILTER_MAXOMEGA)
-            omega = SVFILTER_MAXOMEGA;
-        c1 = sinf(omega);
-        
-        float high, xn = *xin++;
-        *lout++ = low = low + c1 * band;
-        *hout++ = high = xn - low - c2 * band;
-        *bout++ = band = c1 * high + band;
-        *nout++ = low + high;
-        band -= band * band * band * SVFILTER_DRIVE;
+    int ch2 = (int)(w[3]);
+    int ch3 = (int)(w[4]);
+    t_float *xin = (t_float *)(w[5]);
+    t_float *fin = (t_float *)(w[6]);
+    t_float *rin = (t_float *)(w[7]);
+    t_float *lout = (t_float *)(w[8]);
+    t_float *hout = (t_float *)(w[9]);
+    t_float *bout = (t_float *)(w[10]);
+    t_float *nout = (t_float *)(w[11]);
+    int chs = x->x_nchans;
+    // all coefficients first, as the outputs may share memory with the inputs
+    for(int j = 0; j < chs; j++)
+        svfilter_coefs(x, fin[ch2 == 1 ? 0 : j*n], rin[ch3 == 1 ? 0 : j*n],
+            &x->x_c1[j], &x->x_c2[j]);
+    for(int j = 0; j < chs; j += SVFILTER_LANES){
+        int nl = chs - j < SVFILTER_LANES ? chs - j : SVFILTER_LANES;
+        svfilter_lanes(x->x_band + j, x->x_low + j, x->x_c1 + j, x->x_c2 + j,
+            nl, xin + j*n, lout + j*n, hout + j*n, bout + j*n, nout + j*n, n);
     }
-    x->x_band = (PD_BIGORSMALL(band) ? 0. : band);
-    x->x_low = (PD_BIGORSMALL(low) ? 0. : low);
-    return(w + 10);
+    return(w + 12);
 }
 
 static void svfilter_dsp(t_svfilter *x, t_signal **sp){
     x->x_srcoef = TWO_PI / sp[0]->s_sr;
+    int chs = sp[0]->s_nchans, ch2 = sp[1]->s_nchans, ch3 = sp[2]->s_nchans;
+    int n = sp[0]->s_n;
+    for(int i = 3; i < 7; i++)
+        signal_setmultiout(&sp[i], chs);
+    if(x->x_nchans != chs){
+        x->x_band = (float *)resizebytes(x->x_band,
+            x->x_nchans * sizeof(float), chs * sizeof(float));
+        x->x_low = (float *)resizebytes(x->x_low,
+            x->x_nchans * sizeof(float), chs * sizeof(float));
+        x->x_c1 = (float *)resizebytes(x->x_c1,
+            x->x_nchans * sizeof(float), chs * sizeof(float));
+        x->x_c2 = (float *)resizebytes(x->x_c2,
+            x->x_nchans * sizeof(float), chs * sizeof(float));
+        x->x_nchans = chs;
+    }
     svfilter_clear(x);
-    dsp_add(svfilter_perform, 9, x, sp[0]->s_n,
-	    sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec, sp[3]->s_vec,
-	    sp[4]->s_vec, sp[5]->s_vec, sp[6]->s_vec);
+    if((ch2 > 1 && ch2 != chs) || (ch3 > 1 && ch3 != chs)){
+        for(int i = 3; i < 7; i++)
+            dsp_add_zero(sp[i]->s_vec, chs*n);
+        pd_error(x, "[svfilter~]: channel sizes mismatch");
+    }
+    else
+        dsp_add(svfilter_perform, 11, x, n, ch2, ch3,
+            sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec, sp[3]->s_vec,
+            sp[4]->s_vec, sp[5]->s_vec, sp[6]->s_vec);
+}
+
+static void svfilter_free(t_svfilter *x){
+    freebytes(x->x_band, x->x_nchans * sizeof(float));
+    freebytes(x->x_low, x->x_nchans * sizeof(float));
+    freebytes(x->x_c1, x->x_nchans * sizeof(float));
+    freebytes(x->x_c2, x->x_nchans * sizeof(float));
 }
 
 static void *svfilter_new(t_symbol *s, int ac, t_atom *av){
@@ -98,6 +156,11 @@ static void *svfilter_new(t_symbol *s, int ac, t_atom *av){
             qcoef = av->a_w.w_float;
     }
     x->x_srcoef = M_PI / sys_getsr();
+    x->x_nchans = 1;
+    x->x_band = (float *)getbytes(sizeof(float));
+    x->x_low = (float *)getbytes(sizeof(float));
+    x->x_c1 = (float *)getbytes(sizeof(float));
+    x->x_c2 = (float *)getbytes(sizeof(float));
     x->x_freq_inlet = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
     pd_float((t_pd *)x->x_freq_inlet, freq);
     x->x_q_inlet = inlet_new((t_object *)x, (t_pd *)x, &s_signal, &s_signal);
@@ -112,7 +175,8 @@ static void *svfilter_new(t_symbol *s, int ac, t_atom *av){
 
 void svfilter_tilde_setup(void){
     svfilter_class = class_new(gensym("svfilter~"),
-        (t_newmethod)svfilter_new, 0, sizeof(t_svfilter), 0, A_GIMME, 0);
+        (t_newmethod)svfilter_new, (t_method)svfilter_free, sizeof(t_svfilter),
+        CLASS_MULTICHANNEL, A_GIMME, 0);
     class_addmethod(svfilter_class, nullfn, gensym("signal"), 0);
     class_addmethod(svfilter_class, (t_method)svfilter_dsp, gensym("dsp"), A_CANT, 0);
     class_addmethod(svfilter_class, (t_method)svfilter_clear, gensym("clear"), 0);
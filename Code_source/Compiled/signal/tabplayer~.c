@@ -3,7 +3,58 @@
 #include "m_pd.h"
 #include "magic.h"
 #include "buffer.h"
+#include "sfile.h"
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+// The 'open' message plays a sound file straight from disk instead of an
+// array. A worker thread decodes it into a small cache of fixed size chunks
+// around the play head (and around the loop point, for seamless loops and
+// crossfades), so memory use doesn't depend on the length of the file.
+// When the head gets to a chunk that's not in yet, we output zeros.
+
+#define STREAM_CHUNK    16384   // frames per cache slot
+#define STREAM_SLOTS    16
+#define SLOT_FRAMES     (STREAM_CHUNK+3) // plus the interpolation points around it
+#define STREAM_WAIT     10      // ms, when not woken by the perform routine
+
+#define ring_load(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ring_store(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+typedef struct _streamreq{          // what the worker should keep around
+    double      r_head;
+    int         r_chunk;            // chunk of the head
+    int         r_dir;
+    long long   r_start;
+    long long   r_end;
+    long long   r_fade;
+    int         r_loop;
+    int         r_xfade;
+}t_streamreq;
+
+typedef struct _stream{
+    pthread_t       s_thread;
+    pthread_mutex_t s_mutex;
+    pthread_cond_t  s_cond;
+    int             s_quit;
+    int             s_nstore;       // channels in each slot
+    t_sample       *s_data;
+    int             s_tag[STREAM_SLOTS]; // chunk in each slot, -1 if none
+    unsigned int    s_seq[STREAM_SLOTS]; // odd while the worker writes a slot
+    int             s_last;         // slot of the last lookup
+    unsigned int    s_gen;          // bumped when the file changes
+    FILE           *s_fp;           // owned by the worker
+    t_sfinfo        s_info;
+    FILE           *s_newfp;        // handed over by 'open'
+    t_sfinfo        s_newinfo;
+    int             s_swap;
+    t_streamreq     s_req;          // guarded by the mutex
+    t_streamreq     s_sent;         // last request, perform routine only
+    unsigned char  *s_raw;          // worker's read buffer
+    size_t          s_rawsize;
+}t_stream;
 
 typedef struct _tabplayer{
     t_object    x_obj;
@@ -39,6 +90,10 @@ typedef struct _tabplayer{
     int         x_playing;          // if playing
     int         x_playnew;          // if started playing this particular block
     int         x_n_ch;
+    int         x_stream;           // playing from a file
+    int         x_stream_ch;        // channels we get from it
+    float       x_tab_sr_khz;       // array's sample rate, back with 'set'
+    t_stream   *x_st;
     t_float    *x_ivec;             // input vector
     t_float   **x_ovecs;            // output vectors
     t_outlet   *x_donelet;
@@ -46,6 +101,252 @@ typedef struct _tabplayer{
 
 static t_class *tabplayer_class;
 
+// --------------------------- the disk worker ---------------------------
+
+static int tabplayer_stream_add(int *list, int n, long long frame, int nchunks){
+    if(frame < 0 || n == STREAM_SLOTS)
+        return(n);
+    int c = (int)(frame / STREAM_CHUNK);
+    if(c >= nchunks)
+        return(n);
+    for(int i = 0; i < n; i++)
+        if(list[i] == c)
+            return(n);
+    list[n] = c;
+    return(n + 1);
+}
+
+// where the loop wraps to, or where the crossfade reads from
+static long long tabplayer_stream_xpos(t_streamreq *r, long long head, int dir){
+    if(!r->r_loop)
+        return(-1);
+    if(r->r_xfade && r->r_fade > 0){
+        if(dir > 0)
+            return(head > r->r_end - r->r_fade ?
+                head - r->r_end + r->r_start : r->r_start - r->r_fade);
+        else
+            return(head < r->r_start + r->r_fade ?
+                head - r->r_start + r->r_end : r->r_end + r->r_fade);
+    }
+    return(dir > 0 ? r->r_start : r->r_end);
+}
+
+// chunks to keep, most urgent first: the head, the loop point, and then
+// whatever comes after them
+static int tabplayer_stream_wanted(t_streamreq *r, long long nframes, int *list){
+    int n = 0, nchunks = (int)((nframes + STREAM_CHUNK - 1) / STREAM_CHUNK);
+    long long head = (long long)r->r_head;
+    long long xpos = tabplayer_stream_xpos(r, head, r->r_dir);
+    n = tabplayer_stream_add(list, n, head, nchunks);
+    n = tabplayer_stream_add(list, n, xpos, nchunks);
+    for(int k = 1; k < STREAM_SLOTS; k++){
+        long long ahead = head + (long long)r->r_dir * k * STREAM_CHUNK;
+        if(r->r_dir > 0 ? ahead <= r->r_end + STREAM_CHUNK : ahead >= r->r_start - STREAM_CHUNK)
+            n = tabplayer_stream_add(list, n, ahead, nchunks);
+        if(k == 1){ // in case we turn around
+            n = tabplayer_stream_add(list, n, head - (long long)r->r_dir * STREAM_CHUNK, nchunks);
+            n = tabplayer_stream_add(list, n, tabplayer_stream_xpos(r, head, -r->r_dir), nchunks);
+        }
+        if(k <= 2 && xpos >= 0)
+            n = tabplayer_stream_add(list, n, xpos + (long long)r->r_dir * k * STREAM_CHUNK, nchunks);
+    }
+    return(n);
+}
+
+// decode a chunk and a frame before and 2 after it, zeros past the file
+static void tabplayer_stream_read(t_stream *st, int c, t_sample *slot){
+    t_sfinfo *info = &st->s_info;
+    long long first = (long long)c * STREAM_CHUNK - 1;
+    int framesize = info->i_nchans * info->i_bytes;
+    int skip = first < 0 ? 1 : 0, ch, i;
+    if((size_t)(SLOT_FRAMES * framesize) > st->s_rawsize){
+        st->s_raw = resizebytes(st->s_raw, st->s_rawsize, SLOT_FRAMES * framesize);
+        st->s_rawsize = SLOT_FRAMES * framesize;
+    }
+    int got = (int)sfile_read(st->s_fp, info, first + skip, SLOT_FRAMES - skip, st->s_raw);
+    int nch = info->i_nchans < st->s_nstore ? info->i_nchans : st->s_nstore;
+    for(ch = 0; ch < nch; ch++){
+        t_sample *out = slot + ch * SLOT_FRAMES;
+        unsigned char *p = st->s_raw + ch * info->i_bytes;
+        for(i = 0; i < skip; i++)
+            *out++ = 0;
+        for(i = 0; i < got; i++, p += framesize)
+            *out++ = sfile_decode(p, info);
+        for(i += skip; i < SLOT_FRAMES; i++)
+            *out++ = 0;
+    }
+}
+
+static void *tabplayer_stream_worker(void *arg){
+    t_stream *st = (t_stream *)arg;
+    int wanted[STREAM_SLOTS];
+    pthread_mutex_lock(&st->s_mutex);
+    while(!st->s_quit){
+        if(st->s_swap){
+            if(st->s_fp)
+                fclose(st->s_fp);
+            st->s_fp = st->s_newfp, st->s_info = st->s_newinfo;
+            st->s_newfp = NULL, st->s_swap = 0;
+        }
+        int c = -1, slot = -1, i, j;
+        if(st->s_fp){
+            int n = tabplayer_stream_wanted(&st->s_req, st->s_info.i_nframes, wanted);
+            for(i = 0; i < n && c < 0; i++){
+                for(j = 0; j < STREAM_SLOTS && st->s_tag[j] != wanted[i]; j++)
+                    ;
+                if(j == STREAM_SLOTS)
+                    c = wanted[i];
+            }
+            for(j = 0; c >= 0 && j < STREAM_SLOTS && slot < 0; j++){ // a slot we don't need
+                for(i = 0; i < n && st->s_tag[j] != wanted[i]; i++)
+                    ;
+                if(i == n)
+                    slot = j;
+            }
+        }
+        if(slot < 0){
+            struct timeval now;
+            struct timespec until;
+            gettimeofday(&now, NULL);
+            until.tv_sec = now.tv_sec;
+            until.tv_nsec = now.tv_usec * 1000 + STREAM_WAIT * 1000000;
+            if(until.tv_nsec >= 1000000000)
+                until.tv_sec++, until.tv_nsec -= 1000000000;
+            pthread_cond_timedwait(&st->s_cond, &st->s_mutex, &until);
+            continue;
+        }
+        unsigned int gen = st->s_gen;
+        ring_store(&st->s_tag[slot], -1);
+        __atomic_fetch_add(&st->s_seq[slot], 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        pthread_mutex_unlock(&st->s_mutex);
+        tabplayer_stream_read(st, c, st->s_data + (size_t)slot * st->s_nstore * SLOT_FRAMES);
+        pthread_mutex_lock(&st->s_mutex);
+        __atomic_fetch_add(&st->s_seq[slot], 1, __ATOMIC_RELEASE);
+        if(gen == st->s_gen) // or else 'open' came in meanwhile
+            ring_store(&st->s_tag[slot], c);
+    }
+    pthread_mutex_unlock(&st->s_mutex);
+    return(NULL);
+}
+
+// hand a new file (or none) over to the worker
+static void tabplayer_stream_swap(t_stream *st, FILE *fp, t_sfinfo *info){
+    pthread_mutex_lock(&st->s_mutex);
+    if(st->s_newfp) // never got to the worker
+        fclose(st->s_newfp);
+    st->s_newfp = fp;
+    if(info)
+        st->s_newinfo = *info;
+    st->s_swap = 1;
+    st->s_gen++;
+    for(int i = 0; i < STREAM_SLOTS; i++)
+        ring_store(&st->s_tag[i], -1);
+    st->s_sent.r_chunk = -1; // so it's sent again
+    pthread_cond_signal(&st->s_cond);
+    pthread_mutex_unlock(&st->s_mutex);
+}
+
+static void tabplayer_stream_free(t_stream *st){
+    pthread_mutex_lock(&st->s_mutex);
+    st->s_quit = 1;
+    pthread_cond_signal(&st->s_cond);
+    pthread_mutex_unlock(&st->s_mutex);
+    pthread_join(st->s_thread, NULL);
+    pthread_cond_destroy(&st->s_cond);
+    pthread_mutex_destroy(&st->s_mutex);
+    if(st->s_fp)
+        fclose(st->s_fp);
+    if(st->s_newfp)
+        fclose(st->s_newfp);
+    freebytes(st->s_raw, st->s_rawsize);
+    freebytes(st->s_data, STREAM_SLOTS * st->s_nstore * SLOT_FRAMES * sizeof(t_sample));
+    freebytes(st, sizeof(*st));
+}
+
+static t_stream *tabplayer_stream_new(int nstore){
+    t_stream *st = (t_stream *)getbytes(sizeof(*st));
+    st->s_nstore = nstore;
+    st->s_data = (t_sample *)getbytes(STREAM_SLOTS * nstore * SLOT_FRAMES * sizeof(t_sample));
+    for(int i = 0; i < STREAM_SLOTS; i++)
+        st->s_tag[i] = -1;
+    st->s_sent.r_chunk = -1;
+    pthread_mutex_init(&st->s_mutex, NULL);
+    pthread_cond_init(&st->s_cond, NULL);
+    if(pthread_create(&st->s_thread, NULL, tabplayer_stream_worker, st) != 0){
+        pthread_cond_destroy(&st->s_cond);
+        pthread_mutex_destroy(&st->s_mutex);
+        freebytes(st->s_data, STREAM_SLOTS * nstore * SLOT_FRAMES * sizeof(t_sample));
+        freebytes(st, sizeof(*st));
+        return(NULL);
+    }
+    return(st);
+}
+
+// copies the frame before 'ndx', 'ndx' itself and 2 after it in channel 'ch'
+// to 'vp', 0 if they're not in yet or the worker took the slot over meanwhile
+static int tabplayer_stream_get(t_stream *st, long long ndx, int ch, t_sample *vp){
+    int c = (int)(ndx / STREAM_CHUNK), s = st->s_last;
+    if(ring_load(&st->s_tag[s]) != c){
+        for(s = 0; s < STREAM_SLOTS && ring_load(&st->s_tag[s]) != c; s++)
+            ;
+        if(s == STREAM_SLOTS)
+            return(0);
+        st->s_last = s;
+    }
+    unsigned int seq = ring_load(&st->s_seq[s]);
+    if((seq & 1) || ring_load(&st->s_tag[s]) != c)
+        return(0);
+    t_sample *p = st->s_data + ((size_t)s * st->s_nstore + ch) * SLOT_FRAMES
+        + (ndx - (long long)c * STREAM_CHUNK);
+    for(int i = 0; i < 4; i++)
+        vp[i] = p[i];
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return(__atomic_load_n(&st->s_seq[s], __ATOMIC_RELAXED) == seq);
+}
+
+// ---------------------------------------------------------------------
+
+// tell the worker where we are, if that changed and it isn't busy
+static void tabplayer_stream_request(t_play *x){
+    t_stream *st = x->x_st;
+    t_streamreq r, *sent = &st->s_sent;
+    r.r_head = x->x_playing || x->x_position ? x->x_phase :
+        x->x_isneg ? (double)x->x_end : (double)x->x_start;
+    if(r.r_head < 0)
+        r.r_head = 0;
+    r.r_chunk = (int)(r.r_head / STREAM_CHUNK);
+    r.r_dir = x->x_isneg ? -1 : 1;
+    r.r_start = x->x_start;
+    r.r_end = x->x_end;
+    r.r_fade = x->x_fadesamp;
+    r.r_loop = x->x_loop;
+    r.r_xfade = x->x_xfade;
+    if(r.r_chunk == sent->r_chunk && r.r_dir == sent->r_dir && r.r_start == sent->r_start
+    && r.r_end == sent->r_end && r.r_fade == sent->r_fade && r.r_loop == sent->r_loop
+    && r.r_xfade == sent->r_xfade)
+        return;
+    if(pthread_mutex_trylock(&st->s_mutex) == 0){ // never wait for the worker
+        st->s_req = *sent = r;
+        pthread_cond_signal(&st->s_cond);
+        pthread_mutex_unlock(&st->s_mutex);
+    }
+}
+
+static double tabplayer_stream_interp(t_play *x, int ch, double phase){
+    if(ch >= x->x_stream_ch || phase < 0 || phase >= x->x_npts)
+        return(0);
+    long long ndx = (long long)phase;
+    t_sample vp[4];
+    if(!tabplayer_stream_get(x->x_st, ndx, ch, vp))
+        return(0);
+    double f = phase - ndx;
+    if(x->x_interp)
+        return(interp_lagrange(f, vp[0], vp[1], vp[2], vp[3]));
+    else
+        return(interp_spline(f, vp[0], vp[1], vp[2], vp[3]));
+}
+
 static void tabplayer_fade_check(t_play *x, t_floatarg f){
     x->x_fadesamp  = (unsigned long long)(f * x->x_array_sr_khz);
     if(x->x_fadesamp > (x->x_rangesamp / 2))
@@ -113,6 +414,8 @@ static void tabplayer_arraysr(t_play *x, t_floatarg f){
     x->x_array_sr_khz = f * 0.001;
     if(x->x_array_sr_khz < 8)
         x->x_array_sr_khz = 8;
+    if(!x->x_stream)
+        x->x_tab_sr_khz = x->x_array_sr_khz;
     x->x_sr_ratio = x->x_array_sr_khz/x->x_sr_khz;
     x->x_start = tabplayer_ms2samp(x, x->x_start);
     x->x_end = tabplayer_ms2samp(x, x->x_end);
@@ -121,11 +424,49 @@ static void tabplayer_arraysr(t_play *x, t_floatarg f){
 }
 
 static void tabplayer_set(t_play *x, t_symbol *s){
+    if(x->x_stream){ // back to arrays
+        tabplayer_stream_swap(x->x_st, NULL, NULL);
+        x->x_stream = 0;
+        x->x_array_sr_khz = x->x_tab_sr_khz;
+        x->x_sr_ratio = x->x_array_sr_khz/x->x_sr_khz;
+    }
     buffer_setarray(x->x_buffer, s);
     x->x_npts = x->x_buffer->c_npts;
     tabplayer_range(x, x->x_range_start, x->x_range_end);
 }
 
+static void tabplayer_open(t_play *x, t_symbol *s){
+    char path[MAXPDSTRING], *bufptr;
+    t_sfinfo info;
+    FILE *fp = NULL;
+    int fd = canvas_open(x->x_glist, s->s_name, "", path, &bufptr, MAXPDSTRING, 1);
+    if(fd < 0){
+        pd_error(x, "[tabplayer~]: can't find file '%s'", s->s_name);
+        return;
+    }
+    path[strlen(path)]='/';
+    sys_close(fd);
+    if(!(fp = sys_fopen(path, "rb")) || !sfile_readheader(fp, &info)){
+        if(fp)
+            fclose(fp);
+        pd_error(x, "[tabplayer~]: '%s': unknown or bad sound file format", s->s_name);
+        return;
+    }
+    if(!x->x_st && !(x->x_st = tabplayer_stream_new(x->x_n_ch))){
+        fclose(fp);
+        pd_error(x, "[tabplayer~]: can't start disk thread");
+        return;
+    }
+    tabplayer_stream_swap(x->x_st, fp, &info);
+    x->x_stream = 1;
+    x->x_stream_ch = info.i_nchans < x->x_n_ch ? info.i_nchans : x->x_n_ch;
+    x->x_npts = info.i_nframes;
+    if(info.i_sr >= 1)
+        x->x_array_sr_khz = info.i_sr * 0.001;
+    x->x_sr_ratio = x->x_array_sr_khz/x->x_sr_khz;
+    tabplayer_range(x, x->x_range_start, x->x_range_end);
+}
+
 static void tabplayer_pos(t_play *x, t_floatarg f){
     x->x_position = 1;
     double position = f < 0 ? 0 : f > 1 ? 1 : (double)f;
@@ -245,10 +586,12 @@ static double tabplayer_fade_gain(t_play *x, double phase){
 }
 
 static double tabplayer_interp(t_play *x, int ch, double phase){
+    if(x->x_stream)
+        return(tabplayer_stream_interp(x, ch, phase));
     double out = 0.;
-    t_word **vectable = x->x_buffer->c_vectors; // ??
-    t_word *vp = vectable[ch]; // ??
-    if(vp){
+    t_word *vp = x->x_buffer->c_vectors[ch];
+    float *fp = x->x_buffer->c_fvectors[ch]; // from a [sample.store]
+    if(vp || fp){
         float f;
         int maxindex = x->x_npts - 3;
         if(phase < 0 || phase > maxindex)
@@ -264,11 +607,18 @@ static double tabplayer_interp(t_play *x, int ch, double phase){
         }
         else
             f = phase - ndx;
-        vp += ndx;
-        double a = vp[-1].w_float;
-        double b = vp[0].w_float;
-        double c = vp[1].w_float;
-        double d = vp[2].w_float;
+        double a, b, c, d;
+        if(fp){
+            fp += ndx;
+            a = fp[-1], b = fp[0], c = fp[1], d = fp[2];
+        }
+        else{
+            vp += ndx;
+            a = vp[-1].w_float;
+            b = vp[0].w_float;
+            c = vp[1].w_float;
+            d = vp[2].w_float;
+        }
         if(x->x_interp)
             out = interp_lagrange(f, a, b, c, d);
         else
@@ -284,7 +634,7 @@ static t_int *tabplayer_perform(t_int *w){
     int ch, i;
     t_float *xin = x->x_ivec;
     float last_sig_input = x->x_lastin;
-    if(buffer->c_playable){
+    if(x->x_stream || buffer->c_playable){
         if(x->x_hasfeeders){ // signal input present
             for(i = 0; i < n; i++){
                 float sig_input = *xin++;
@@ -445,12 +795,17 @@ static t_int *tabplayer_perform(t_int *w){
             };
     };
     x->x_lastin = last_sig_input;
+    if(x->x_stream)
+        tabplayer_stream_request(x);
     return(w+3);
 }
 
 static void tabplayer_dsp(t_play *x, t_signal **sp){
-    buffer_checkdsp(x->x_buffer);
-    unsigned long long npts = x->x_buffer->c_npts;
+    unsigned long long npts = x->x_npts;
+    if(!x->x_stream){
+        buffer_checkdsp(x->x_buffer);
+        npts = x->x_buffer->c_npts;
+    }
     x->x_hasfeeders = else_magic_inlet_connection((t_object *)x, x->x_glist, 0, &s_signal);
     t_float pdksr = sp[0]->s_sr * 0.001;
     if(x->x_sr_khz != pdksr)
@@ -468,6 +823,8 @@ static void tabplayer_dsp(t_play *x, t_signal **sp){
 
 static void *tabplayer_free(t_play *x){
     buffer_free(x->x_buffer);
+    if(x->x_st)
+        tabplayer_stream_free(x->x_st);
     freebytes(x->x_ovecs, x->x_n_ch * sizeof(*x->x_ovecs));
     outlet_free(x->x_donelet);
     return(void *)x;
@@ -544,6 +901,9 @@ static void *tabplayer_new(t_symbol * s, int ac, t_atom *av){
         }
     };
     x->x_sr_ratio = x->x_array_sr_khz/x->x_sr_khz;
+    x->x_tab_sr_khz = x->x_array_sr_khz;
+    x->x_stream = x->x_stream_ch = 0;
+    x->x_st = NULL;
     x->x_isneg = (int)(x->x_rate < 0);
     // one auxiliary signal:  position input
     int chn_n = (int)channels > 64 ? 64 : (int)channels;
@@ -577,6 +937,7 @@ void tabplayer_tilde_setup(void){
     class_addfloat(tabplayer_class, tabplayer_float);
     class_addmethod(tabplayer_class, (t_method)tabplayer_dsp, gensym("dsp"), A_CANT, 0);
     class_addmethod(tabplayer_class, (t_method)tabplayer_set, gensym("set"), A_SYMBOL, 0);
+    class_addmethod(tabplayer_class, (t_method)tabplayer_open, gensym("open"), A_SYMBOL, 0);
     class_addmethod(tabplayer_class, (t_method)tabplayer_pos, gensym("pos"), A_FLOAT, 0);
     class_addmethod(tabplayer_class, (t_method)tabplayer_play, gensym("play"), A_GIMME, 0);
     class_addmethod(tabplayer_class, (t_method)tabplayer_lagrange, gensym("lagrange"), 0);
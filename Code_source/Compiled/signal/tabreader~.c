@@ -72,6 +72,7 @@ static t_int *tabreader_perform(t_int *w){
     t_buffer *buf = x->x_buffer;
     int npts = x->x_loop ? buf->c_npts : buf->c_npts - 1;
     t_word *vp = buf->c_vectors[0];
+    float *fp = buf->c_fvectors[0];
     while(nblock--){
         if(buf->c_playable){ // ????
             double index = (double)(*in++);
@@ -96,14 +97,14 @@ static t_int *tabreader_perform(t_int *w){
                 if(ndx2 >= npts)
                     ndx2 = x->x_loop ? ndx2 - npts : npts;
             }
-            if(vp){
+            if(vp || fp){
                 double a = 0, b = 0, c = 0, d = 0;
-                b = (double)vp[ndx].w_float;
+                b = buffer_sample(vp, fp, ndx);
                 if(x->x_i_mode){
-                    c = (double)vp[ndx1].w_float;
+                    c = buffer_sample(vp, fp, ndx1);
                     if(x->x_i_mode > 2){
-                        a = (double)vp[ndxm1].w_float;
-                        d = (double)vp[ndx2].w_float;
+                        a = buffer_sample(vp, fp, ndxm1);
+                        d = buffer_sample(vp, fp, ndx2);
                     }
                 }
                 switch(x->x_i_mode){
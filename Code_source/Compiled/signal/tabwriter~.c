@@ -145,8 +145,11 @@ static t_int *tabwriter_perform(t_int *w){
             if(x->x_isrunning == 1){ // if we're still running after boundschecking
                 for(j = 0; j < nch; j++){
                     t_word *vp = c->c_vectors[j];
+                    float *fp = c->c_fvectors[j];
                     t_float *insig = x->x_ivecs[j];
-                    if(vp)
+                    if(fp)
+                        fp[phase] = insig[i];
+                    else if(vp)
                         vp[phase].w_float = insig[i];
                 };
                 index = phase;
@@ -3,14 +3,30 @@
 #include "m_pd.h"
 #include "magic.h"
 #include "buffer.h"
+#include <stdint.h>
+#include <string.h>
+
+#define MAXLEVELS       24          // band limited copies of the table
+#define MAXMIPMAP       (1 << 20)   // largest table we make them for
 
 static t_class *wavetable_class;
 
+typedef struct _level{
+    float    *l_data;       // l_size points plus 1 guard point before and 3 after
+    int       l_size;
+    double    l_maxstep;    // highest phase step it plays without aliasing
+}t_level;
+
 typedef struct _wavetable{
     t_object  x_obj;
     t_buffer *x_buffer;
-    double    x_phase;
-    double    x_last_phase_offset;
+    double   *x_phase;
+    double   *x_last_phase_offset;
+    int      *x_dir;                // soft sync direction
+    int       x_nchans;
+    int       x_n;
+    double   *x_step;               // scratch, one block
+    double   *x_ph;                 // scratch, one block
     t_float   x_freq;
     t_inlet  *x_inlet_phase;
     t_inlet  *x_inlet_sync;
@@ -21,6 +37,16 @@ typedef struct _wavetable{
     t_float   x_offset;
     t_float   x_size;
     t_int     x_interp;
+// MIPMAPS:
+    int       x_mipmap;
+    t_level   x_levels[MAXLEVELS];
+    int       x_nlevels;
+    float    *x_mmbuf;
+    int       x_mmbufsize;
+    void     *x_mm_vec;             // what the levels were made from
+    int       x_mm_npts;
+    int       x_mm_size;
+    int       x_mm_offset;
 // MAGIC:
     t_glist  *x_glist;              // object list
     t_float  *x_signalscalar;       // right inlet's float field
@@ -28,17 +54,21 @@ typedef struct _wavetable{
     t_float   x_phase_sync_float;   // float from magic
 }t_wavetable;
 
-#define INDEX_2PT() \
+// table points from an array or from a [sample.store]
+#define WORD_POINT(i)   (double)vector[i].w_float
+#define FLOAT_POINT(i)  (double)fvector[i]
+
+#define INDEX_2PT(point) \
     double xpos = phase*(double)size; \
     int ndx = (int)xpos; \
     double frac = xpos - ndx; \
     if(ndx == size) ndx = 0; \
     int ndx1 = ndx + 1; \
     if(ndx1 == size) ndx1 = 0; \
-    double b = (double)vector[ndx + offset].w_float; \
-    double c = (double)vector[ndx1 + offset].w_float;
+    double b = point(ndx + offset); \
+    double c = point(ndx1 + offset);
 
-#define INDEX_4PT() \
+#define INDEX_4PT(point) \
     double xpos = phase*(double)size; \
     int ndx = (int)xpos; \
     double frac = xpos - ndx; \
@@ -49,21 +79,151 @@ typedef struct _wavetable{
     if(ndx1 == size) ndx1 = 0; \
     int ndx2 = ndx1 + 1; \
     if(ndx2 == size) ndx2 = 0; \
-    double a = (double)vector[ndxm1 + offset].w_float; \
-    double b = (double)vector[ndx + offset].w_float; \
-    double c = (double)vector[ndx1 + offset].w_float; \
-    double d = (double)vector[ndx2 + offset].w_float;
+    double a = point(ndxm1 + offset); \
+    double b = point(ndx + offset); \
+    double c = point(ndx1 + offset); \
+    double d = point(ndx2 + offset);
+
+// same, from a mipmap level, whose guard points spare the wrapping:
+// p[0] to p[3] are the points at ndx-1 to ndx+2
+#define LEVEL_INDEX() \
+    double xpos = phase*(double)l->l_size; \
+    int ndx = (int)xpos; \
+    double frac = xpos - ndx; \
+    float *p = l->l_data + ndx; \
+    (void)frac;
+
+// 440 * 2^((m-69)/12) with an exponent split and a polynomial
+// for 2^f in [-0.5, 0.5], good to about 0.006 cents
+static inline double wavetable_mtof(double m){
+    double x = (m - 69) * (1./12.);
+    x = x < -60 ? -60 : x > 60 ? 60 : x;
+    double i = (double)(int)(x + (x < 0 ? -0.5 : 0.5));
+    double f = (x - i) * 0.69314718055994531;
+    double p = 1 + f*(1 + f*(0.5 + f*(1./6. + f*(1./24. + f*(1./120.)))));
+    union{double d; int64_t i;}e;
+    e.i = (int64_t)((int)i + 1023) << 52;
+    return(440 * p * e.d);
+}
+
+// table region in use, -1 if it's not playable
+static int wavetable_region(t_wavetable *x, int npts, int *offset){
+    if(npts < 4) // minimum table size is 4 points.
+        return(-1);
+    int size = x->x_size > npts ? npts : x->x_size < 0 ? npts : x->x_size;
+    if(size < 4)
+        size = 4;
+    *offset = x->x_offset;
+    if((*offset + size) > npts)
+        *offset = npts - size;
+    if(*offset < 0)
+        *offset = 0;
+    return(size);
+}
+
+static void wavetable_level(t_level *l, float *data, int size, double maxstep){
+    l->l_data = data;
+    l->l_size = size;
+    l->l_maxstep = maxstep;
+    data[0] = data[size];
+    data[size+1] = data[1];
+    data[size+2] = data[2];
+    data[size+3] = data[3];
+}
+
+// Level 0 is a copy of the table region. The others halve the size and the
+// number of harmonics from a power of 2 resampling of it (if it isn't
+// already one), down to a single sinusoid over 8 points. They only hold
+// harmonics up to a quarter of their size, so that interpolating them
+// doesn't add images of their own.
+static void wavetable_mipmap_build(t_wavetable *x){
+    if(x->x_mmbuf){
+        freebytes(x->x_mmbuf, x->x_mmbufsize * sizeof(float));
+        x->x_mmbuf = NULL, x->x_mmbufsize = 0;
+    }
+    x->x_nlevels = 0;
+    x->x_mm_vec = NULL;
+    t_buffer *b = x->x_buffer;
+    if(!x->x_mipmap || !b->c_playable || (!b->c_vectors[0] && !b->c_fvectors[0]))
+        return;
+    int offset, npts = b->c_npts, size = wavetable_region(x, npts, &offset);
+    if(size < 0)
+        return;
+    if(size > MAXMIPMAP){
+        pd_error(x, "[wavetable~]: table too large for mipmaps");
+        return;
+    }
+    int fftsize = 8;
+    while(fftsize < size)
+        fftsize *= 2;
+    int total = size + 4, nlevels = 1;
+    for(int n = fftsize; n >= 8 && nlevels < MAXLEVELS; n /= 2, nlevels++)
+        total += n + 4;
+    x->x_mmbuf = (float *)getbytes(total * sizeof(float));
+    x->x_mmbufsize = total;
+    t_word *vector = b->c_vectors[0];
+    float *fvector = b->c_fvectors[0], *data = x->x_mmbuf;
+    for(int i = 0; i < size; i++)
+        data[i+1] = fvector ? fvector[i + offset] : vector[i + offset].w_float;
+    wavetable_level(&x->x_levels[0], data, size, 1. / size);
+    t_sample *real = (t_sample *)getbytes(fftsize * sizeof(t_sample));
+    t_sample *imag = (t_sample *)getbytes(fftsize * sizeof(t_sample));
+    for(int i = 0; i < fftsize; i++){
+        double xpos = (double)i * size / fftsize;
+        int ndx = (int)xpos;
+        double frac = xpos - ndx;
+        real[i] = interp_spline(frac, data[ndx], data[ndx+1], data[ndx+2], data[ndx+3]);
+        imag[i] = 0;
+    }
+    mayer_fft(fftsize, real, imag);
+    t_sample *re = (t_sample *)getbytes(fftsize * sizeof(t_sample));
+    t_sample *im = (t_sample *)getbytes(fftsize * sizeof(t_sample));
+    data += size + 4;
+    for(int k = 1, n = fftsize; k < nlevels; k++, n /= 2){
+        memset(re, 0, n * sizeof(t_sample));
+        memset(im, 0, n * sizeof(t_sample));
+        re[0] = real[0];
+        for(int h = 1; h < n/4; h++){
+            re[h] = real[h], im[h] = imag[h];
+            re[n-h] = real[fftsize-h], im[n-h] = imag[fftsize-h];
+        }
+        mayer_ifft(n, re, im);
+        for(int i = 0; i < n; i++)
+            data[i+1] = re[i] / fftsize;
+        wavetable_level(&x->x_levels[k], data, n, 0.5 / (n/4 - 1));
+        data += n + 4;
+    }
+    freebytes(real, fftsize * sizeof(t_sample));
+    freebytes(imag, fftsize * sizeof(t_sample));
+    freebytes(re, fftsize * sizeof(t_sample));
+    freebytes(im, fftsize * sizeof(t_sample));
+    x->x_nlevels = nlevels;
+    x->x_mm_vec = fvector ? (void *)fvector : (void *)vector;
+    x->x_mm_npts = npts;
+    x->x_mm_size = size;
+    x->x_mm_offset = offset;
+}
 
 static void wavetable_offset(t_wavetable *x, t_float f){
     x->x_offset = f;
+    if(x->x_mipmap)
+        wavetable_mipmap_build(x);
 }
 
 static void wavetable_size(t_wavetable *x, t_float f){
     x->x_size = f;
+    if(x->x_mipmap)
+        wavetable_mipmap_build(x);
 }
 
 static void wavetable_set(t_wavetable *x, t_symbol *s){
     buffer_setarray(x->x_buffer, s);
+    wavetable_mipmap_build(x);
+}
+
+static void wavetable_mipmap(t_wavetable *x, t_floatarg f){
+    x->x_mipmap = (int)(f != 0);
+    wavetable_mipmap_build(x);
 }
 
 static void wavetable_none(t_wavetable *x){
@@ -92,112 +252,234 @@ static void wavetable_midi(t_wavetable *x, t_floatarg f){
 
 static void wavetable_soft(t_wavetable *x, t_floatarg f){
     x->soft = (int)(f != 0);
+    for(int j = 0; j < x->x_nchans; j++)
+        x->x_dir[j] = 1;
+}
+
+// read the table region straight from the array or store
+#define READ_LOOP(point) \
+    switch(x->x_interp){ \
+        case 0: \
+            for(i = 0; i < n; i++){ \
+                int ndx = (int)(ph[i]*(double)size); \
+                if(ndx == size) \
+                    ndx = 0; \
+                out[i] = point(ndx + offset); \
+            } \
+            break; \
+        case 1: \
+            for(i = 0; i < n; i++){ \
+                double phase = ph[i]; \
+                INDEX_2PT(point) \
+                out[i] = interp_lin(frac, b, c); \
+            } \
+            break; \
+        case 2: \
+            for(i = 0; i < n; i++){ \
+                double phase = ph[i]; \
+                INDEX_2PT(point) \
+                out[i] = interp_cos(frac, b, c); \
+            } \
+            break; \
+        case 3: \
+            for(i = 0; i < n; i++){ \
+                double phase = ph[i]; \
+                INDEX_4PT(point) \
+                out[i] = interp_lagrange(frac, a, b, c, d); \
+            } \
+            break; \
+        default: \
+            for(i = 0; i < n; i++){ \
+                double phase = ph[i]; \
+                INDEX_4PT(point) \
+                out[i] = interp_spline(frac, a, b, c, d); \
+            } \
+    }
+
+static void wavetable_read(t_wavetable *x, t_word *vector, float *fvector,
+int size, int offset, double *ph, t_sample *out, int n){
+    int i;
+    if(fvector)
+        READ_LOOP(FLOAT_POINT)
+    else
+        READ_LOOP(WORD_POINT)
+}
+
+// read from the highest resolution level that doesn't alias at each step
+#define MIPMAP_LOOP(interp) \
+    for(int i = 0; i < n; i++){ \
+        double step = st[i] < 0 ? -st[i] : st[i], phase = ph[i]; \
+        while(k < last && step > x->x_levels[k].l_maxstep) \
+            k++; \
+        while(k > 0 && step <= x->x_levels[k-1].l_maxstep) \
+            k--; \
+        t_level *l = &x->x_levels[k]; \
+        LEVEL_INDEX() \
+        out[i] = interp; \
+    }
+
+static void wavetable_read_mipmap(t_wavetable *x, double *st, double *ph,
+t_sample *out, int n){
+    int k = 0, last = x->x_nlevels - 1;
+    switch(x->x_interp){
+        case 0:
+            MIPMAP_LOOP(p[1])
+            break;
+        case 1:
+            MIPMAP_LOOP(interp_lin(frac, p[1], p[2]))
+            break;
+        case 2:
+            MIPMAP_LOOP(interp_cos(frac, p[1], p[2]))
+            break;
+        case 3:
+            MIPMAP_LOOP(interp_lagrange(frac, p[0], p[1], p[2], p[3]))
+            break;
+        default:
+            MIPMAP_LOOP(interp_spline(frac, p[0], p[1], p[2], p[3]))
+    }
 }
 
 static t_int *wavetable_perform(t_int *w){
     t_wavetable *x = (t_wavetable *)(w[1]);
     int n = (t_int)(w[2]);
-    t_float *in1 = (t_float *)(w[3]); // freq
-    t_float *in2 = (t_float *)(w[4]); // sync
-    t_float *in3 = (t_float *)(w[5]); // phase
-    t_float *out = (t_float *)(w[6]);
-    t_word *vector = x->x_buffer->c_vectors[0];
+    int ch2 = (t_int)(w[3]);
+    int ch3 = (t_int)(w[4]);
+    t_float *in1 = (t_float *)(w[5]); // freq
+    t_float *in2 = (t_float *)(w[6]); // sync
+    t_float *in3 = (t_float *)(w[7]); // phase
+    t_float *out = (t_float *)(w[8]);
+    t_buffer *buf = x->x_buffer;
     if(!x->x_hasfeeders){ // Magic
         t_float *scalar = x->x_signalscalar;
         if(!else_magic_isnan(*x->x_signalscalar)){
             t_float input_phase = fmod(*scalar, 1);
             if(input_phase < 0)
                 input_phase += 1;
-            x->x_phase = input_phase;
+            for(int j = 0; j < x->x_nchans; j++)
+                x->x_phase[j] = input_phase;
             else_magic_setnan(x->x_signalscalar);
         }
     }
-    double phase = x->x_phase;
-    double last_phase_offset = x->x_last_phase_offset;
+    t_word *vector = buf->c_vectors[0];
+    float *fvector = buf->c_fvectors[0];
+    int offset = 0, size = -1;
+    if(buf->c_playable && (vector || fvector))
+        size = wavetable_region(x, buf->c_npts, &offset);
+    if(size < 0){
+        memset(out, 0, x->x_nchans * n * sizeof(t_float));
+        return(w+9);
+    }
+    void *table = fvector ? (void *)fvector : (void *)vector;
+    int mipmap = x->x_nlevels && x->x_mm_vec == table && x->x_mm_npts == buf->c_npts
+        && x->x_mm_size == size && x->x_mm_offset == offset;
     double sr = x->x_sr;
-    while(n--){
-        if(x->x_buffer->c_playable){
-            double hz = *in1++;
-            if(x->midi)
-                hz = pow(2, (hz - 69)/12) * 440;
-            double phase_offset = (double)*in3++;
-            double phase_step = hz / sr; // phase_step
-            phase_step = phase_step > 0.5 ? 0.5 : phase_step < -0.5 ? -0.5 : phase_step; // clip nyq
-            if(x->soft)
-                phase_step *= (x->soft);
+    double *st = x->x_step, *ph = x->x_ph;
+    int midi = x->midi, soft = x->soft, feeders = x->x_hasfeeders;
+    for(int j = 0; j < x->x_nchans; j++){
+        t_float *freq = in1 + j*n;
+        t_float *sync = in2 + (ch2 == 1 ? 0 : j*n);
+        t_float *phase_in = in3 + (ch3 == 1 ? 0 : j*n);
+        int i;
+        if(midi) for(i = 0; i < n; i++){
+            double step = wavetable_mtof(freq[i]) / sr;
+            st[i] = step > 0.5 ? 0.5 : step < -0.5 ? -0.5 : step; // clip nyq
+        }
+        else for(i = 0; i < n; i++){
+            double step = freq[i] / sr;
+            st[i] = step > 0.5 ? 0.5 : step < -0.5 ? -0.5 : step; // clip nyq
+        }
+        double phase = x->x_phase[j];
+        double last_phase_offset = x->x_last_phase_offset[j];
+        int dir = x->x_dir[j];
+        for(i = 0; i < n; i++){
+            if(soft)
+                st[i] *= dir;
+            double phase_offset = (double)phase_in[i];
             double phase_dev = phase_offset - last_phase_offset;
             if(phase_dev >= 1 || phase_dev <= -1)
                 phase_dev = fmod(phase_dev, 1); // wrap
-            if(x->x_hasfeeders){ // signal connected, no magic
-                t_float trig = *in2++;
+            if(feeders){ // signal connected, no magic
+                t_float trig = sync[i];
                 if(trig > 0 && trig <= 1){
-                    if(x->soft)
-                        x->soft = x->soft == 1 ? -1 : 1;
+                    if(soft)
+                        dir = -dir;
                     else
                         phase = trig;
                 }
             }
             phase = phase + phase_dev;
-            if(phase <= 0)
-                phase += 1.; // wrap deviated phase
-            if(phase >= 1)
-                phase -= 1.; // wrap deviated phase
-            if(vector){
-                int npts = (t_int)(x->x_buffer->c_npts);
-                if(npts < 4) // minimum table size is 4 points.
-                    *out++ = 0;
-                else{
-                    int size = x->x_size > npts ? npts : x->x_size < 0 ? npts : x->x_size;
-                    if(size < 4)
-                        size = 4;
-                    int offset =  x->x_offset;
-                    if((offset + size) > npts)
-                        offset = npts - size;
-                    if(x->x_interp == 0){
-                        int ndx = (int)(phase*(double)size);
-                        *out++ = (double)vector[ndx].w_float;
-                    }
-                    else if(x->x_interp >= 3){
-                        INDEX_4PT()
-                        if(x->x_interp == 3)
-                            *out++ = interp_lagrange(frac, a, b, c, d);
-                        else
-                            *out++ = interp_spline(frac, a, b, c, d);
-                    }
-                    else{
-                        INDEX_2PT()
-                        *out++ = x->x_interp == 2 ? interp_cos(frac, b, c) : interp_lin(frac, b, c);
-                    }
-                }
+            if(phase < 0 || phase >= 1){ // wrap deviated phase
+                phase -= floor(phase);
+                if(phase >= 1)
+                    phase = 0;
             }
-            else // ??? maybe we dont need "playable"?
-                *out++ = 0;
-            phase += phase_step; // next phase
+            ph[i] = phase;
+            phase += st[i]; // next phase
             last_phase_offset = phase_offset; // last phase offset
         }
+        x->x_phase[j] = phase;
+        x->x_last_phase_offset[j] = last_phase_offset;
+        x->x_dir[j] = dir;
+        if(mipmap)
+            wavetable_read_mipmap(x, st, ph, out + j*n, n);
         else
-            *out++ = 0;
+            wavetable_read(x, vector, fvector, size, offset, ph, out + j*n, n);
     }
-    x->x_phase = phase;
-    x->x_last_phase_offset = last_phase_offset;
-    return(w+7);
+    return(w+9);
 }
 
 static void wavetable_dsp(t_wavetable *x, t_signal **sp){
     buffer_checkdsp(x->x_buffer);
     if(x->x_buffer->c_playable && x->x_buffer->c_npts < 4)
         pd_error(x, "[wavetable~]: table too small, minimum size is 4");
+    if(x->x_mipmap)
+        wavetable_mipmap_build(x);
     x->x_hasfeeders = else_magic_inlet_connection((t_object *)x, x->x_glist, 1, &s_signal);
     x->x_sr = sp[0]->s_sr;
-    dsp_add(wavetable_perform, 6, x, sp[0]->s_n,
-        sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec, sp[3]->s_vec);
+    int chs = sp[0]->s_nchans, ch2 = sp[1]->s_nchans, ch3 = sp[2]->s_nchans, n = sp[0]->s_n;
+    signal_setmultiout(&sp[3], chs);
+    if(x->x_nchans != chs){
+        x->x_phase = (double *)resizebytes(x->x_phase,
+            x->x_nchans * sizeof(double), chs * sizeof(double));
+        x->x_last_phase_offset = (double *)resizebytes(x->x_last_phase_offset,
+            x->x_nchans * sizeof(double), chs * sizeof(double));
+        x->x_dir = (int *)resizebytes(x->x_dir,
+            x->x_nchans * sizeof(int), chs * sizeof(int));
+        for(int j = x->x_nchans; j < chs; j++){
+            x->x_phase[j] = x->x_phase[0];
+            x->x_last_phase_offset[j] = x->x_last_phase_offset[0];
+            x->x_dir[j] = 1;
+        }
+        x->x_nchans = chs;
+    }
+    if(x->x_n != n){
+        x->x_step = (double *)resizebytes(x->x_step,
+            x->x_n * sizeof(double), n * sizeof(double));
+        x->x_ph = (double *)resizebytes(x->x_ph,
+            x->x_n * sizeof(double), n * sizeof(double));
+        x->x_n = n;
+    }
+    if((ch2 > 1 && ch2 != chs) || (ch3 > 1 && ch3 != chs)){
+        dsp_add_zero(sp[3]->s_vec, chs*n);
+        pd_error(x, "[wavetable~]: channel sizes mismatch");
+    }
+    else
+        dsp_add(wavetable_perform, 8, x, n, ch2, ch3,
+            sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec, sp[3]->s_vec);
 }
 
 static void *wavetable_free(t_wavetable *x){
+    x->x_mipmap = 0;
+    wavetable_mipmap_build(x);
     buffer_free(x->x_buffer);
     inlet_free(x->x_inlet_sync);
     inlet_free(x->x_inlet_phase);
     outlet_free(x->x_outlet);
+    freebytes(x->x_phase, x->x_nchans * sizeof(double));
+    freebytes(x->x_last_phase_offset, x->x_nchans * sizeof(double));
+    freebytes(x->x_dir, x->x_nchans * sizeof(int));
+    freebytes(x->x_step, x->x_n * sizeof(double));
+    freebytes(x->x_ph, x->x_n * sizeof(double));
     return(void *)x;
 }
 
@@ -206,7 +488,12 @@ static void *wavetable_new(t_symbol *s, int ac, t_atom *av){
     s = NULL;
     t_symbol *name = NULL;
     int nameset = 0, floatarg = 0;
-    x->x_freq = x->x_phase = x->x_last_phase_offset = 0.;
+    x->x_nchans = 1;
+    x->x_phase = (double *)getbytes(sizeof(double));
+    x->x_last_phase_offset = (double *)getbytes(sizeof(double));
+    x->x_dir = (int *)getbytes(sizeof(int));
+    x->x_dir[0] = 1;
+    x->x_freq = x->x_phase[0] = x->x_last_phase_offset[0] = 0.;
     t_float phaseoff = 0;
     x->x_interp = 4;
     x->x_size = -1;
@@ -260,6 +547,12 @@ static void *wavetable_new(t_symbol *s, int ac, t_atom *av){
                     goto errstate;
                 x->soft = 1;
             }
+            else if(curarg == gensym("-mipmap")){
+                ac--, av++;
+                if(nameset)
+                    goto errstate;
+                x->x_mipmap = 1;
+            }
             else{
                 if(nameset || floatarg)
                     goto errstate;
@@ -290,6 +583,7 @@ static void *wavetable_new(t_symbol *s, int ac, t_atom *av){
     x->x_signalscalar = obj_findsignalscalar((t_object *)x, 1);
     // Magic End
     x->x_buffer = buffer_init((t_class *)x, name, 1, 0);
+    wavetable_mipmap_build(x);
     return(x);
     errstate:
         post("wavetable~: improper args");
@@ -298,7 +592,7 @@ static void *wavetable_new(t_symbol *s, int ac, t_atom *av){
 
 void wavetable_tilde_setup(void){
     wavetable_class = class_new(gensym("wavetable~"), (t_newmethod)wavetable_new,
-        (t_method)wavetable_free, sizeof(t_wavetable), CLASS_DEFAULT, A_GIMME, 0);
+        (t_method)wavetable_free, sizeof(t_wavetable), CLASS_MULTICHANNEL, A_GIMME, 0);
     CLASS_MAINSIGNALIN(wavetable_class, t_wavetable, x_freq);
     class_addmethod(wavetable_class, (t_method)wavetable_dsp, gensym("dsp"), A_CANT, 0);
     class_addmethod(wavetable_class, (t_method)wavetable_none, gensym("none"), 0);
@@ -310,5 +604,6 @@ void wavetable_tilde_setup(void){
     class_addmethod(wavetable_class, (t_method)wavetable_offset, gensym("offset"), A_FLOAT, 0);
     class_addmethod(wavetable_class, (t_method)wavetable_soft, gensym("soft"), A_DEFFLOAT, 0);
     class_addmethod(wavetable_class, (t_method)wavetable_midi, gensym("midi"), A_DEFFLOAT, 0);
+    class_addmethod(wavetable_class, (t_method)wavetable_mipmap, gensym("mipmap"), A_DEFFLOAT, 0);
     class_addmethod(wavetable_class, (t_method)wavetable_set, gensym("set"), A_SYMBOL, 0);
 }
@@ -28,7 +28,7 @@ proc category_else_menu::load_menutree {} {
             {fft
                 {hann~ bin.shift~}}
             {table
-                {buffer tabgen tabreader tabreader~}}
+                {buffer sample.store tabgen tabreader tabreader~}}
             {tuning/notes
                 {scales scale2freq scala autotune autotune2 makenote2 retune eqdiv cents2scale scale2cents cents2frac frac2cents dec2frac frac2dec freq2midi midi2freq note2pitch pitch2note note2dur}}
             {patch/subpatch\ management
@@ -94,7 +94,7 @@ proc category_else_menu::load_menutree {} {
             {control:\ triggers\ clock
                 {clock metronome metronome~ polymetro polymetro~ speed tempo tempo~}}
             {analysis
-                {changed~ changed2~ detect~ lastvalue~ median~ peak~ tap range range~ maxpeak~ rms~ mov.rms~ vu~ zerocross~ beat~}}
+                {changed~ changed2~ detect~ lastvalue~ median~ peak~ tap range range~ maxpeak~ rms~ mov.rms~ vu~ zerocross~ beat~ onset~ pitch~}}
         }
     }
     return $menutree
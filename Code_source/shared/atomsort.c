@@ -0,0 +1,203 @@
+// sorting of atom lists, shared by [sort] and [dir]
+
+#include "m_pd.h"
+#include "atomsort.h"
+#include <string.h>
+#include <stdint.h>
+
+// Floats and symbols are split once. Floats go through an LSD radix sort
+// on their bit patterns, mapped so unsigned order is numeric order, and
+// symbols through an introsort: quicksort that switches to heapsort when
+// it recurses too deep, so no input makes it quadratic or blows the stack.
+
+#if PD_FLOATSIZE == 64
+typedef uint64_t t_key;
+#define KEY_SIGN    ((t_key)1 << 63)
+#else
+typedef uint32_t t_key;
+#define KEY_SIGN    ((t_key)1 << 31)
+#endif
+
+#define SMALL_SORT  16  // insertion sort below this
+#define STACK_ITEMS 64  // scratch on the stack below this
+
+typedef struct _fkey{
+    t_key       k;
+    int         i;
+}t_fkey;
+
+typedef struct _skey{
+    t_symbol   *s;
+    int         i;
+}t_skey;
+
+static t_key atomsort_tokey(t_float f){
+    union{t_float f; t_key k;}u;
+    u.f = f;
+    return(u.k & KEY_SIGN ? ~u.k : u.k | KEY_SIGN);
+}
+
+static t_float atomsort_fromkey(t_key k){
+    union{t_float f; t_key k;}u;
+    u.k = k & KEY_SIGN ? k & ~KEY_SIGN : ~k;
+    return(u.f);
+}
+
+// returns the buffer holding the result, 'a' or 'b'
+static t_fkey *atomsort_radix(t_fkey *a, t_fkey *b, int n){
+    int count[256];
+    for(unsigned int shift = 0; shift < sizeof(t_key) * 8; shift += 8){
+        memset(count, 0, sizeof(count));
+        for(int i = 0; i < n; i++)
+            count[(a[i].k >> shift) & 0xFF]++;
+        if(count[(a[0].k >> shift) & 0xFF] == n) // all the same digit
+            continue;
+        for(int d = 0, sum = 0; d < 256; d++){
+            int c = count[d];
+            count[d] = sum;
+            sum += c;
+        }
+        for(int i = 0; i < n; i++)
+            b[count[(a[i].k >> shift) & 0xFF]++] = a[i];
+        t_fkey *tmp = a;
+        a = b, b = tmp;
+    }
+    return(a);
+}
+
+static int atomsort_before(t_skey *a, t_skey *b, int dir, int stable){
+    if(a->s != b->s){
+        int c = strcmp(a->s->s_name, b->s->s_name);
+        if(c)
+            return(dir < 0 ? c > 0 : c < 0);
+    }
+    return(stable && a->i < b->i);
+}
+
+static void atomsort_swap(t_skey *a, t_skey *b){
+    t_skey tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+static void atomsort_sift(t_skey *v, int i, int n, int dir, int stable){
+    while(1){
+        int child = 2*i + 1;
+        if(child >= n)
+            return;
+        if(child + 1 < n && atomsort_before(v + child, v + child + 1, dir, stable))
+            child++;
+        if(!atomsort_before(v + i, v + child, dir, stable))
+            return;
+        atomsort_swap(v + i, v + child);
+        i = child;
+    }
+}
+
+static void atomsort_heap(t_skey *v, int n, int dir, int stable){
+    for(int i = n/2 - 1; i >= 0; i--)
+        atomsort_sift(v, i, n, dir, stable);
+    for(int i = n - 1; i > 0; i--){
+        atomsort_swap(v, v + i);
+        atomsort_sift(v, 0, i, dir, stable);
+    }
+}
+
+static void atomsort_insertion(t_skey *v, int n, int dir, int stable){
+    for(int i = 1; i < n; i++){
+        t_skey tmp = v[i];
+        int j = i;
+        for(; j > 0 && atomsort_before(&tmp, v + j - 1, dir, stable); j--)
+            v[j] = v[j-1];
+        v[j] = tmp;
+    }
+}
+
+static void atomsort_intro(t_skey *v, int n, int depth, int dir, int stable){
+    while(n > SMALL_SORT){
+        if(!depth--){
+            atomsort_heap(v, n, dir, stable);
+            return;
+        }
+        // median of 3 to v[0], then Hoare partition around it
+        t_skey *lo = v, *mid = v + n/2, *hi = v + n - 1;
+        if(atomsort_before(mid, lo, dir, stable))
+            atomsort_swap(mid, lo);
+        if(atomsort_before(hi, mid, dir, stable)){
+            atomsort_swap(hi, mid);
+            if(atomsort_before(mid, lo, dir, stable))
+                atomsort_swap(mid, lo);
+        }
+        atomsort_swap(v, mid);
+        int i = 0, j = n;
+        while(1){
+            while(atomsort_before(v + ++i, v, dir, stable) && i < n - 1);
+            while(atomsort_before(v, v + --j, dir, stable));
+            if(i >= j)
+                break;
+            atomsort_swap(v + i, v + j);
+        }
+        atomsort_swap(v, v + j);
+        // recurse into the smaller side, loop on the larger
+        if(j < n - j - 1){
+            atomsort_intro(v, j, depth, dir, stable);
+            v += j + 1, n -= j + 1;
+        }
+        else{
+            atomsort_intro(v + j + 1, n - j - 1, depth, dir, stable);
+            n = j;
+        }
+    }
+    atomsort_insertion(v, n, dir, stable);
+}
+
+void atomsort(t_atom *av, t_atom *index, int n, int dir, int stable){
+    if(n < 1)
+        return;
+    int nf = 0, ns = 0;
+    for(int i = 0; i < n; i++)
+        nf += (av[i].a_type == A_FLOAT);
+    ns = n - nf;
+    t_fkey fstack[2 * STACK_ITEMS];
+    t_skey sstack[STACK_ITEMS];
+    int heap = n > STACK_ITEMS;
+    t_fkey *fk = heap ? (t_fkey *)getbytes(2 * nf * sizeof(t_fkey)) : fstack;
+    t_skey *sk = heap ? (t_skey *)getbytes(ns * sizeof(t_skey)) : sstack;
+    t_fkey *fkeys = fk, *fk2 = fk + nf;
+    for(int i = 0, f = 0, s = 0; i < n; i++){
+        if(av[i].a_type == A_FLOAT){
+            t_key k = atomsort_tokey(av[i].a_w.w_float);
+            fk[f].k = dir < 0 ? ~k : k; // inverted keys sort descending
+            fk[f++].i = i;
+        }
+        else{
+            sk[s].s = av[i].a_w.w_symbol;
+            sk[s++].i = i;
+        }
+    }
+    if(nf)
+        fk = atomsort_radix(fk, fk2, nf);
+    if(ns){
+        int depth = 0;
+        for(int m = ns; m > 1; m >>= 1)
+            depth += 2;
+        atomsort_intro(sk, ns, depth, dir, stable);
+    }
+    // floats first going up, symbols first going down
+    t_atom *fout = av + (dir < 0 ? ns : 0), *sout = av + (dir < 0 ? 0 : nf);
+    for(int i = 0; i < nf; i++){
+        t_key k = fk[i].k;
+        SETFLOAT(fout + i, atomsort_fromkey(dir < 0 ? ~k : k));
+        if(index)
+            SETFLOAT(index + (fout - av) + i, fk[i].i);
+    }
+    for(int i = 0; i < ns; i++){
+        SETSYMBOL(sout + i, sk[i].s);
+        if(index)
+            SETFLOAT(index + (sout - av) + i, sk[i].i);
+    }
+    if(heap){
+        freebytes(fkeys, 2 * nf * sizeof(t_fkey));
+        freebytes(sk, ns * sizeof(t_skey));
+    }
+}
@@ -0,0 +1,13 @@
+// sorting of atom lists, shared by [sort] and [dir]
+
+#ifndef __atomsort_H__
+#define __atomsort_H__
+
+// Sorts 'n' atoms in place: floats by value, then symbols in strcmp() order,
+// all of it the other way around if 'dir' is negative. If 'index' isn't NULL
+// it gets the original position of each sorted atom as floats. Floats are
+// radix sorted, which keeps the input order of equal values; symbols only
+// keep it if 'stable' is set.
+void atomsort(t_atom *av, t_atom *index, int n, int dir, int stable);
+
+#endif
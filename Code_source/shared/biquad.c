@@ -0,0 +1,157 @@
+// shared biquad engine for ELSE's 2nd order filters
+
+#include <m_pd.h>
+#include "biquad.h"
+
+void biquad_sincos(double omega, double *sinw, double *cosw, double *onemcosw){
+    // half angle keeps the polynomials in [0, PI/2] and 1-cos(w) = 2*sin(w/2)^2
+    double x = omega * 0.5;
+    double x2 = x * x;
+    double s = x * (1. + x2 * (-1./6. + x2 * (1./120. + x2 * (-1./5040.
+        + x2 * (1./362880. + x2 * (-1./39916800. + x2 * (1./6227020800.)))))));
+    double c = 1. + x2 * (-0.5 + x2 * (1./24. + x2 * (-1./720. + x2 * (1./40320.
+        + x2 * (-1./3628800. + x2 * (1./479001600. + x2 * (-1./87178291200.)))))));
+    double s2 = 2. * s * s;
+    *sinw = 2. * s * c;
+    *cosw = 1. - s2;
+    *onemcosw = s2;
+}
+
+void biquad_clear(t_biquad *bq){
+    bq->xnm1 = bq->xnm2 = bq->ynm1 = bq->ynm2 = 0.;
+}
+
+void biquad_init(t_biquad *bq){
+    bq->c.a0 = 1.;
+    bq->c.a1 = bq->c.a2 = bq->c.b1 = bq->c.b2 = 0.;
+    bq->target = bq->c;
+    bq->ramp = 0;
+    bq->param[0] = bq->param[1] = bq->param[2] = 0.;
+    biquad_clear(bq);
+}
+
+void biquad_set(t_biquad *bq, t_biquad_coeffs *c, int n){
+    bq->target = *c;
+    if(n < 1){
+        bq->c = *c;
+        bq->ramp = 0;
+    }
+    else{
+        double r = 1. / n;
+        bq->inc.a0 = (c->a0 - bq->c.a0) * r;
+        bq->inc.a1 = (c->a1 - bq->c.a1) * r;
+        bq->inc.a2 = (c->a2 - bq->c.a2) * r;
+        bq->inc.b1 = (c->b1 - bq->c.b1) * r;
+        bq->inc.b2 = (c->b2 - bq->c.b2) * r;
+        bq->ramp = n;
+    }
+}
+
+void biquad_run(t_biquad *bq, t_sample *in, t_sample *out, int n){
+    double xnm1 = bq->xnm1, xnm2 = bq->xnm2, ynm1 = bq->ynm1, ynm2 = bq->ynm2;
+    double a0 = bq->c.a0, a1 = bq->c.a1, a2 = bq->c.a2, b1 = bq->c.b1, b2 = bq->c.b2;
+    if(bq->ramp > 0){ // interpolate coefficients (stable region is convex)
+        int m = bq->ramp < n ? bq->ramp : n;
+        double da0 = bq->inc.a0, da1 = bq->inc.a1, da2 = bq->inc.a2;
+        double db1 = bq->inc.b1, db2 = bq->inc.b2;
+        bq->ramp -= m;
+        n -= m;
+        while(m--){
+            double xn = *in++, yn;
+            a0 += da0, a1 += da1, a2 += da2, b1 += db1, b2 += db2;
+            yn = a0 * xn + a1 * xnm1 + a2 * xnm2 + b1 * ynm1 + b2 * ynm2;
+            *out++ = yn;
+            xnm2 = xnm1, xnm1 = xn;
+            ynm2 = ynm1, ynm1 = yn;
+        }
+        if(bq->ramp) // still ramping, keep the interpolated values
+            bq->c.a0 = a0, bq->c.a1 = a1, bq->c.a2 = a2, bq->c.b1 = b1, bq->c.b2 = b2;
+        else{ // snap to target so rounding errors don't accumulate
+            bq->c = bq->target;
+            a0 = bq->c.a0, a1 = bq->c.a1, a2 = bq->c.a2, b1 = bq->c.b1, b2 = bq->c.b2;
+        }
+    }
+    while(n--){
+        double xn = *in++;
+        double yn = a0 * xn + a1 * xnm1 + a2 * xnm2 + b1 * ynm1 + b2 * ynm2;
+        *out++ = yn;
+        xnm2 = xnm1, xnm1 = xn;
+        ynm2 = ynm1, ynm1 = yn;
+    }
+    bq->xnm1 = xnm1, bq->xnm2 = xnm2, bq->ynm1 = ynm1, bq->ynm2 = ynm2;
+}
+
+static void biquad_run_lanes(t_biquad *bq, t_sample *in, t_sample *out, int stride, int n){
+    double a0[BIQUAD_LANES], a1[BIQUAD_LANES], a2[BIQUAD_LANES];
+    double b1[BIQUAD_LANES], b2[BIQUAD_LANES];
+    double da0[BIQUAD_LANES], da1[BIQUAD_LANES], da2[BIQUAD_LANES];
+    double db1[BIQUAD_LANES], db2[BIQUAD_LANES];
+    double xnm1[BIQUAD_LANES], xnm2[BIQUAD_LANES];
+    double ynm1[BIQUAD_LANES], ynm2[BIQUAD_LANES];
+    int k, i = 0;
+    for(k = 0; k < BIQUAD_LANES; k++){
+        a0[k] = bq[k].c.a0, a1[k] = bq[k].c.a1, a2[k] = bq[k].c.a2;
+        b1[k] = bq[k].c.b1, b2[k] = bq[k].c.b2;
+        xnm1[k] = bq[k].xnm1, xnm2[k] = bq[k].xnm2;
+        ynm1[k] = bq[k].ynm1, ynm2[k] = bq[k].ynm2;
+    }
+    while(i < n){
+        // split the block where a ramp ends so lanes can share one loop
+        int m = n - i;
+        for(k = 0; k < BIQUAD_LANES; k++){
+            int r = bq[k].ramp;
+            if(r > 0 && r < m)
+                m = r;
+            da0[k] = r > 0 ? bq[k].inc.a0 : 0., da1[k] = r > 0 ? bq[k].inc.a1 : 0.;
+            da2[k] = r > 0 ? bq[k].inc.a2 : 0., db1[k] = r > 0 ? bq[k].inc.b1 : 0.;
+            db2[k] = r > 0 ? bq[k].inc.b2 : 0.;
+        }
+        for(int end = i + m; i < end; i++){
+            double xn[BIQUAD_LANES], yn[BIQUAD_LANES];
+            for(k = 0; k < BIQUAD_LANES; k++)
+                xn[k] = in[k*stride + i];
+            for(k = 0; k < BIQUAD_LANES; k++){
+                a0[k] += da0[k], a1[k] += da1[k], a2[k] += da2[k];
+                b1[k] += db1[k], b2[k] += db2[k];
+                yn[k] = a0[k] * xn[k] + a1[k] * xnm1[k] + a2[k] * xnm2[k]
+                    + b1[k] * ynm1[k] + b2[k] * ynm2[k];
+                xnm2[k] = xnm1[k], xnm1[k] = xn[k];
+                ynm2[k] = ynm1[k], ynm1[k] = yn[k];
+            }
+            for(k = 0; k < BIQUAD_LANES; k++)
+                out[k*stride + i] = yn[k];
+        }
+        for(k = 0; k < BIQUAD_LANES; k++){
+            if(bq[k].ramp > 0 && !(bq[k].ramp -= m)){
+                t_biquad_coeffs *t = &bq[k].target;
+                a0[k] = t->a0, a1[k] = t->a1, a2[k] = t->a2, b1[k] = t->b1, b2[k] = t->b2;
+            }
+        }
+    }
+    for(k = 0; k < BIQUAD_LANES; k++){
+        bq[k].c.a0 = a0[k], bq[k].c.a1 = a1[k], bq[k].c.a2 = a2[k];
+        bq[k].c.b1 = b1[k], bq[k].c.b2 = b2[k];
+        bq[k].xnm1 = xnm1[k], bq[k].xnm2 = xnm2[k];
+        bq[k].ynm1 = ynm1[k], bq[k].ynm2 = ynm2[k];
+    }
+}
+
+void biquad_run_mc(t_biquad *bq, int nch, t_sample *in, t_sample *out, int stride, int n){
+    int j = 0;
+    for(; j + BIQUAD_LANES <= nch; j += BIQUAD_LANES)
+        biquad_run_lanes(bq + j, in + j*stride, out + j*stride, stride, n);
+    for(; j < nch; j++)
+        biquad_run(bq + j, in + j*stride, out + j*stride, n);
+}
+
+t_biquad *biquad_resize(t_biquad *bq, int oldn, int newn){
+    bq = (t_biquad *)resizebytes(bq, oldn * sizeof(t_biquad), newn * sizeof(t_biquad));
+    for(int j = oldn; j < newn; j++){
+        if(j)
+            bq[j] = bq[j-1], bq[j].ramp = 0, bq[j].c = bq[j].target;
+        else
+            biquad_init(&bq[j]);
+        biquad_clear(&bq[j]);
+    }
+    return(bq);
+}
@@ -0,0 +1,53 @@
+// shared biquad engine for ELSE's 2nd order filters
+
+#ifndef __biquad_H__
+#define __biquad_H__
+
+#define BIQUAD_PI 3.14159265358979323846
+#define BIQUAD_HALF_LOG2 0.34657359027997264 // log(2)/2
+#define BIQUAD_LOG10_40 0.05756462732485115 // log(10)/40, for pow(10, db/40)
+
+// at signal rate, parameters are read once every BIQUAD_STEP samples and
+// the coefficients are linearly interpolated in between
+#define BIQUAD_STEP 16
+
+// number of channels processed together by biquad_run_mc()
+#define BIQUAD_LANES 4
+
+typedef struct _biquad_coeffs{
+    double  a0;
+    double  a1;
+    double  a2;
+    double  b1;
+    double  b2;
+}t_biquad_coeffs;
+
+typedef struct _biquad{
+    t_biquad_coeffs c;       // current coefficients
+    t_biquad_coeffs target;  // coefficients at the end of the ramp
+    t_biquad_coeffs inc;     // per sample increment while ramping
+    int             ramp;    // samples left in the current ramp
+    double          param[3]; // parameters the coefficients were computed from
+    double          xnm1;
+    double          xnm2;
+    double          ynm1;
+    double          ynm2;
+}t_biquad;
+
+// polynomial sin/cos for omega in [0, PI], also gives 1-cos(omega)
+// with full relative precision for very low frequencies
+void biquad_sincos(double omega, double *sinw, double *cosw, double *onemcosw);
+
+void biquad_init(t_biquad *bq);
+void biquad_clear(t_biquad *bq);
+// ramp to new coefficients over 'n' samples (jump if n < 1)
+void biquad_set(t_biquad *bq, t_biquad_coeffs *c, int n);
+void biquad_run(t_biquad *bq, t_sample *in, t_sample *out, int n);
+// run 'nch' filters over channels spaced 'stride' samples apart, in groups
+// of BIQUAD_LANES with their state held side by side so it can vectorize
+void biquad_run_mc(t_biquad *bq, int nch, t_sample *in, t_sample *out, int stride, int n);
+// resize a multichannel filter array, new channels copy the last channel's
+// coefficients and parameters and start with a cleared state
+t_biquad *biquad_resize(t_biquad *bq, int oldn, int newn);
+
+#endif
@@ -3,6 +3,11 @@
 #include "buffer.h"
 #include <string.h>
 #include <stdarg.h>
+#include <stdio.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 
 // interpolation
 double interp_lin(double frac, double b, double c){
@@ -94,6 +99,132 @@ t_word *buffer_get(t_buffer *c, t_symbol * name, int *bufsize, int indsp, int co
     return (0);
 }
 
+// ------------------------------ stores ------------------------------
+
+#define STORE_CLASSNAME "sample.store data"
+
+// stores are found by the class name rather than a class pointer, as each
+// object that binds to them has its own copy of this file
+t_store *store_find(t_symbol *name){
+    char buf[MAXPDSTRING];
+    if(!name || name == &s_)
+        return(NULL);
+    snprintf(buf, MAXPDSTRING, "else-store-%s", name->s_name);
+    t_pd *thing = gensym(buf)->s_thing;
+    if(!thing || strcmp(class_getname(*thing), STORE_CLASSNAME))
+        return(NULL);
+    t_store *st = (t_store *)thing;
+    return(st->st_version == STORE_VERSION ? st : NULL);
+}
+
+void store_ref(t_store *st){
+    st->st_refs++;
+}
+
+static void store_freedata(void *data, size_t bytes, int mapped){
+    if(!data)
+        return;
+#ifndef _WIN32
+    if(mapped)
+        munmap(data, bytes);
+    else
+#endif
+        freebytes(data, bytes);
+}
+
+void store_release(t_store *st){
+    if(--st->st_refs > 0)
+        return;
+    store_freedata(st->st_data, st->st_bytes, st->st_mapped);
+    if(st->st_vectors)
+        freebytes(st->st_vectors, st->st_nchans * sizeof(*st->st_vectors));
+    freebytes(st, sizeof(*st));
+}
+
+int store_alloc(t_store *st, int nchans, int npts, int mapped, int keep){
+    size_t bytes = (size_t)nchans * npts * sizeof(float);
+    void *data = NULL;
+#ifndef _WIN32
+    if(mapped){ // backed by a file the system can page to, rather than swap
+        FILE *fp = tmpfile();
+        if(fp){
+            if(!ftruncate(fileno(fp), bytes)){
+                data = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fileno(fp), 0);
+                if(data == MAP_FAILED)
+                    data = NULL;
+            }
+            fclose(fp); // the mapping keeps it
+        }
+    }
+#endif
+    mapped = (data != NULL);
+    if(!data && !(data = getbytes(bytes)))
+        return(0);
+    float **vectors = (float **)getbytes(nchans * sizeof(*vectors));
+    for(int ch = 0; ch < nchans; ch++){
+        vectors[ch] = (float *)data + (size_t)ch * npts;
+        if(keep && ch < st->st_nchans)
+            memcpy(vectors[ch], st->st_vectors[ch],
+                (npts < st->st_npts ? npts : st->st_npts) * sizeof(float));
+    }
+    store_freedata(st->st_data, st->st_bytes, st->st_mapped);
+    if(st->st_vectors)
+        freebytes(st->st_vectors, st->st_nchans * sizeof(*st->st_vectors));
+    st->st_data = data;
+    st->st_bytes = bytes;
+    st->st_mapped = mapped;
+    st->st_vectors = vectors;
+    st->st_nchans = nchans;
+    st->st_npts = npts;
+    return(1);
+}
+
+// each bin of the array gets its loudest sample, so it still looks right
+void store_mirror(t_store *st){
+    if(!st->st_mirror || !st->st_npts)
+        return;
+    for(int ch = 0; ch < st->st_nchans; ch++){
+        char buf[MAXPDSTRING];
+        t_garray *ap = NULL;
+        if(!ch)
+            ap = (t_garray *)pd_findbyclass(st->st_mirror, garray_class);
+        if(!ap){
+            snprintf(buf, MAXPDSTRING, "%d-%s", ch, st->st_mirror->s_name);
+            ap = (t_garray *)pd_findbyclass(gensym(buf), garray_class);
+        }
+        int n;
+        t_word *vec;
+        if(!ap || !garray_getfloatwords(ap, &n, &vec))
+            continue;
+        float *fp = st->st_vectors[ch];
+        for(int i = 0; i < n; i++){
+            long long j = (long long)i * st->st_npts / n;
+            long long end = (long long)(i + 1) * st->st_npts / n;
+            float peak = fp[j];
+            for(j++; j < end; j++)
+                if(fabsf(fp[j]) > fabsf(peak))
+                    peak = fp[j];
+            vec[i].w_float = peak;
+        }
+        garray_redraw(ap);
+    }
+}
+
+// bind to the store with our name, if there's one, and keep it alive
+static t_store *buffer_store(t_buffer *c){
+    t_store *st = store_find(c->c_bufname);
+    if(st != c->c_store){
+        if(st)
+            store_ref(st);
+        if(c->c_store)
+            store_release(c->c_store);
+        c->c_store = st;
+    }
+    return(st);
+}
+
+// ---------------------------------------------------------------------
+
 //making peek~ work with channel number choosing, assuming 1-indexed
 void buffer_getchannel(t_buffer *c, int chan_num, int complain){
     int chan_idx;
@@ -106,6 +237,14 @@ void buffer_getchannel(t_buffer *c, int chan_num, int complain){
     c->c_single = chan_num;
     //convert to 0-indexing, separate steps and diff variable for sanity's sake
     chan_idx = chan_num - 1;
+    t_store *st = buffer_store(c);
+    if(st){
+        c->c_vectors[0] = NULL;
+        c->c_fvectors[0] = chan_idx < st->st_nchans ? st->st_vectors[chan_idx] : NULL;
+        c->c_npts = st->st_npts;
+        return;
+    }
+    c->c_fvectors[0] = NULL;
     //making the buffer channel name string we'll be looking for
     if(c->c_bufname != &s_){
         if(chan_idx == 0){
@@ -145,10 +284,13 @@ void buffer_bug(char *fmt, ...){ // from loud.c
 void buffer_clear(t_buffer *c){
     c->c_npts = 0;
     memset(c->c_vectors, 0, c->c_numchans * sizeof(*c->c_vectors));
+    memset(c->c_fvectors, 0, c->c_numchans * sizeof(*c->c_fvectors));
 }
 
 void buffer_redraw(t_buffer *c){
-    if(!c->c_single){
+    if(c->c_store)
+        store_mirror(c->c_store);
+    else if(!c->c_single){
         if(c->c_numchans <= 1 && c->c_bufname != &s_){
             t_garray *ap = (t_garray *)pd_findbyclass(c->c_bufname, garray_class);
             if (ap) garray_redraw(ap);
@@ -197,7 +339,13 @@ void buffer_redraw(t_buffer *c){
 void buffer_validate(t_buffer *c, int complain){
     buffer_clear(c);
     c->c_npts = SHARED_INT_MAX;
-    if(!c->c_single){
+    t_store *st = c->c_single ? NULL : buffer_store(c);
+    if(st){
+        for(int ch = 0; ch < c->c_numchans && ch < st->st_nchans; ch++)
+            c->c_fvectors[ch] = st->st_vectors[ch];
+        c->c_npts = st->st_npts;
+    }
+    else if(!c->c_single){
         if (c->c_numchans <= 1 && c->c_bufname != &s_){
             c->c_vectors[0] = buffer_get(c, c->c_bufname, &c->c_npts, 1, 0);
             if(!c->c_vectors[0]){ // check for 0-bufname if bufname array isn't found
@@ -261,8 +409,12 @@ void buffer_checkdsp(t_buffer *c){
 }
 
 void buffer_free(t_buffer *c){
+    if(c->c_store)
+        store_release(c->c_store);
     if (c->c_vectors)
         freebytes(c->c_vectors, c->c_numchans * sizeof(*c->c_vectors));
+    if(c->c_fvectors)
+        freebytes(c->c_fvectors, c->c_numchans * sizeof(*c->c_fvectors));
     if (c->c_channames)
         freebytes(c->c_channames, c->c_numchans * sizeof(*c->c_channames));
     freebytes(c, sizeof(t_buffer));
@@ -293,6 +445,8 @@ void *buffer_init(t_class *owner, t_symbol *bufname, int numchans, int singlemod
     c->c_owner = owner;
     c->c_npts = 0;
     c->c_vectors = (t_word**)vectors;
+    c->c_fvectors = (float **)getbytes(numchans * sizeof(*c->c_fvectors));
+    c->c_store = NULL;
     c->c_channames = channames;
     c->c_disabled = 0;
     c->c_playable = 0;
@@ -17,11 +17,43 @@
 
 #define ONE_SIXTH 0.16666666666666666666667f
 
+// A sample store is an ELSE side alternative to arrays, made by [sample.store]:
+// float32 samples, contiguous per channel, found by name and refcounted so
+// it can outlive its owner while something still plays from it. Objects built
+// on t_buffer bind to a store when there's one with the array name they get.
+
+#define STORE_VERSION 1
+
+typedef struct _store{
+    t_pd        st_pd;          // bound to "else-store-<name>"
+    int         st_version;
+    int         st_refs;        // the owner and every t_buffer bound to it
+    t_symbol   *st_name;
+    int         st_nchans;
+    int         st_npts;
+    float     **st_vectors;
+    void       *st_data;
+    size_t      st_bytes;
+    int         st_mapped;      // data is mmap()ed on a temporary file
+    t_symbol   *st_mirror;      // arrays to mirror to for display, if any
+}t_store;
+
+t_store *store_find(t_symbol *name);
+void store_ref(t_store *st);
+void store_release(t_store *st);
+// (re)allocates zeroed sample data, copying the old over if 'keep' is set,
+// returns 0 if out of memory
+int store_alloc(t_store *st, int nchans, int npts, int mapped, int keep);
+// copies to the mirror arrays, decimated to their size
+void store_mirror(t_store *st);
+
 typedef struct _buffer{
     void       *c_owner;     // owner of buffer, note i don't know if this actually works
     int         c_npts;      // used also as a validation flag, number of samples in an array */
     int         c_numchans;
     t_word    **c_vectors;
+    float     **c_fvectors;  // instead of c_vectors when bound to a store
+    t_store    *c_store;
     t_symbol  **c_channames;
     t_symbol   *c_bufname;
     int         c_playable;
@@ -31,6 +63,9 @@ typedef struct _buffer{
                              // should be used with c_numchans == 1
 }t_buffer;
 
+// a sample from a channel of either kind: 'vp' from c_vectors, 'fp' from c_fvectors
+#define buffer_sample(vp, fp, i) ((fp) ? (double)(fp)[i] : (double)(vp)[i].w_float)
+
 double interp_lin(double frac, double b, double c);
 double interp_cos(double frac, double b, double c);
 double interp_pow(double frac, double b, double c, double p);
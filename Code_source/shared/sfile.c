@@ -0,0 +1,214 @@
+// sound file headers and sample decoding, for objects that read files themselves
+
+#include "m_pd.h"
+#include "sfile.h"
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+static unsigned long sfile_le16(const unsigned char *p){
+    return(p[0] | (p[1] << 8));
+}
+
+static unsigned long sfile_le32(const unsigned char *p){
+    return(p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned long)p[3] << 24));
+}
+
+static unsigned long sfile_be16(const unsigned char *p){
+    return((p[0] << 8) | p[1]);
+}
+
+static unsigned long sfile_be32(const unsigned char *p){
+    return(((unsigned long)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
+}
+
+static long long sfile_le64(const unsigned char *p){
+    return((long long)sfile_le32(p) | ((long long)sfile_le32(p+4) << 32));
+}
+
+static long long sfile_be64(const unsigned char *p){
+    return(((long long)sfile_be32(p) << 32) | (long long)sfile_be32(p+4));
+}
+
+static double sfile_bedouble(const unsigned char *p){
+    long long i = sfile_be64(p);
+    double d;
+    memcpy(&d, &i, sizeof(d));
+    return(d);
+}
+
+static double sfile_extended(const unsigned char *p){ // aiff's 80 bit float
+    int expon = ((p[0] & 0x7F) << 8) | p[1];
+    double f = ldexp((double)sfile_be32(p+2), expon - 16383 - 31)
+        + ldexp((double)sfile_be32(p+6), expon - 16383 - 63);
+    return(p[0] & 0x80 ? -f : f);
+}
+
+static int sfile_chunk(FILE *fp, long long pos, unsigned char *b, int n){
+    return(!sfile_seek(fp, pos, SEEK_SET) && (int)fread(b, 1, n, fp) == n);
+}
+
+// 'bits' are the valid bits of a sample and 'bytes' the size of its container
+static int sfile_setformat(t_sfinfo *info, int isfloat, int bits, int bytes){
+    info->i_bytes = bytes;
+    if(isfloat)
+        info->i_format = SF_FLOAT;
+    else
+        info->i_format = info->i_bytes == 1 && !info->i_bigendian ? SF_UINT8 : SF_INT;
+    if(isfloat)
+        return((bits == 32 || bits == 64) && bits == bytes * 8);
+    return(bits > 0 && bits <= bytes * 8 && bytes <= 4);
+}
+
+int sfile_readheader(FILE *fp, t_sfinfo *info){
+    unsigned char b[40];
+    long long filesize, pos, size, datasize = -1, ds64 = -1;
+    int ok = 0;
+    memset(info, 0, sizeof(*info));
+    info->i_offset = -1;
+    if(sfile_seek(fp, 0, SEEK_END) || (filesize = sfile_tell(fp)) < 0 || !sfile_chunk(fp, 0, b, 24))
+        return(0);
+    if((!memcmp(b, "RIFF", 4) || !memcmp(b, "RF64", 4)) && !memcmp(b+8, "WAVE", 4)){
+        for(pos = 12; pos + 8 <= filesize; pos += 8 + size + (size & 1)){
+            if(!sfile_chunk(fp, pos, b, 8))
+                return(0);
+            size = sfile_le32(b+4);
+            if(!memcmp(b, "ds64", 4)){
+                if(!sfile_chunk(fp, pos + 8, b, 16))
+                    return(0);
+                ds64 = sfile_le64(b+8);
+            }
+            else if(!memcmp(b, "fmt ", 4)){
+                int n = size < 40 ? (int)size : 40;
+                if(n < 16 || !sfile_chunk(fp, pos + 8, b, n))
+                    return(0);
+                int tag = (int)sfile_le16(b);
+                if(tag == 0xFFFE && n >= 26) // extensible, the subformat guid starts with it
+                    tag = (int)sfile_le16(b+24);
+                info->i_nchans = (int)sfile_le16(b+2);
+                info->i_sr = sfile_le32(b+4);
+                if(!info->i_nchans || (tag != 1 && tag != 3))
+                    return(0);
+                int bytes = (int)(sfile_le16(b+12) / info->i_nchans);
+                ok = sfile_setformat(info, tag == 3, bytes * 8, bytes);
+            }
+            else if(!memcmp(b, "data", 4)){
+                info->i_offset = pos + 8;
+                datasize = size == 0xFFFFFFFF && ds64 >= 0 ? ds64 : size;
+                break;
+            }
+        }
+    }
+    else if(!memcmp(b, "FORM", 4) && (!memcmp(b+8, "AIFF", 4) || !memcmp(b+8, "AIFC", 4))){
+        int aifc = !memcmp(b+8, "AIFC", 4);
+        for(pos = 12; pos + 8 <= filesize; pos += 8 + size + (size & 1)){
+            if(!sfile_chunk(fp, pos, b, 8))
+                return(0);
+            size = sfile_be32(b+4);
+            if(!memcmp(b, "COMM", 4)){
+                int isfloat = 0;
+                if(!sfile_chunk(fp, pos + 8, b, aifc ? 22 : 18))
+                    return(0);
+                info->i_nchans = (int)sfile_be16(b);
+                info->i_sr = sfile_extended(b+8);
+                info->i_bigendian = 1;
+                if(aifc){
+                    if(!memcmp(b+18, "sowt", 4))
+                        info->i_bigendian = 0;
+                    else if(!memcmp(b+18, "fl32", 4) || !memcmp(b+18, "FL32", 4)
+                    || !memcmp(b+18, "fl64", 4) || !memcmp(b+18, "FL64", 4))
+                        isfloat = 1;
+                    else if(memcmp(b+18, "NONE", 4) && memcmp(b+18, "twos", 4))
+                        return(0);
+                }
+                int bits = (int)sfile_be16(b+6);
+                ok = sfile_setformat(info, isfloat, bits, (bits + 7) / 8);
+            }
+            else if(!memcmp(b, "SSND", 4)){
+                if(!sfile_chunk(fp, pos + 8, b, 4))
+                    return(0);
+                info->i_offset = pos + 16 + sfile_be32(b);
+                datasize = size - 8 - sfile_be32(b);
+            }
+        }
+    }
+    else if(!memcmp(b, "caff", 4)){
+        for(pos = 8; pos + 12 <= filesize; pos += 12 + size){
+            if(!sfile_chunk(fp, pos, b, 12))
+                return(0);
+            size = sfile_be64(b+4);
+            if(!memcmp(b, "desc", 4)){
+                if(!sfile_chunk(fp, pos + 12, b, 32) || memcmp(b+8, "lpcm", 4))
+                    return(0);
+                unsigned long flags = sfile_be32(b+12);
+                int bits = (int)sfile_be32(b+28);
+                info->i_sr = sfile_bedouble(b);
+                info->i_nchans = (int)sfile_be32(b+24);
+                info->i_bigendian = !(flags & 2);
+                if(!info->i_nchans)
+                    return(0);
+                // samples can sit in a wider container, the frame size tells
+                int bytes = (int)(sfile_be32(b+16) / info->i_nchans);
+                ok = sfile_setformat(info, flags & 1, bits, bytes);
+                if(!(flags & 16)) // not aligned high, drop the unused bits
+                    info->i_shift = bytes * 8 - bits;
+            }
+            else if(!memcmp(b, "data", 4)){
+                info->i_offset = pos + 16; // past the edit count
+                datasize = size < 0 ? filesize - info->i_offset : size - 4;
+                if(size < 0)
+                    break;
+            }
+        }
+    }
+    else if(!memcmp(b, ".snd", 4)){
+        static const int bits[8] = {0, 0, 8, 16, 24, 32, 32, 64};
+        unsigned long enc = sfile_be32(b+12);
+        info->i_offset = sfile_be32(b+4);
+        datasize = sfile_be32(b+8) == 0xFFFFFFFF ? -1 : (long long)sfile_be32(b+8);
+        info->i_sr = sfile_be32(b+16);
+        info->i_nchans = (int)sfile_be32(b+20);
+        info->i_bigendian = 1;
+        ok = enc >= 2 && enc <= 7 && sfile_setformat(info, enc >= 6, bits[enc], bits[enc] / 8);
+    }
+    if(!ok || info->i_offset < 0 || info->i_nchans < 1 || info->i_offset > filesize)
+        return(0);
+    if(datasize < 0 || datasize > filesize - info->i_offset)
+        datasize = filesize - info->i_offset;
+    info->i_nframes = datasize / (info->i_nchans * info->i_bytes);
+    return(1);
+}
+
+t_sample sfile_decode(const unsigned char *p, t_sfinfo *info){
+    unsigned long u = 0;
+    int i, n = info->i_bytes;
+    if(info->i_format == SF_UINT8)
+        return((p[0] - 128) * (1. / 128));
+    if(info->i_format == SF_FLOAT && n == 8){
+        unsigned char d[8];
+        for(i = 0; i < 8; i++)
+            d[i] = info->i_bigendian ? p[7-i] : p[i];
+        double f;
+        memcpy(&f, d, 8);
+        return((t_sample)f);
+    }
+    for(i = 0; i < n; i++)
+        u |= (unsigned long)(info->i_bigendian ? p[i] : p[n-1-i]) << (8 * (n-1-i));
+    if(info->i_format == SF_FLOAT){
+        uint32_t u32 = (uint32_t)u;
+        float f;
+        memcpy(&f, &u32, 4);
+        return(f);
+    }
+    u <<= 8 * (4 - n) + info->i_shift; // sign lives in bit 31 now
+    return((int32_t)(uint32_t)u * (1. / 2147483648.));
+}
+
+long long sfile_read(FILE *fp, t_sfinfo *info, long long onset, long long n, unsigned char *raw){
+    int framesize = info->i_nchans * info->i_bytes;
+    if(onset + n > info->i_nframes)
+        n = info->i_nframes - onset;
+    if(n <= 0 || sfile_seek(fp, info->i_offset + onset * framesize, SEEK_SET))
+        return(0);
+    return((long long)fread(raw, framesize, (size_t)n, fp));
+}
@@ -0,0 +1,35 @@
+// sound file headers and sample decoding, for objects that read files themselves
+
+#ifndef __SFILE_H__
+#define __SFILE_H__
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#define sfile_seek  _fseeki64
+#define sfile_tell  _ftelli64
+#else
+#define sfile_seek  fseeko
+#define sfile_tell  ftello
+#endif
+
+enum{SF_UINT8, SF_INT, SF_FLOAT};
+
+typedef struct _sfinfo{
+    int         i_nchans;
+    int         i_format;
+    int         i_bytes;        // bytes per sample
+    int         i_shift;        // unused low bits in a sample's container
+    int         i_bigendian;
+    double      i_sr;
+    long long   i_offset;       // where the sample data starts
+    long long   i_nframes;
+}t_sfinfo;
+
+// reads wave (and rf64), aiff/aifc, caf and next/sun headers, 0 if it can't
+int sfile_readheader(FILE *fp, t_sfinfo *info);
+// reads up to 'n' raw frames from 'onset' and returns how many it got
+long long sfile_read(FILE *fp, t_sfinfo *info, long long onset, long long n, unsigned char *raw);
+t_sample sfile_decode(const unsigned char *p, t_sfinfo *info);
+
+#endif